@@ -0,0 +1,495 @@
+#include "../headers/indirect_render_system.h"
+#include "../headers/render_system.h"
+#include "../headers/vortex_swap_chain.h"
+#include "../headers/vortex_upload_queue.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+namespace VortexEngine {
+
+	namespace {
+		constexpr uint32_t CULL_WORKGROUP_SIZE = 64;
+
+		constexpr const char* CULL_SHADER_PATH = "shaders/cull.comp.spv";
+		constexpr const char* VERT_SHADER_PATH = "shaders/indirect.vert.spv";
+		constexpr const char* FRAG_SHADER_PATH = "shaders/default.frag.spv";
+		// default.frag compiled with BINDLESS
+		constexpr const char* BINDLESS_FRAG_SHADER_PATH = "shaders/default_bindless.frag.spv";
+	}
+
+	struct CullPushConstants {
+		glm::vec4 frustumPlanes[6];
+		uint32_t objectCount;
+	};
+
+	IndirectRenderSystem::IndirectRenderSystem(VortexDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+		VortexPipelineRegistry& pipelines, VortexBindlessTable* bindless)
+		: vortexDevice{ device }, pipelineRegistry{ pipelines }, bindlessTable{ bindless },
+		fragShaderPath{ bindless ? BINDLESS_FRAG_SHADER_PATH : FRAG_SHADER_PATH } {
+		if (!isSupported(device)) {
+			throw std::runtime_error("Indirect rendering requires the drawIndirectFirstInstance feature!");
+		}
+		if (bindlessTable) {
+			bindlessMaterials = std::make_unique<VortexBindlessMaterials>(vortexDevice, *bindlessTable);
+		}
+
+		createPipelineLayouts(globalSetLayout, pipelines);
+		createPipelines(renderPass, pipelines);
+
+		frames.resize(VortexSwapChain::MAX_FRAMES_IN_FLIGHT);
+	}
+
+	IndirectRenderSystem::~IndirectRenderSystem() {}
+
+	bool IndirectRenderSystem::isSupported(VortexDevice& device) {
+		return device.enabledFeatures.drawIndirectFirstInstance == VK_TRUE;
+	}
+
+	void IndirectRenderSystem::createPipelineLayouts(VkDescriptorSetLayout globalSetLayout, VortexPipelineRegistry& pipelines) {
+		// set and push constant layouts come from the shaders, only what this class writes is checked
+		auto cullLayout = pipelines.getReflectedLayout({ CULL_SHADER_PATH });
+		if (cullLayout.setLayouts.size() != 1 ||
+			cullLayout.pushConstantRanges.size() != 1 || cullLayout.pushConstantRanges[0].size != sizeof(CullPushConstants)) {
+			throw std::runtime_error("cull.comp does not match CullPushConstants!");
+		}
+		cullSetLayout = cullLayout.setLayouts[0];
+		cullPipelineLayout = cullLayout.pipelineLayout;
+
+		if (bindlessTable) {
+			// getReflectedLayout rejects the runtime sized arrays of set 2, so only check the
+			// reflection against the table's layout and build the pipeline layout from that
+			auto vertShader = pipelines.getShaderModule(VERT_SHADER_PATH);
+			auto fragShader = pipelines.getShaderModule(BINDLESS_FRAG_SHADER_PATH);
+			auto layout = VortexShaderReflection::mergeLayouts({ &vertShader->getReflection(), &fragShader->getReflection() });
+
+			if (layout.sets.size() != 3 ||
+				pipelines.getDescriptorSetLayout(layout.sets[0])->getDescriptorSetLayout() != globalSetLayout) {
+				throw std::runtime_error("IndirectRenderSystem bindless shaders do not match the global descriptor set layout!");
+			}
+			if (!bindlessTable->isCompatible(layout.sets[2])) {
+				throw std::runtime_error("IndirectRenderSystem bindless shaders do not match the bindless table!");
+			}
+			if (layout.pushConstantRanges.size() != 1 || layout.pushConstantRanges[0].size != sizeof(BindlessPushConstants)) {
+				throw std::runtime_error("IndirectRenderSystem bindless shaders do not match BindlessPushConstants!");
+			}
+			objectSetLayout = pipelines.getDescriptorSetLayout(layout.sets[1]);
+			pipelineLayout = pipelines.getPipelineLayout(
+				{ globalSetLayout, objectSetLayout->getDescriptorSetLayout(), bindlessTable->getDescriptorSetLayout() },
+				layout.pushConstantRanges);
+			return;
+		}
+
+		// default.frag reads the material opacity, only used by alpha tested variants
+		auto layout = pipelines.getReflectedLayout({ VERT_SHADER_PATH, FRAG_SHADER_PATH });
+		if (layout.setLayouts.size() != 2 || layout.setLayouts[0]->getDescriptorSetLayout() != globalSetLayout) {
+			throw std::runtime_error("IndirectRenderSystem shaders do not match the global descriptor set layout!");
+		}
+		if (layout.pushConstantRanges.size() != 1 || layout.pushConstantRanges[0].size != sizeof(MaterialPushConstants)) {
+			throw std::runtime_error("IndirectRenderSystem shaders do not match MaterialPushConstants!");
+		}
+		objectSetLayout = layout.setLayouts[1];
+		pipelineLayout = layout.pipelineLayout;
+	}
+
+	void IndirectRenderSystem::createPipelines(VkRenderPass renderPass, VortexPipelineRegistry& pipelines) {
+		cullPipeline = pipelines.getComputePipeline(CULL_SHADER_PATH, cullPipelineLayout);
+
+		VortexPipeline::defaultPipelineConfigInfo(
+			pipelineConfig
+		);
+
+		pipelineConfig.renderPass = renderPass;
+		pipelineConfig.pipelineLayout = pipelineLayout;
+		vortexPipeline = pipelines.getPipeline(
+			VERT_SHADER_PATH,
+			fragShaderPath,
+			pipelineConfig
+		);
+		defaultVariant = RenderSystem::makeVariantKey(MaterialComponent{});
+	}
+
+	VortexPipeline* IndirectRenderSystem::getVariantPipeline(uint32_t variant) {
+		if (variant == defaultVariant) {
+			return vortexPipeline.get();
+		}
+
+		auto it = variantPipelines.find(variant);
+		if (it == variantPipelines.end()) {
+			PipelineConfigInfo variantConfig{};
+			VortexPipeline::copyPipelineConfigInfo(pipelineConfig, variantConfig);
+			variantConfig.specialization = RenderSystem::makeSpecialization(variant);
+
+			it = variantPipelines.emplace(variant, pipelineRegistry.getPipelineAsync(
+				VERT_SHADER_PATH,
+				fragShaderPath,
+				variantConfig,
+				vortexPipeline
+			)).first;
+		}
+
+		VortexPipeline* pipeline = it->second.get();
+		return pipeline ? pipeline : vortexPipeline.get();
+	}
+
+	void IndirectRenderSystem::setEntities(VortexWorld& world, const VortexTransformStore& transforms) {
+		auto& modelComponents = world.getPool<ModelComponent>();
+		auto& materials = world.getPool<MaterialComponent>();
+
+		// (variant, opacity, model, entity index), sorted so every draw of a variant is adjacent
+		std::vector<std::tuple<uint32_t, float, VortexModel*, uint32_t>> drawList;
+		drawList.reserve(modelComponents.size());
+		world.each<TransformComponent, ModelComponent>([&](VortexEntity entity, TransformComponent&, ModelComponent& model) {
+			if (model.model && model.model->isIndexed()) {
+				uint32_t variant = defaultVariant;
+				float opacity = 1.0f;
+				if (const MaterialComponent* material = materials.tryGet(entity.index)) {
+					variant = RenderSystem::makeVariantKey(*material);
+					// in bindless mode it is per object data, so it doesn't split draws
+					opacity = bindlessTable ? 1.0f : material->getDrawOpacity();
+				}
+				drawList.emplace_back(variant, opacity, model.model.get(), entity.index);
+			}
+		});
+		std::sort(drawList.begin(), drawList.end());
+
+		if (bindlessMaterials) {
+			bindlessMaterials->clear();
+		}
+
+		objects.clear();
+		drawTemplates.clear();
+		drawBatches.clear();
+		models.clear();
+		objects.reserve(drawList.size());
+		objectIndices.assign(world.getEntityCapacity(), NO_OBJECT);
+
+		// one draw per variant, opacity and model, its instances occupy
+		// [firstInstance, firstInstance + objects drawn by it)
+		for (size_t first = 0; first < drawList.size();) {
+			auto [variant, opacity, model, firstEntity] = drawList[first];
+			uint32_t drawIndex = static_cast<uint32_t>(drawTemplates.size());
+
+			size_t last = first;
+			for (; last < drawList.size() && std::get<0>(drawList[last]) == variant &&
+				std::get<1>(drawList[last]) == opacity && std::get<2>(drawList[last]) == model; last++) {
+				uint32_t entityIndex = std::get<3>(drawList[last]);
+
+				ObjectData object{};
+				object.modelMatrix = transforms.getModelMatrix(entityIndex);
+				object.normalMatrix = transforms.getNormalMatrix(entityIndex);
+				object.boundingSphere = model->getBoundingSphere();
+				object.drawIndex = drawIndex;
+				if (bindlessMaterials) {
+					object.materialIndex = bindlessMaterials->add(materials.tryGet(entityIndex));
+				}
+				objectIndices[entityIndex] = static_cast<uint32_t>(objects.size());
+				objects.push_back(object);
+			}
+
+			VkDrawIndexedIndirectCommand command{};
+			command.indexCount = model->getIndexCount();
+			command.instanceCount = 0;  // filled in by the cull pass
+			command.firstIndex = model->getFirstIndex();
+			command.vertexOffset = static_cast<int32_t>(model->getFirstVertex());
+			command.firstInstance = static_cast<uint32_t>(first);
+			drawTemplates.push_back(command);
+			models.push_back(modelComponents.get(firstEntity).model);
+
+			if (drawBatches.empty() || drawBatches.back().variant != variant || drawBatches.back().opacity != opacity ||
+				!model->sharesBindingsWith(*drawBatches.back().model)) {
+				drawBatches.push_back({ variant, opacity, model, drawIndex, 0 });
+				// request the compile now rather than at the first draw
+				getVariantPipeline(variant);
+			}
+			drawBatches.back().drawCount++;
+
+			first = last;
+		}
+
+		sceneVersion++;
+	}
+
+	void IndirectRenderSystem::updateTransforms(const VortexTransformStore& transforms) {
+		for (uint32_t entityIndex : transforms.getUpdatedIndices()) {
+			if (entityIndex >= objectIndices.size() || objectIndices[entityIndex] == NO_OBJECT) {
+				continue;
+			}
+
+			uint32_t object = objectIndices[entityIndex];
+			objects[object].modelMatrix = transforms.getModelMatrix(entityIndex);
+			objects[object].normalMatrix = transforms.getNormalMatrix(entityIndex);
+
+			for (auto& frame : frames) {
+				// slots behind on the snapshot upload all of it anyway
+				if (frame.sceneVersion == sceneVersion && !frame.objectDirty[object]) {
+					frame.objectDirty[object] = 1;
+					frame.dirtyObjects.push_back(object);
+				}
+			}
+		}
+	}
+
+	std::unique_ptr<VortexBuffer> IndirectRenderSystem::createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags extraUsage) {
+		return std::make_unique<VortexBuffer>(
+			vortexDevice,
+			size,
+			1,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | extraUsage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void IndirectRenderSystem::prepareFrame(FrameResources& frame, int frameIndex) {
+		if (frame.sceneVersion == sceneVersion) {
+			uploadDirtyObjects(frame);
+			return;
+		}
+
+		// this frame slot's previous submission has completed, so its buffers can be replaced
+
+		VkDeviceSize objectBytes = std::max<size_t>(objects.size(), 1) * sizeof(ObjectData);
+		if (!frame.objectBuffer || frame.objectBuffer->getBufferSize() < objectBytes) {
+			// grow geometrically so a streaming scene doesn't reallocate on every new model
+			VkDeviceSize capacity = std::max<size_t>(objects.size() + objects.size() / 2, 1);
+			frame.objectBuffer = createStorageBuffer(capacity * sizeof(ObjectData), 0);
+			frame.instanceBuffer = createStorageBuffer(capacity * sizeof(uint32_t), 0);
+		}
+
+		VkDeviceSize drawBytes = std::max<size_t>(drawTemplates.size(), 1) * sizeof(VkDrawIndexedIndirectCommand);
+		if (!frame.drawBuffer || frame.drawBuffer->getBufferSize() < drawBytes) {
+			VkDeviceSize capacity = std::max<size_t>(drawTemplates.size() + drawTemplates.size() / 2, 1);
+			frame.templateBuffer = createStorageBuffer(capacity * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+			frame.drawBuffer = createStorageBuffer(capacity * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+		}
+
+		auto& uploadQueue = vortexDevice.uploadQueue();
+		if (!objects.empty()) {
+			uploadQueue.uploadToBuffer(frame.objectBuffer->getBuffer(), objects.data(), objects.size() * sizeof(ObjectData));
+			uploadQueue.uploadToBuffer(
+				frame.templateBuffer->getBuffer(),
+				drawTemplates.data(),
+				drawTemplates.size() * sizeof(VkDrawIndexedIndirectCommand));
+		}
+
+		if (bindlessMaterials) {
+			frame.materialBuffer = bindlessMaterials->upload(frameIndex);
+		}
+
+		frame.models = models;
+		frame.sceneVersion = sceneVersion;
+		frame.dirtyObjects.clear();
+		frame.objectDirty.assign(objects.size(), 0);
+	}
+
+	void IndirectRenderSystem::writeDescriptorSets(FrameResources& frame, FrameInfo& frameInfo) {
+		// transient, the allocator releases them when this frame slot comes around again
+		frame.cullDescriptorSet = frameInfo.descriptorAllocator.allocateTransient(
+			frameInfo.frameIndex, cullSetLayout->getDescriptorSetLayout());
+		frame.objectDescriptorSet = frameInfo.descriptorAllocator.allocateTransient(
+			frameInfo.frameIndex, objectSetLayout->getDescriptorSetLayout());
+
+		auto objectInfo = frame.objectBuffer->descriptorInfo();
+		auto drawInfo = frame.drawBuffer->descriptorInfo();
+		auto instanceInfo = frame.instanceBuffer->descriptorInfo();
+
+		VortexDescriptorWriter{ *cullSetLayout }
+			.writeBuffer(0, &objectInfo)
+			.writeBuffer(1, &drawInfo)
+			.writeBuffer(2, &instanceInfo)
+			.overwrite(frame.cullDescriptorSet);
+
+		VortexDescriptorWriter{ *objectSetLayout }
+			.writeBuffer(0, &objectInfo)
+			.writeBuffer(1, &instanceInfo)
+			.overwrite(frame.objectDescriptorSet);
+	}
+
+	void IndirectRenderSystem::uploadDirtyObjects(FrameResources& frame) {
+		if (frame.dirtyObjects.empty()) {
+			return;
+		}
+
+		// one copy per run of adjacent objects, objects of a model are adjacent
+		std::sort(frame.dirtyObjects.begin(), frame.dirtyObjects.end());
+		auto& uploadQueue = vortexDevice.uploadQueue();
+		for (size_t first = 0; first < frame.dirtyObjects.size();) {
+			size_t last = first + 1;
+			while (last < frame.dirtyObjects.size() && frame.dirtyObjects[last] == frame.dirtyObjects[last - 1] + 1) {
+				last++;
+			}
+
+			uint32_t firstObject = frame.dirtyObjects[first];
+			uploadQueue.uploadToBuffer(
+				frame.objectBuffer->getBuffer(),
+				&objects[firstObject],
+				(last - first) * sizeof(ObjectData),
+				static_cast<VkDeviceSize>(firstObject) * sizeof(ObjectData));
+			first = last;
+		}
+
+		for (uint32_t object : frame.dirtyObjects) {
+			frame.objectDirty[object] = 0;
+		}
+		frame.dirtyObjects.clear();
+	}
+
+	void IndirectRenderSystem::cull(FrameInfo& frameInfo) {
+		auto& frame = frames[frameInfo.frameIndex];
+		prepareFrame(frame, frameInfo.frameIndex);
+		writeDescriptorSets(frame, frameInfo);
+
+		if (objects.empty()) {
+			return;
+		}
+
+		VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+
+		// start every draw from zero instances
+		VkBufferCopy resetRegion{};
+		resetRegion.size = drawTemplates.size() * sizeof(VkDrawIndexedIndirectCommand);
+		vkCmdCopyBuffer(commandBuffer, frame.templateBuffer->getBuffer(), frame.drawBuffer->getBuffer(), 1, &resetRegion);
+
+		VkMemoryBarrier resetBarrier{};
+		resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1,
+			&resetBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr
+		);
+
+		cullPipeline->bind(commandBuffer);
+		vkCmdBindDescriptorSets(
+			commandBuffer,
+			VK_PIPELINE_BIND_POINT_COMPUTE,
+			cullPipelineLayout,
+			0,
+			1,
+			&frame.cullDescriptorSet,
+			0,
+			nullptr
+		);
+
+		CullPushConstants push{};
+		auto frustumPlanes = frameInfo.camera.getFrustumPlanes();
+		std::copy(frustumPlanes.begin(), frustumPlanes.end(), push.frustumPlanes);
+		push.objectCount = static_cast<uint32_t>(objects.size());
+		vkCmdPushConstants(commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &push);
+
+		vkCmdDispatch(commandBuffer, (push.objectCount + CULL_WORKGROUP_SIZE - 1) / CULL_WORKGROUP_SIZE, 1, 1);
+
+		VkMemoryBarrier cullBarrier{};
+		cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(
+			commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			0,
+			1,
+			&cullBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr
+		);
+	}
+
+	void IndirectRenderSystem::render(FrameInfo& frameInfo) {
+		if (objects.empty()) {
+			return;
+		}
+
+		auto& frame = frames[frameInfo.frameIndex];
+		assert(frame.sceneVersion == sceneVersion && "IndirectRenderSystem::cull must run before render!");
+
+		std::array<VkDescriptorSet, 2> descriptorSets{ frameInfo.globalDescriptorSet, frame.objectDescriptorSet };
+		vkCmdBindDescriptorSets(
+			frameInfo.commandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			pipelineLayout,
+			0,
+			static_cast<uint32_t>(descriptorSets.size()),
+			descriptorSets.data(),
+			0,
+			nullptr
+		);
+
+		const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+		const uint32_t maxDrawsPerCall = vortexDevice.enabledFeatures.multiDrawIndirect
+			? vortexDevice.properties.limits.maxDrawIndirectCount
+			: 1;
+
+		// materials come from the bindless table, one push covers every draw
+		if (bindlessTable) {
+			VkDescriptorSet bindlessSet = bindlessTable->getDescriptorSet();
+			vkCmdBindDescriptorSets(
+				frameInfo.commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
+				pipelineLayout,
+				2,
+				1,
+				&bindlessSet,
+				0,
+				nullptr
+			);
+
+			BindlessPushConstants push{};
+			push.materialBuffer = frame.materialBuffer;
+			vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BindlessPushConstants), &push);
+		}
+
+		// every variant shares pipelineLayout, so the sets stay bound across pipeline changes
+		VortexPipeline* boundPipeline = nullptr;
+		VortexModel* boundModel = nullptr;
+		// nothing to push per draw in bindless mode, where every opacity is 1
+		float pushedOpacity = bindlessTable ? 1.0f : -1.0f;
+
+		for (auto& batch : drawBatches) {
+			VortexPipeline* pipeline = getVariantPipeline(batch.variant);
+			if (pipeline != boundPipeline) {
+				pipeline->bind(frameInfo.commandBuffer);
+				boundPipeline = pipeline;
+			}
+			if (batch.opacity != pushedOpacity) {
+				MaterialPushConstants material{};
+				material.opacity = batch.opacity;
+				vkCmdPushConstants(frameInfo.commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(MaterialPushConstants), &material);
+				pushedOpacity = batch.opacity;
+			}
+			if (!boundModel || !batch.model->sharesBindingsWith(*boundModel)) {
+				batch.model->bind(frameInfo.commandBuffer);
+				boundModel = batch.model;
+			}
+
+			for (uint32_t drawn = 0; drawn < batch.drawCount;) {
+				uint32_t drawCount = std::min(batch.drawCount - drawn, maxDrawsPerCall);
+				vkCmdDrawIndexedIndirect(
+					frameInfo.commandBuffer,
+					frame.drawBuffer->getBuffer(),
+					static_cast<VkDeviceSize>(batch.firstDraw + drawn) * stride,
+					drawCount,
+					stride
+				);
+				drawn += drawCount;
+			}
+		}
+	}
+}
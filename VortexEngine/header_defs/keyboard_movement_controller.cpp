@@ -2,7 +2,7 @@
 #include <iostream>
 
 namespace VortexEngine {
-	void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, VortexGameObject& gameObject) {
+	void KeyboardMovementController::moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform) {
 		glm::vec3 rotate{ 0 };
 		
 		if (glfwGetKey(window, keys.lookRight) == GLFW_PRESS) {
@@ -22,13 +22,13 @@ namespace VortexEngine {
 		}
 
 		if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
-			gameObject.transform.rotation += lookSpeed * dt * glm::normalize(rotate);
+			transform.rotation += lookSpeed * dt * glm::normalize(rotate);
 		}
 
-		gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-		gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
+		transform.rotation.x = glm::clamp(transform.rotation.x, -1.5f, 1.5f);
+		transform.rotation.y = glm::mod(transform.rotation.y, glm::two_pi<float>());
 
-		float yaw = gameObject.transform.rotation.y;
+		float yaw = transform.rotation.y;
 		const glm::vec3 forwardDir{ sin(yaw), 0.0f, cos(yaw) };
 		const glm::vec3 rightDir{ forwardDir.z, 0.0f, -forwardDir.x };
 		const glm::vec3 upDir{ 0.0f, -1.0f, 0.0f };
@@ -62,7 +62,7 @@ namespace VortexEngine {
 		}
 
 		if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
-			gameObject.transform.translation += lookSpeed * dt * glm::normalize(moveDir);
+			transform.translation += lookSpeed * dt * glm::normalize(moveDir);
 		}
 	}
 }
\ No newline at end of file
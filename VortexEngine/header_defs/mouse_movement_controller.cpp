@@ -1,7 +1,7 @@
 #include "../headers/mouse_movement_controller.h"
 
 namespace VortexEngine {
-	void MouseMovementController::lookAroundInPlaneXZ(GLFWwindow* window, float dt, VortexGameObject& gameObject) {
+	void MouseMovementController::lookAroundInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform) {
 
 		static double lastX{ 0 }, lastY{ 0 };
 		double xPos{}, yPos{};
@@ -22,7 +22,7 @@ namespace VortexEngine {
 
 			rotate.x = glm::clamp(rotate.x, -glm::radians(89.0f), glm::radians(89.0f));
 
-			gameObject.transform.rotation += rotate;
+			transform.rotation += rotate;
 		}
 		else {
 			GLFWcursor* cursor = glfwCreateStandardCursor(GLFW_ARROW_CURSOR);
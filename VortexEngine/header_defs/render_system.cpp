@@ -1,97 +1,425 @@
 #include "../headers/render_system.h"
+#include "../headers/vortex_swap_chain.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include <algorithm>
 #include <stdexcept>
 #include <array>
+#include <tuple>
 
 namespace VortexEngine {
 
-	struct SimplePushConstantData {
-		glm::mat4 modelMatrix{ 1.0f };
-		glm::mat4 normalMatrix{ 1.0f };
-	};
+	VkVertexInputBindingDescription RenderSystem::InstanceData::getBindingDescription() {
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 1;
+		bindingDescription.stride = sizeof(InstanceData);
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 
-	RenderSystem::RenderSystem(VortexDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : vortexDevice{ device } {
-		createPipelineLayout(globalSetLayout);
-		createPipeline(renderPass);
+		return bindingDescription;
 	}
 
-	RenderSystem::~RenderSystem() {
-		vkDestroyPipelineLayout(vortexDevice.device(), pipelineLayout, nullptr);
-	}
+	std::vector<VkVertexInputAttributeDescription> RenderSystem::InstanceData::getAttributeDescriptions() {
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 
-	void RenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-		VkPushConstantRange pushConstantRange{};
-		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-		pushConstantRange.offset = 0;
-		pushConstantRange.size = sizeof(SimplePushConstantData);
+		// a mat4 attribute takes one location per column
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions.push_back({
+				4 + column,
+				1,
+				VK_FORMAT_R32G32B32A32_SFLOAT,
+				static_cast<uint32_t>(offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4)) });
+		}
+		for (uint32_t column = 0; column < 4; column++) {
+			attributeDescriptions.push_back({
+				8 + column,
+				1,
+				VK_FORMAT_R32G32B32A32_SFLOAT,
+				static_cast<uint32_t>(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4)) });
+		}
+		attributeDescriptions.push_back({
+			12,
+			1,
+			VK_FORMAT_R32_UINT,
+			static_cast<uint32_t>(offsetof(InstanceData, materialIndex)) });
 
-		std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout };
+		return attributeDescriptions;
+	}
 
-		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
-		pipelineLayoutInfo.pushConstantRangeCount = 1;
-		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
-		if (vkCreatePipelineLayout(vortexDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create pipeline layout!");
+	RenderSystem::RenderSystem(VortexDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+		VortexPipelineRegistry& pipelines, VortexJobSystem& jobs, VortexBindlessTable* bindless)
+		: vortexDevice{ device }, pipelineRegistry{ pipelines }, jobSystem{ jobs }, bindlessTable{ bindless },
+		fragShaderPath{ bindless ? BINDLESS_FRAG_SHADER_PATH : FRAG_SHADER_PATH } {
+		if (bindlessTable) {
+			bindlessMaterials = std::make_unique<VortexBindlessMaterials>(vortexDevice, *bindlessTable);
 		}
+		createPipeline(renderPass, globalSetLayout);
 	}
 
-	void RenderSystem::createPipeline(VkRenderPass renderPass) {
-		assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout!");
+	RenderSystem::~RenderSystem() {}
+
+	void RenderSystem::createPipeline(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) {
+		if (bindlessTable) {
+			pipelineLayout = createBindlessPipelineLayout(globalSetLayout);
+		}
+		else {
+			auto layout = pipelineRegistry.getReflectedLayout({ VERT_SHADER_PATH, FRAG_SHADER_PATH });
+
+			// the renderer binds set 0 and pushes MaterialPushConstants, the shaders have to agree
+			if (layout.setLayouts.size() != 1 || layout.setLayouts[0]->getDescriptorSetLayout() != globalSetLayout) {
+				throw std::runtime_error("RenderSystem shaders do not match the global descriptor set layout!");
+			}
+			if (layout.pushConstantRanges.size() != 1 ||
+				layout.pushConstantRanges[0].stageFlags != VK_SHADER_STAGE_FRAGMENT_BIT ||
+				layout.pushConstantRanges[0].offset != 0 ||
+				layout.pushConstantRanges[0].size != sizeof(MaterialPushConstants)) {
+				throw std::runtime_error("RenderSystem shaders do not match MaterialPushConstants!");
+			}
+
+			pipelineLayout = layout.pipelineLayout;
+		}
 
-		PipelineConfigInfo pipelineConfig{};
 		VortexPipeline::defaultPipelineConfigInfo(
 			pipelineConfig
 		);
 
+		pipelineConfig.bindingDescriptions.push_back(InstanceData::getBindingDescription());
+		auto instanceAttributes = InstanceData::getAttributeDescriptions();
+		pipelineConfig.attributeDescriptions.insert(
+			pipelineConfig.attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+
 		pipelineConfig.renderPass = renderPass;
 		pipelineConfig.pipelineLayout = pipelineLayout;
-		vortexPipeline = std::make_unique<VortexPipeline>(
-			vortexDevice,
-			"shaders/default.vert.spv",
-			"shaders/default.frag.spv",
-			pipelineConfig
-		);
+
+		// the fallback of every other variant, so start it right away
+		defaultVariant = makeVariantKey(MaterialComponent{});
+		getVariantPipeline(defaultVariant);
+	}
+
+	VkPipelineLayout RenderSystem::createBindlessPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
+		// getReflectedLayout rejects the runtime sized arrays of set 2, so only check the
+		// reflection against the table's layout and build the pipeline layout from that
+		auto vertShader = pipelineRegistry.getShaderModule(VERT_SHADER_PATH);
+		auto fragShader = pipelineRegistry.getShaderModule(BINDLESS_FRAG_SHADER_PATH);
+		auto layout = VortexShaderReflection::mergeLayouts({ &vertShader->getReflection(), &fragShader->getReflection() });
+
+		if (layout.sets.size() != 3 || !layout.sets[1].empty() ||
+			pipelineRegistry.getDescriptorSetLayout(layout.sets[0])->getDescriptorSetLayout() != globalSetLayout) {
+			throw std::runtime_error("RenderSystem bindless shaders do not match the global descriptor set layout!");
+		}
+		if (!bindlessTable->isCompatible(layout.sets[2])) {
+			throw std::runtime_error("RenderSystem bindless shaders do not match the bindless table!");
+		}
+		if (layout.pushConstantRanges.size() != 1 ||
+			layout.pushConstantRanges[0].stageFlags != VK_SHADER_STAGE_FRAGMENT_BIT ||
+			layout.pushConstantRanges[0].offset != 0 ||
+			layout.pushConstantRanges[0].size != sizeof(BindlessPushConstants)) {
+			throw std::runtime_error("RenderSystem bindless shaders do not match BindlessPushConstants!");
+		}
+
+		emptySetLayout = pipelineRegistry.getDescriptorSetLayout({});
+		return pipelineRegistry.getPipelineLayout(
+			{ globalSetLayout, emptySetLayout->getDescriptorSetLayout(), bindlessTable->getDescriptorSetLayout() },
+			layout.pushConstantRanges);
+	}
+
+	uint32_t RenderSystem::makeVariantKey(const MaterialComponent& material) {
+		return static_cast<uint32_t>(material.lighting)
+			| (material.vertexNormals ? 1u << 2 : 0u)
+			| (material.alphaTest ? 1u << 3 : 0u);
+	}
+
+	ShaderSpecialization RenderSystem::makeSpecialization(uint32_t variant) {
+		// constant ids of shaders/default.frag
+		ShaderSpecialization specialization{};
+		specialization.set(0, static_cast<int32_t>(variant & 3u));
+		specialization.set(1, (variant & (1u << 2)) != 0);
+		specialization.set(2, (variant & (1u << 3)) != 0);
+		return specialization;
+	}
+
+	VortexPipeline* RenderSystem::getVariantPipeline(uint32_t variant) {
+		auto it = variantPipelines.find(variant);
+		if (it == variantPipelines.end()) {
+			PipelineConfigInfo variantConfig{};
+			VortexPipeline::copyPipelineConfigInfo(pipelineConfig, variantConfig);
+			variantConfig.specialization = makeSpecialization(variant);
+
+			it = variantPipelines.emplace(variant, pipelineRegistry.getPipelineAsync(
+				VERT_SHADER_PATH,
+				fragShaderPath,
+				variantConfig
+			)).first;
+		}
+
+		if (VortexPipeline* pipeline = it->second.get()) {
+			return pipeline;
+		}
+		return variant == defaultVariant ? nullptr : variantPipelines[defaultVariant].get();
+	}
+
+	void RenderSystem::renderGameObjects(FrameInfo &frameInfo, VortexWorld& world, const VortexTransformStore& transforms,
+		const VortexBVH* sceneBVH) {
+		prepareDraws(frameInfo, world, transforms, sceneBVH);
+		recordDraws(frameInfo.commandBuffer, frameInfo.globalDescriptorSet, 0, drawBatches.size());
+		cullStats.recordingThreads = 1;
+	}
+
+	void RenderSystem::renderGameObjectsParallel(FrameInfo& frameInfo, VortexWorld& world, const VortexTransformStore& transforms,
+		VortexRenderer& renderer, const VortexBVH* sceneBVH) {
+		prepareDraws(frameInfo, world, transforms, sceneBVH);
+
+		// small scenes are cheaper to record on one thread than to hand out
+		size_t wantedWorkers = (drawBatches.size() + MIN_BATCHES_PER_WORKER - 1) / MIN_BATCHES_PER_WORKER;
+		uint32_t workerCount = static_cast<uint32_t>(std::clamp<size_t>(wantedWorkers, 1, renderer.getWorkerCount()));
+		cullStats.recordingThreads = workerCount;
+
+		// contiguous batch ranges keep the draws in the same order as a single buffer would
+		secondaryCommandBuffers.resize(workerCount);
+		auto recordRange = [&](uint32_t worker) {
+			size_t firstBatch = drawBatches.size() * worker / workerCount;
+			size_t lastBatch = drawBatches.size() * (worker + 1) / workerCount;
+
+			VkCommandBuffer commandBuffer = renderer.beginSecondaryCommandBuffer(worker);
+			recordDraws(commandBuffer, frameInfo.globalDescriptorSet, firstBatch, lastBatch);
+			renderer.endSecondaryCommandBuffer(commandBuffer);
+			secondaryCommandBuffers[worker] = commandBuffer;
+		};
+
+		jobSystem.parallelFor(workerCount, 1, [&recordRange](size_t first, size_t last) {
+			for (size_t worker = first; worker < last; worker++) {
+				recordRange(static_cast<uint32_t>(worker));
+			}
+		});
+
+		renderer.executeSecondaryCommandBuffers(frameInfo.commandBuffer, secondaryCommandBuffers);
+	}
+
+	void RenderSystem::prepareDraws(FrameInfo& frameInfo, VortexWorld& world, const VortexTransformStore& transforms,
+		const VortexBVH* sceneBVH) {
+		cullStats = CullStats{};
+		drawBatches.clear();
+
+		VortexFrustum frustum{ frameInfo.camera.getFrustumPlanes() };
+
+		candidates.clear();
+		drawList.clear();
+		if (bindlessMaterials) {
+			bindlessMaterials->clear();
+		}
+
+		// entities without a MaterialComponent use the default variant
+		auto& materials = world.getPool<MaterialComponent>();
+		auto addDraw = [&](VortexModel* model, uint32_t entityIndex, size_t candidate) {
+			DrawItem item{ defaultVariant, 1.0f, model, 0, candidate };
+			const MaterialComponent* material = materials.tryGet(entityIndex);
+			if (material) {
+				item.variant = makeVariantKey(*material);
+				item.opacity = material->getDrawOpacity();
+			}
+
+			if (bindlessMaterials) {
+				// per instance data now, so it no longer splits batches
+				item.material = bindlessMaterials->add(material);
+				item.opacity = 1.0f;
+			}
+			drawList.push_back(item);
+		};
+
+		if (sceneBVH) {
+			visibleObjects.clear();
+			sceneBVH->queryFrustum(frustum, visibleObjects);
+
+			for (uint32_t entityIndex : visibleObjects) {
+				VortexEntity entity = world.getEntity(entityIndex);
+				auto* model = world.tryGetComponent<ModelComponent>(entity);
+				if (!model || !model->model || !world.hasComponent<TransformComponent>(entity)) {
+					continue;
+				}
+
+				addDraw(model->model.get(), entityIndex, candidates.size());
+				candidates.push_back(entityIndex);
+			}
+
+			cullStats.objects = sceneBVH->getItemCount();
+		}
+		else {
+			candidateModels.clear();
+			world.each<TransformComponent, ModelComponent>([this](VortexEntity entity, TransformComponent&, ModelComponent& model) {
+				if (model.model) {
+					candidates.push_back(entity.index);
+					candidateModels.push_back(model.model.get());
+				}
+			});
+
+			worldSpheres.resize(candidates.size());
+			visibility.resize(candidates.size());
+			jobSystem.parallelFor(candidates.size(), CULL_GRAIN, [&](size_t first, size_t last) {
+				for (size_t i = first; i < last; i++) {
+					worldSpheres[i] = transformSphere(candidateModels[i]->getBoundingSphere(), transforms.getModelMatrix(candidates[i]));
+				}
+				frustum.cullSpheres(worldSpheres.data() + first, last - first, visibility.data() + first);
+			});
+
+			for (size_t i = 0; i < candidates.size(); i++) {
+				if (visibility[i]) {
+					addDraw(candidateModels[i], candidates[i], i);
+				}
+			}
+
+			cullStats.objects = static_cast<uint32_t>(candidates.size());
+		}
+
+		cullStats.drawn = static_cast<uint32_t>(drawList.size());
+		cullStats.culled = cullStats.objects - cullStats.drawn;
+
+		if (drawList.empty()) {
+			return;
+		}
+
+		// group objects by variant, then by model, so each model becomes one instanced draw per
+		// variant and every variant binds its pipeline once
+		std::sort(drawList.begin(), drawList.end(), [](const DrawItem& a, const DrawItem& b) {
+			return std::tie(a.variant, a.opacity, a.model, a.candidate) < std::tie(b.variant, b.opacity, b.model, b.candidate);
+		});
+
+		VortexBuffer& instanceBuffer = getInstanceBuffer(frameInfo.frameIndex, drawList.size());
+		auto* instances = static_cast<InstanceData*>(instanceBuffer.getMappedMemory());
+		jobSystem.parallelFor(drawList.size(), CULL_GRAIN, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				uint32_t object = candidates[drawList[i].candidate];
+				instances[i].modelMatrix = transforms.getModelMatrix(object);
+				instances[i].normalMatrix = transforms.getNormalMatrix(object);
+				instances[i].materialIndex = drawList[i].material;
+			}
+		});
+
+		currentInstanceBuffer = instanceBuffer.getBuffer();
+		if (bindlessMaterials) {
+			currentMaterialBuffer = bindlessMaterials->upload(frameInfo.frameIndex);
+		}
+
+		// one draw per run of the same variant, opacity and model
+		VortexPipeline* previousPipeline = nullptr;
+		for (size_t first = 0; first < drawList.size();) {
+			const DrawItem& item = drawList[first];
+
+			size_t last = first + 1;
+			while (last < drawList.size() && drawList[last].variant == item.variant &&
+				drawList[last].opacity == item.opacity && drawList[last].model == item.model) {
+				last++;
+			}
+
+			// variants resolve once per run rather than once per object
+			VortexPipeline* pipeline = (first == 0 || drawList[first - 1].variant != item.variant)
+				? getVariantPipeline(item.variant)
+				: previousPipeline;
+			previousPipeline = pipeline;
+
+			// nothing to draw with until the default variant has compiled
+			if (pipeline) {
+				if (drawBatches.empty() || drawBatches.back().pipeline != pipeline) {
+					cullStats.pipelineBinds++;
+				}
+				drawBatches.push_back({ pipeline, item.opacity, item.model, static_cast<uint32_t>(first), static_cast<uint32_t>(last - first) });
+			}
+			first = last;
+		}
+		cullStats.drawCalls = static_cast<uint32_t>(drawBatches.size());
 	}
 
-	void RenderSystem::renderGameObjects(FrameInfo &frameInfo, std::vector<VortexGameObject>& gameObjects) {
-		vortexPipeline->bind(frameInfo.commandBuffer);
+	void RenderSystem::recordDraws(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, size_t firstBatch, size_t lastBatch) const {
+		if (firstBatch == lastBatch) {
+			return;
+		}
 
+		// every variant shares pipelineLayout, so the sets stay bound across pipeline changes
 		vkCmdBindDescriptorSets(
-			frameInfo.commandBuffer,
+			commandBuffer,
 			VK_PIPELINE_BIND_POINT_GRAPHICS,
 			pipelineLayout,
 			0,
 			1,
-			&frameInfo.globalDescriptorSet,
+			&globalDescriptorSet,
 			0,
 			nullptr
 		);
 
-		for (auto& obj : gameObjects) {
-			SimplePushConstantData push{};
-
-			push.modelMatrix = obj.transform.mat4();
-			push.normalMatrix = obj.transform.normalMatrix();
-
-			vkCmdPushConstants(
-				frameInfo.commandBuffer,
+		// materials come from the bindless table, one push covers every draw
+		if (bindlessTable) {
+			VkDescriptorSet bindlessSet = bindlessTable->getDescriptorSet();
+			vkCmdBindDescriptorSets(
+				commandBuffer,
+				VK_PIPELINE_BIND_POINT_GRAPHICS,
 				pipelineLayout,
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+				2,
+				1,
+				&bindlessSet,
 				0,
-				sizeof(SimplePushConstantData),
-				&push
+				nullptr
 			);
 
-			obj.model->bind(frameInfo.commandBuffer);
-			obj.model->draw(frameInfo.commandBuffer);
+			BindlessPushConstants push{};
+			push.materialBuffer = currentMaterialBuffer;
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BindlessPushConstants), &push);
+		}
+
+		VkBuffer instanceBuffers[] = { currentInstanceBuffer };
+		VkDeviceSize instanceOffsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 1, 1, instanceBuffers, instanceOffsets);
+
+		// models share a few geometry pool pages, so most draws can reuse the previous bindings
+		VortexModel* boundModel = nullptr;
+		VortexPipeline* boundPipeline = nullptr;
+		// nothing to push per draw in bindless mode, where every opacity is 1
+		float pushedOpacity = bindlessTable ? 1.0f : -1.0f;
+
+		for (size_t batch = firstBatch; batch < lastBatch; batch++) {
+			const DrawBatch& draw = drawBatches[batch];
+			if (draw.pipeline != boundPipeline) {
+				draw.pipeline->bind(commandBuffer);
+				boundPipeline = draw.pipeline;
+			}
+			if (draw.opacity != pushedOpacity) {
+				MaterialPushConstants push{};
+				push.opacity = draw.opacity;
+				vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(MaterialPushConstants), &push);
+				pushedOpacity = draw.opacity;
+			}
+			if (!boundModel || !draw.model->sharesBindingsWith(*boundModel)) {
+				draw.model->bind(commandBuffer);
+				boundModel = draw.model;
+			}
+			draw.model->draw(commandBuffer, draw.instanceCount, draw.firstInstance);
+		}
+	}
+
+	VortexBuffer& RenderSystem::getInstanceBuffer(int frameIndex, size_t instanceCount) {
+		if (instanceBuffers.empty()) {
+			instanceBuffers.resize(VortexSwapChain::MAX_FRAMES_IN_FLIGHT);
 		}
+
+		// the renderer has already waited for this frame's previous submission, so the old buffer
+		// can be replaced safely
+		auto& buffer = instanceBuffers[frameIndex];
+		if (!buffer || buffer->getInstanceCount() < instanceCount) {
+			uint32_t capacity = 1024;
+			while (capacity < instanceCount) {
+				capacity *= 2;
+			}
+
+			buffer = std::make_unique<VortexBuffer>(
+				vortexDevice,
+				sizeof(InstanceData),
+				capacity,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			buffer->map();
+		}
+
+		return *buffer;
 	}
-}
\ No newline at end of file
+}
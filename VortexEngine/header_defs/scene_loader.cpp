@@ -0,0 +1,205 @@
+#include "../headers/scene_loader.h"
+#include "../headers/vortex_upload_queue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+namespace VortexEngine {
+	SceneLoader::SceneLoader(VortexDevice& device, VortexModelRegistry& registry, VortexJobSystem& jobs)
+		: vortexDevice{ device }, modelRegistry{ registry }, jobSystem{ jobs } {}
+
+	SceneLoader::~SceneLoader() {
+		stopLoading();
+	}
+
+	std::vector<VortexEntity> SceneLoader::loadAsync(SceneParser& parser, VortexWorld& world) {
+		assert(isComplete() && "SceneLoader can only load one scene at a time!");
+		reset();
+
+		auto descriptions = parser.parseSceneDescription();
+
+		std::vector<VortexEntity> entities;
+		entities.reserve(descriptions.size());
+
+		std::unordered_map<std::string, size_t> pendingByKey;
+		size_t residentUpFront = 0;
+
+		for (size_t i = 0; i < descriptions.size(); i++) {
+			auto& description = descriptions[i];
+
+			VortexEntity entity = world.createEntity();
+			auto& transform = world.addComponent<TransformComponent>(entity);
+			transform.translation = description.position;
+			transform.scale = description.scale;
+			transform.rotation = description.rotation;
+
+			// models another scene already loaded are usable straight away
+			if (auto model = modelRegistry.acquireModel(description.file)) {
+				world.addComponent<ModelComponent>(entity, std::move(model));
+				residentUpFront++;
+			}
+			else {
+				std::string key = VortexModelRegistry::makeKey(description.file);
+				auto it = pendingByKey.find(key);
+				if (it == pendingByKey.end()) {
+					it = pendingByKey.emplace(key, pendingModels.size()).first;
+					pendingModels.push_back(std::make_unique<PendingModel>());
+					pendingModels.back()->filepath = description.file;
+				}
+
+				PendingModel& pending = *pendingModels[it->second];
+				pending.entities.push_back(entity);
+			}
+
+			entities.push_back(entity);
+		}
+
+		SceneParser::applyHierarchy(descriptions, entities, world);
+		SceneParser::applyMaterials(descriptions, entities, world);
+
+		{
+			std::lock_guard<std::mutex> lock{ readyMutex };
+			objectsTotal = entities.size();
+			objectsResident = residentUpFront;
+		}
+
+		for (size_t i = 0; i < pendingModels.size(); i++) {
+			jobSystem.runBackground([this, i]() { loadPendingModel(i); }, &loadCounter);
+		}
+
+		return entities;
+	}
+
+	void SceneLoader::loadPendingModel(size_t index) {
+		if (stopRequested) {
+			return;
+		}
+
+		PendingModel& pending = *pendingModels[index];
+		try {
+			pending.cachedMesh = VortexMeshCache::load(pending.filepath);
+			if (!pending.cachedMesh) {
+				pending.builder.loadModel(pending.filepath, &jobSystem);
+				VortexMeshCache::store(pending.filepath, pending.builder);
+			}
+		}
+		catch (...) {
+			pending.error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock{ readyMutex };
+			readyModels.push_back(index);
+			modelsParsed++;
+		}
+		readyCondition.notify_one();
+	}
+
+	size_t SceneLoader::uploadReady(VortexWorld& world, size_t maxModels) {
+		size_t becameResident = 0;
+
+		for (size_t uploaded = 0; uploaded < maxModels; uploaded++) {
+			size_t index;
+			{
+				std::lock_guard<std::mutex> lock{ readyMutex };
+				if (readyModels.empty()) {
+					break;
+				}
+				index = readyModels.front();
+				readyModels.pop_front();
+			}
+
+			PendingModel& pending = *pendingModels[index];
+			if (pending.error) {
+				std::rethrow_exception(pending.error);
+			}
+
+			std::shared_ptr<VortexModel> model;
+			if (pending.cachedMesh) {
+				model = std::make_shared<VortexModel>(
+					vortexDevice,
+					pending.cachedMesh->vertices(),
+					pending.cachedMesh->getVertexCount(),
+					pending.cachedMesh->indices(),
+					pending.cachedMesh->getIndexCount(),
+					pending.cachedMesh->getBoundingBox(),
+					pending.cachedMesh->getBoundingSphere());
+			}
+			else {
+				model = std::make_shared<VortexModel>(vortexDevice, pending.builder);
+			}
+			model = modelRegistry.insertModel(pending.filepath, std::move(model));
+
+			// the CPU side copy is no longer needed once the model is resident
+			pending.cachedMesh.reset();
+			pending.builder = VortexModel::Builder{};
+
+			for (size_t i = 0; i < pending.entities.size(); i++) {
+				// every reference past the first is a cache hit, same as a synchronous parseScene
+				auto objectModel = i == 0 ? model : modelRegistry.acquireModel(pending.filepath);
+				if (world.isAlive(pending.entities[i])) {
+					world.addComponent<ModelComponent>(pending.entities[i], std::move(objectModel));
+				}
+			}
+			becameResident += pending.entities.size();
+
+			std::lock_guard<std::mutex> lock{ readyMutex };
+			modelsResident++;
+			objectsResident += pending.entities.size();
+		}
+
+		// submit this batch of uploads together instead of waiting for the next frame
+		if (becameResident > 0) {
+			vortexDevice.uploadQueue().flush();
+		}
+
+		if (becameResident > 0 && isComplete()) {
+			stopLoading();
+		}
+
+		return becameResident;
+	}
+
+	void SceneLoader::waitUntilComplete(VortexWorld& world) {
+		while (!isComplete()) {
+			{
+				std::unique_lock<std::mutex> lock{ readyMutex };
+				readyCondition.wait(lock, [this]() { return !readyModels.empty(); });
+			}
+
+			uploadReady(world);
+		}
+	}
+
+	SceneLoadProgress SceneLoader::getProgress() const {
+		std::lock_guard<std::mutex> lock{ readyMutex };
+
+		SceneLoadProgress progress{};
+		progress.modelsTotal = pendingModels.size();
+		progress.modelsParsed = modelsParsed;
+		progress.modelsResident = modelsResident;
+		progress.objectsTotal = objectsTotal;
+		progress.objectsResident = objectsResident;
+		return progress;
+	}
+
+	void SceneLoader::stopLoading() {
+		stopRequested = true;
+		jobSystem.wait(loadCounter);
+	}
+
+	void SceneLoader::reset() {
+		// every job of the previous load must be gone before its models are
+		stopLoading();
+
+		std::lock_guard<std::mutex> lock{ readyMutex };
+		pendingModels.clear();
+		readyModels.clear();
+		modelsParsed = 0;
+		modelsResident = 0;
+		objectsTotal = 0;
+		objectsResident = 0;
+		stopRequested = false;
+	}
+}
@@ -1,6 +1,8 @@
 #include "../headers/scene_parser.h"
 
 #include <iostream>
+#include <stdexcept>
+#include <unordered_map>
 
 namespace VortexEngine {
 	void SceneParser::init() {
@@ -37,39 +39,174 @@ namespace VortexEngine {
 		}
 	}
 
-	std::vector<VortexGameObject> SceneParser::parseScene(VortexDevice& vortexDevice) {
+	std::vector<SceneObjectDescription> SceneParser::parseSceneDescription() {
 		parsedJsonData = nlohmann::json::parse(fileReadContents);
-		std::vector<VortexGameObject> gameObjects;
+		std::vector<SceneObjectDescription> descriptions;
+		// parent references by name are resolved once every object is known
+		std::vector<std::pair<size_t, std::string>> namedParents;
 
 		for (auto& obj : parsedJsonData["gameObjects"]) {
-			std::string filePath = obj["file"];
-			std::shared_ptr<VortexModel> objectModel = VortexModel::createModelFromFile(vortexDevice, filePath);
+			SceneObjectDescription description{};
+			description.file = obj["file"];
 
-			glm::vec3 position = {
+			if (obj.contains("name")) {
+				description.name = obj["name"];
+			}
+
+			if (obj.contains("parent")) {
+				auto& parent = obj["parent"];
+				if (parent.is_string()) {
+					namedParents.emplace_back(descriptions.size(), parent.get<std::string>());
+				}
+				else {
+					description.parent = parent.get<int32_t>();
+				}
+			}
+
+			description.position = {
 				obj["position"][0],
 				obj["position"][1],
 				obj["position"][2]
 			};
 
-			glm::vec3 scale = {
+			description.scale = {
 				obj["scale"][0],
 				obj["scale"][1],
 				obj["scale"][2]
 			};
 
-			glm::vec3 rotation = {
+			description.rotation = {
 				obj["rotation"][0],
 				obj["rotation"][1],
 				obj["rotation"][2]
 			};
 
-			auto object = VortexGameObject::createGameObject();
-			object.model = objectModel;
-			object.transform.translation = position;
-			object.transform.scale = scale;
-			gameObjects.push_back(std::move(object));
+			if (obj.contains("material")) {
+				description.hasMaterial = true;
+				description.material = parseMaterial(obj["material"]);
+			}
+
+			descriptions.push_back(std::move(description));
+		}
+
+		if (!namedParents.empty()) {
+			std::unordered_map<std::string, int32_t> objectsByName;
+			for (size_t i = 0; i < descriptions.size(); i++) {
+				if (!descriptions[i].name.empty()) {
+					objectsByName.emplace(descriptions[i].name, static_cast<int32_t>(i));
+				}
+			}
+
+			for (auto& [object, parentName] : namedParents) {
+				auto it = objectsByName.find(parentName);
+				if (it == objectsByName.end()) {
+					throw std::runtime_error("Error: Scene file " + filepath + " references unknown parent " + parentName);
+				}
+				descriptions[object].parent = it->second;
+			}
+		}
+
+		for (size_t i = 0; i < descriptions.size(); i++) {
+			int32_t parent = descriptions[i].parent;
+			if (parent != SceneObjectDescription::NO_PARENT &&
+				(parent < 0 || parent >= static_cast<int32_t>(descriptions.size()) || parent == static_cast<int32_t>(i))) {
+				throw std::runtime_error("Error: Scene file " + filepath + " has an invalid parent " + std::to_string(parent));
+			}
+		}
+
+		// walks every parent chain once; reaching an object still on the current chain is a cycle
+		enum class Visit : uint8_t { None, OnChain, Done };
+		std::vector<Visit> visits(descriptions.size(), Visit::None);
+		for (size_t i = 0; i < descriptions.size(); i++) {
+			int32_t object = static_cast<int32_t>(i);
+			while (object != SceneObjectDescription::NO_PARENT && visits[object] == Visit::None) {
+				visits[object] = Visit::OnChain;
+				object = descriptions[object].parent;
+			}
+			if (object != SceneObjectDescription::NO_PARENT && visits[object] == Visit::OnChain) {
+				const std::string& name = descriptions[object].name;
+				throw std::runtime_error("Error: Scene file " + filepath + " has a parent cycle through object " +
+					(name.empty() ? std::to_string(object) : name));
+			}
+
+			object = static_cast<int32_t>(i);
+			while (object != SceneObjectDescription::NO_PARENT && visits[object] == Visit::OnChain) {
+				visits[object] = Visit::Done;
+				object = descriptions[object].parent;
+			}
+		}
+
+		return descriptions;
+	}
+
+	MaterialComponent SceneParser::parseMaterial(const nlohmann::json& materialData) const {
+		MaterialComponent material{};
+
+		if (materialData.contains("lighting")) {
+			std::string lighting = materialData["lighting"];
+			if (lighting == "unlit") {
+				material.lighting = LightingModel::Unlit;
+			}
+			else if (lighting == "lambert") {
+				material.lighting = LightingModel::Lambert;
+			}
+			else if (lighting == "half_lambert") {
+				material.lighting = LightingModel::HalfLambert;
+			}
+			else {
+				throw std::runtime_error("Error: Scene file " + filepath + " uses unknown lighting model " + lighting);
+			}
+		}
+
+		if (materialData.contains("vertexNormals")) {
+			material.vertexNormals = materialData["vertexNormals"];
+		}
+		if (materialData.contains("alphaTest")) {
+			material.alphaTest = materialData["alphaTest"];
+		}
+		if (materialData.contains("opacity")) {
+			material.opacity = materialData["opacity"];
+		}
+
+		return material;
+	}
+
+	void SceneParser::applyMaterials(const std::vector<SceneObjectDescription>& descriptions,
+		const std::vector<VortexEntity>& entities, VortexWorld& world) {
+		for (size_t i = 0; i < descriptions.size(); i++) {
+			if (descriptions[i].hasMaterial) {
+				world.addComponent<MaterialComponent>(entities[i], descriptions[i].material);
+			}
+		}
+	}
+
+	void SceneParser::applyHierarchy(const std::vector<SceneObjectDescription>& descriptions,
+		const std::vector<VortexEntity>& entities, VortexWorld& world) {
+		for (size_t i = 0; i < descriptions.size(); i++) {
+			if (descriptions[i].parent != SceneObjectDescription::NO_PARENT) {
+				world.addComponent<ParentComponent>(entities[i], entities[descriptions[i].parent]);
+			}
+		}
+	}
+
+	std::vector<VortexEntity> SceneParser::parseScene(VortexWorld& world, VortexModelRegistry& modelRegistry) {
+		auto descriptions = parseSceneDescription();
+		std::vector<VortexEntity> entities;
+
+		for (auto& description : descriptions) {
+			VortexEntity entity = world.createEntity();
+
+			auto& transform = world.addComponent<TransformComponent>(entity);
+			transform.translation = description.position;
+			transform.scale = description.scale;
+			transform.rotation = description.rotation;
+
+			world.addComponent<ModelComponent>(entity, modelRegistry.getModel(description.file));
+			entities.push_back(entity);
 		}
 
-		return gameObjects;
+		applyHierarchy(descriptions, entities, world);
+		applyMaterials(descriptions, entities, world);
+		return entities;
 	}
 }
\ No newline at end of file
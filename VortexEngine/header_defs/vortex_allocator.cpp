@@ -0,0 +1,248 @@
+#include "../headers/vortex_allocator.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace VortexEngine {
+
+    struct VortexMemoryBlock {
+        VortexMemoryBlock(VkDeviceSize size) : ranges{ size } {}
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        uint32_t memoryTypeIndex = 0;
+        uint32_t poolIndex = 0;
+        VortexOffsetAllocator ranges;
+    };
+
+    VortexAllocator::VortexAllocator(
+        VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize preferredBlockSize)
+        : device{ device }, preferredBlockSize{ preferredBlockSize } {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        bufferImageGranularity = properties.limits.bufferImageGranularity;
+        nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+
+        for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+            pools[i][0].memoryTypeIndex = i;
+            pools[i][1].memoryTypeIndex = i;
+        }
+    }
+
+    VortexAllocator::~VortexAllocator() {
+        assert(allocationCount == 0 && "Destroying allocator with live allocations");
+
+        for (auto& memoryTypePools : pools) {
+            for (auto& pool : memoryTypePools) {
+                for (auto& block : pool.blocks) {
+                    freeMemory(block->memory, block->mapped);
+                }
+            }
+        }
+    }
+
+    uint32_t VortexAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    VortexAllocation VortexAllocator::allocate(
+        const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceType type) {
+        uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+        VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+        VkDeviceSize size = requirements.size;
+        VkDeviceSize alignment = requirements.alignment;
+
+        // flush / invalidate ranges must be whole atoms, so keep non coherent allocations atom aligned
+        if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            alignment = std::max(alignment, nonCoherentAtomSize);
+            size = (size + nonCoherentAtomSize - 1) & ~(nonCoherentAtomSize - 1);
+        }
+
+        std::lock_guard<std::mutex> lock{ mutex };
+
+        VkDeviceSize blockSize = getBlockSize(memoryTypeIndex);
+        if (size > blockSize / 2) {
+            return allocateDedicated(memoryTypeIndex, size);
+        }
+
+        Pool& pool = getPool(memoryTypeIndex, type);
+
+        VortexAllocation allocation{};
+        for (auto& block : pool.blocks) {
+            if (allocateFromBlock(*block, size, alignment, allocation)) {
+                return allocation;
+            }
+        }
+
+        auto block = std::make_unique<VortexMemoryBlock>(blockSize);
+        block->memory = allocateMemory(memoryTypeIndex, blockSize, &block->mapped);
+        block->memoryTypeIndex = memoryTypeIndex;
+        block->poolIndex = static_cast<uint32_t>(&pool - pools[memoryTypeIndex]);
+        pool.blocks.push_back(std::move(block));
+
+        if (!allocateFromBlock(*pool.blocks.back(), size, alignment, allocation)) {
+            throw std::runtime_error("failed to sub-allocate from a new memory block!");
+        }
+        return allocation;
+    }
+
+    void VortexAllocator::free(VortexAllocation& allocation) {
+        if (!allocation.isValid()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock{ mutex };
+
+        liveBytes -= allocation.size;
+        allocationCount--;
+
+        VortexMemoryBlock* block = allocation.block;
+        if (block == nullptr) {
+            freeMemory(allocation.memory, allocation.mapped);
+            dedicatedBytes -= allocation.size;
+            dedicatedAllocationCount--;
+            allocation = VortexAllocation{};
+            return;
+        }
+
+        block->ranges.free(allocation.range);
+        allocation = VortexAllocation{};
+
+        // keep one empty block around per pool so a load / unload cycle doesn't hit the driver every
+        // time, any further empty block goes back to the driver
+        if (!block->ranges.isEmpty()) {
+            return;
+        }
+
+        Pool& pool = pools[block->memoryTypeIndex][block->poolIndex];
+        bool otherEmptyBlock = std::any_of(pool.blocks.begin(), pool.blocks.end(), [block](const auto& candidate) {
+            return candidate.get() != block && candidate->ranges.isEmpty();
+        });
+        if (otherEmptyBlock) {
+            auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(), [block](const auto& candidate) {
+                return candidate.get() == block;
+            });
+            assert(it != pool.blocks.end() && "Memory block not owned by its pool");
+
+            freeMemory(block->memory, block->mapped);
+            pool.blocks.erase(it);
+        }
+    }
+
+    VortexAllocator::Stats VortexAllocator::getStats() const {
+        std::lock_guard<std::mutex> lock{ mutex };
+
+        Stats stats{};
+        stats.liveBytes = liveBytes;
+        stats.reservedBytes = dedicatedBytes;
+        stats.dedicatedAllocationCount = dedicatedAllocationCount;
+        stats.allocationCount = allocationCount;
+
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFreeRange = 0;
+        for (auto& memoryTypePools : pools) {
+            for (auto& pool : memoryTypePools) {
+                for (auto& block : pool.blocks) {
+                    stats.blockCount++;
+                    stats.reservedBytes += block->ranges.getSize();
+                    freeBytes += block->ranges.getFreeSize();
+                    largestFreeRange = std::max(largestFreeRange, block->ranges.getLargestFreeRange());
+                }
+            }
+        }
+
+        if (freeBytes > 0) {
+            stats.fragmentation = 1.0f - static_cast<float>(largestFreeRange) / static_cast<float>(freeBytes);
+        }
+        return stats;
+    }
+
+    VortexAllocator::Pool& VortexAllocator::getPool(uint32_t memoryTypeIndex, ResourceType type) {
+        // with a granularity of 1 linear and optimal resources can share pages
+        if (bufferImageGranularity > 1 && type == ResourceType::Image) {
+            return pools[memoryTypeIndex][1];
+        }
+        return pools[memoryTypeIndex][0];
+    }
+
+    VkDeviceSize VortexAllocator::getBlockSize(uint32_t memoryTypeIndex) const {
+        // small heaps (e.g. the 256MB host visible device local heap) get proportionally smaller blocks
+        uint32_t heapIndex = memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[heapIndex].size;
+        return std::min(preferredBlockSize, heapSize / 8);
+    }
+
+    VkDeviceMemory VortexAllocator::allocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, void** mapped) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate device memory!");
+        }
+
+        *mapped = nullptr;
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, mapped) != VK_SUCCESS) {
+                vkFreeMemory(device, memory, nullptr);
+                throw std::runtime_error("failed to map device memory!");
+            }
+        }
+
+        return memory;
+    }
+
+    void VortexAllocator::freeMemory(VkDeviceMemory memory, void* mapped) {
+        if (mapped) {
+            vkUnmapMemory(device, memory);
+        }
+        vkFreeMemory(device, memory, nullptr);
+    }
+
+    VortexAllocation VortexAllocator::allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size) {
+        VortexAllocation allocation{};
+        allocation.memory = allocateMemory(memoryTypeIndex, size, &allocation.mapped);
+        allocation.offset = 0;
+        allocation.size = size;
+
+        liveBytes += size;
+        dedicatedBytes += size;
+        dedicatedAllocationCount++;
+        allocationCount++;
+        return allocation;
+    }
+
+    bool VortexAllocator::allocateFromBlock(
+        VortexMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VortexAllocation& allocation) {
+        auto range = block.ranges.allocate(size, alignment);
+        if (!range.isValid()) {
+            return false;
+        }
+
+        allocation.memory = block.memory;
+        allocation.offset = range.offset;
+        allocation.size = range.size;
+        allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + range.offset : nullptr;
+        allocation.block = &block;
+        allocation.range = range;
+
+        liveBytes += range.size;
+        allocationCount++;
+        return true;
+    }
+
+}  // namespace VortexEngine
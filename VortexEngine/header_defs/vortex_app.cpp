@@ -1,10 +1,13 @@
 #include "../headers/vortex_app.h"
 
 #include "../headers/render_system.h"
+#include "../headers/indirect_render_system.h"
 #include "../headers/vortex_camera.h"
 #include "../headers/keyboard_movement_controller.h"
 #include "../headers/mouse_movement_controller.h"
 #include "../headers/vortex_buffer.h"
+#include "../headers/vortex_bindless_table.h"
+#include "../headers/vortex_upload_queue.h"
 #include "../headers/json.h"
 #include "../headers/scene_parser.h"
 
@@ -14,30 +17,96 @@
 #include <glm/gtc/constants.hpp>
 #include <iostream>
 
+#include <algorithm>
 #include <stdexcept>
 #include <array>
 #include <chrono>
+#include <cmath>
+#include <limits>
 #include <string>
 
 namespace VortexEngine {
 
+	// keeps model uploads from stalling any single frame for too long while a scene streams in
+	static constexpr size_t MAX_MODEL_UPLOADS_PER_FRAME = 8;
+	static constexpr uint32_t NO_SCENE_ITEM = std::numeric_limits<uint32_t>::max();
+	// upper bound on jobs recording RenderSystem's secondary command buffers
+	static constexpr uint32_t MAX_RECORDING_WORKERS = 16;
+
 	struct GlobalUbo {
 		glm::mat4 projectionView{ 1.0f };
 		glm::vec3 lightDirection = glm::normalize(glm::vec3{ 1.0f, -3.0f, -1.0f });
 	};
 
-	VortexApp::VortexApp() {
-		globalPool = VortexDescriptorPool::Builder(vortexDevice)
-			.setMaxSets(VortexSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VortexSwapChain::MAX_FRAMES_IN_FLIGHT)
-			.build();
+	VortexApp::Config VortexApp::parseCommandLine(int argc, char** argv) {
+		Config config{};
+		for (int i = 1; i < argc; i++) {
+			std::string argument = argv[i];
+			auto value = [&argument](const char* option) {
+				return argument.substr(std::string(option).size());
+			};
+
+			if (argument.rfind("--render-path=", 0) == 0) {
+				std::string path = value("--render-path=");
+				if (path == "automatic") {
+					config.renderPath = RenderPath::Automatic;
+				}
+				else if (path == "indirect") {
+					config.renderPath = RenderPath::Indirect;
+				}
+				else if (path == "cpu") {
+					config.renderPath = RenderPath::Cpu;
+				}
+				else {
+					throw std::invalid_argument("unknown render path: " + path);
+				}
+			}
+			else if (argument == "--no-bvh") {
+				config.sceneBVH = false;
+			}
+			else if (argument.rfind("--recording-workers=", 0) == 0) {
+				std::string count = value("--recording-workers=");
+				if (count.empty() || count.find_first_not_of("0123456789") != std::string::npos || count.size() > 3) {
+					throw std::invalid_argument("invalid recording worker count: " + count);
+				}
+				config.recordingWorkers = static_cast<uint32_t>(std::stoul(count));
+			}
+			else if (argument.rfind("--headless=", 0) == 0) {
+				std::string frames = value("--headless=");
+				if (frames.empty() || frames.find_first_not_of("0123456789") != std::string::npos || frames.size() > 9) {
+					throw std::invalid_argument("invalid headless frame count: " + frames);
+				}
+				config.headlessFrames = static_cast<uint32_t>(std::stoul(frames));
+			}
+			else if (argument.rfind("--upload-benchmark=", 0) == 0) {
+				std::string meshes = value("--upload-benchmark=");
+				if (meshes.empty() || meshes.find_first_not_of("0123456789") != std::string::npos || meshes.size() > 7) {
+					throw std::invalid_argument("invalid upload benchmark mesh count: " + meshes);
+				}
+				config.uploadBenchmarkMeshes = static_cast<uint32_t>(std::stoul(meshes));
+			}
+			else {
+				throw std::invalid_argument("unknown option: " + argument);
+			}
+		}
+		return config;
+	}
+
+	VortexApp::VortexApp() : VortexApp(Config{}) {}
 
-		loadGameObjects();
+	VortexApp::VortexApp(const Config& config) : config{ config } {
+		if (config.uploadBenchmarkMeshes == 0) {
+			loadGameObjects();
+		}
 	}
 
 	VortexApp::~VortexApp() {}
 
 	void VortexApp::run() {
+		if (config.uploadBenchmarkMeshes > 0) {
+			runUploadBenchmark();
+			return;
+		}
 
 		std::vector<std::unique_ptr<VortexBuffer>> uboBuffers(VortexSwapChain::MAX_FRAMES_IN_FLIGHT);
 		for (int i = 0; i < uboBuffers.size(); i++) {
@@ -52,17 +121,16 @@ namespace VortexEngine {
 			uboBuffers[i]->map();
 		}
 
-			auto globalSetLayout = VortexDescriptorSetLayout::Builder(vortexDevice)
-				.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT)
-				.build();
+			// declared by the shaders, the render systems check theirs against it
+			auto globalSetLayout = pipelineRegistry.getReflectedLayout({ "shaders/default.vert.spv", "shaders/default.frag.spv" }).setLayouts.at(0);
 
 			std::vector<VkDescriptorSet> globalDescriptorSets(VortexSwapChain::MAX_FRAMES_IN_FLIGHT);
 
 			for (int i = 0; i < globalDescriptorSets.size(); i++) {
 				auto bufferInfo = uboBuffers[i]->descriptorInfo();
-				VortexDescriptorWriter(*globalSetLayout, *globalPool)
+				globalDescriptorSets[i] = VortexDescriptorWriter(*globalSetLayout)
 					.writeBuffer(0, &bufferInfo)
-					.build(globalDescriptorSets[i]);
+					.build(descriptorSetCache);
 			}
 
 		VortexBuffer globalUboBuffer{
@@ -77,38 +145,160 @@ namespace VortexEngine {
 		globalUboBuffer.map();
 
 
-		RenderSystem renderSystem{ vortexDevice, vortexRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout() };
+		auto pipelineStart = std::chrono::high_resolution_clock::now();
+
+		// materials indexed per instance from one descriptor set where descriptor indexing is available
+		std::unique_ptr<VortexBindlessTable> bindlessTable;
+		if (vortexDevice.isBindlessSupported()) {
+			bindlessTable = std::make_unique<VortexBindlessTable>(vortexDevice);
+		}
+
+		// exactly one of the two render systems is created
+		bool indirect = config.renderPath != RenderPath::Cpu && IndirectRenderSystem::isSupported(vortexDevice);
+		if (config.renderPath == RenderPath::Indirect && !indirect) {
+			throw std::runtime_error("the indirect render path requires the drawIndirectFirstInstance feature!");
+		}
+
+		// GPU culled indirect path
+		std::unique_ptr<IndirectRenderSystem> indirectRenderSystem;
+		// CPU culled path, recorded by several jobs
+		std::unique_ptr<RenderSystem> renderSystem;
+		if (indirect) {
+			indirectRenderSystem = std::make_unique<IndirectRenderSystem>(
+				vortexDevice, vortexRenderer.getSwapChainRenderPass(), globalSetLayout->getDescriptorSetLayout(), pipelineRegistry,
+				bindlessTable.get());
+		}
+		else {
+			renderSystem = std::make_unique<RenderSystem>(vortexDevice, vortexRenderer.getSwapChainRenderPass(),
+				globalSetLayout->getDescriptorSetLayout(), pipelineRegistry, jobSystem, bindlessTable.get());
+			uint32_t recordingWorkers = config.recordingWorkers > 0 ? config.recordingWorkers : jobSystem.getWorkerCount() + 1;
+			vortexRenderer.setWorkerCount(std::min(recordingWorkers, MAX_RECORDING_WORKERS));
+		}
+		bool recordInline = renderSystem && config.recordingWorkers == 1;
+		// only RenderSystem queries the BVH, so it isn't maintained otherwise
+		bool useSceneBVH = renderSystem && config.sceneBVH;
+		std::cout << "Render path: " << (indirect ? "indirect" : useSceneBVH ? "cpu, BVH culling" : "cpu, flat culling") << std::endl;
+
+		float pipelineMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - pipelineStart).count();
+		auto pipelineStats = pipelineRegistry.getStats();
+		std::cout << "Created " << pipelineStats.pipelines << " pipelines from " << pipelineStats.shaderModules << " shader modules in "
+			<< pipelineMilliseconds << " ms (" << (vortexDevice.isPipelineCacheWarm() ? "warm" : "cold") << " pipeline cache, "
+			<< pipelineRegistry.getPendingCount() << " still compiling), " << pipelineStats.pipelineLayouts << " pipeline layouts and "
+			<< pipelineStats.descriptorSetLayouts << " descriptor set layouts shared" << std::endl;
+
+		transforms.sync(world, &jobSystem);
+		if (indirectRenderSystem) {
+			indirectRenderSystem->setEntities(world, transforms);
+		}
         VortexCamera camera{};
         camera.setViewTarget(glm::vec3(-1.0f, -2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 1.5f));
 
-        auto viewerObject = VortexGameObject::createGameObject();
+        VortexEntity viewer = world.createEntity();
+        world.addComponent<TransformComponent>(viewer);
         KeyboardMovementController cameraController{};
 		MouseMovementController mouseController{};
 
         auto currentTime = std::chrono::high_resolution_clock::now();
 
-		while (!vortexWindow.shouldClose()) {
-			glfwPollEvents();
+		bool sceneLoaded = sceneLoader.isComplete();
+		if (useSceneBVH) {
+			rebuildSceneBVH();
+		}
+
+		// hitches caused by pipelines compiling in the background, reported once they are all in
+		float worstCompileFrameMilliseconds = 0.0f;
+		// for the headless summary: the same over the whole run, and the worst frame without compiles
+		float runWorstCompileFrameMilliseconds = 0.0f;
+		float runWorstFrameMilliseconds = 0.0f;
+		uint32_t compileFrames = 0;
+
+		uint32_t framesRendered = 0;
+		auto loopStart = std::chrono::high_resolution_clock::now();
+		while (vortexWindow ? !vortexWindow->shouldClose() : framesRendered < config.headlessFrames) {
+			if (vortexWindow) {
+				glfwPollEvents();
+			}
+			auto frameStart = std::chrono::high_resolution_clock::now();
+			bool pipelinesCompiling = pipelineRegistry.getPendingCount() > 0;
+
+			// frame boundary: nothing is recording, so finished pipelines can be handed out
+			pipelineRegistry.swapCompletedPipelines();
 
             auto newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
             currentTime = newTime;
 
-            cameraController.moveInPlaneXZ(vortexWindow.getGLFWwindow(), frameTime, viewerObject);
-			mouseController.lookAroundInPlaneXZ(vortexWindow.getGLFWwindow(), frameTime, viewerObject);
-            camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
+            auto& viewerTransform = world.getComponent<TransformComponent>(viewer);
+			if (vortexWindow) {
+				cameraController.moveInPlaneXZ(vortexWindow->getGLFWwindow(), frameTime, viewerTransform);
+				mouseController.lookAroundInPlaneXZ(vortexWindow->getGLFWwindow(), frameTime, viewerTransform);
+			}
+            camera.setViewYXZ(viewerTransform.translation, viewerTransform.rotation);
+
+			// only moved transforms and their descendants get new world matrices
+			transforms.sync(world, &jobSystem);
+			if (useSceneBVH) {
+				refitSceneBVH();
+			}
+			// models that became resident, the only membership change of the draw list
+			bool entitiesChanged = false;
+
+			if (!sceneLoaded) {
+				size_t becameResident = sceneLoader.uploadReady(world, MAX_MODEL_UPLOADS_PER_FRAME);
+				if (becameResident > 0) {
+					if (useSceneBVH) {
+						rebuildSceneBVH();
+					}
+					entitiesChanged = true;
+				}
+
+				if (sceneLoader.isComplete()) {
+					sceneLoaded = true;
+
+					auto modelStats = modelRegistry.getStats();
+					std::cout << "Loaded " << sceneLoader.getProgress().objectsTotal << " game objects using " << modelStats.residentModels
+						<< " models (" << modelStats.hits << " cache hits, " << modelStats.misses << " misses)" << std::endl;
+
+					auto memoryStats = vortexDevice.allocator().getStats();
+					std::cout << "Device memory: " << memoryStats.liveBytes / (1024 * 1024) << " MB live in "
+						<< memoryStats.blockCount << " blocks + " << memoryStats.dedicatedAllocationCount << " dedicated ("
+						<< memoryStats.fragmentation * 100.0f << "% fragmented)" << std::endl;
+
+					auto uploadStats = vortexDevice.uploadQueue().getStats();
+					std::cout << "Uploaded " << uploadStats.bytesUploaded / (1024 * 1024) << " MB in " << uploadStats.copies
+						<< " copies over " << uploadStats.submissions << " submissions (" << uploadStats.stalls
+						<< " waits for staging space)" << std::endl;
+				}
+			}
+
+			if (indirectRenderSystem) {
+				if (entitiesChanged) {
+					indirectRenderSystem->setEntities(world, transforms);
+				}
+				else {
+					indirectRenderSystem->updateTransforms(transforms);
+				}
+			}
 
             float aspect = vortexRenderer.getAspectRatio();
             camera.setPerspectiveProjection(glm::radians(70.0f), aspect, 0.1f, 10.0f);
 
 			if (auto commandBuffer = vortexRenderer.beginFrame()) {
 				int frameIndex = vortexRenderer.getFrameIndex();
+				// beginFrame waited for this frame's previous submission, its transient sets are free
+				descriptorAllocator.beginFrame(frameIndex);
+				if (bindlessTable) {
+					bindlessTable->beginFrame();
+				}
 				FrameInfo frameInfo{
 					frameIndex,
 					frameTime,
 					commandBuffer,
 					camera,
-					globalDescriptorSets[frameIndex]
+					globalDescriptorSets[frameIndex],
+					descriptorAllocator,
+					descriptorSetCache
 				};
 
 				//update
@@ -118,28 +308,159 @@ namespace VortexEngine {
 				uboBuffers[frameIndex]->writeToBuffer(&ubo);
 				uboBuffers[frameIndex]->flush();
 
+				if (indirectRenderSystem) {
+					indirectRenderSystem->cull(frameInfo);
+				}
+
 				//render pass
-				vortexRenderer.beginSwapChainRenderPass(commandBuffer);
-				renderSystem.renderGameObjects(frameInfo, gameObjects);
+				if (indirectRenderSystem) {
+					vortexRenderer.beginSwapChainRenderPass(commandBuffer);
+					indirectRenderSystem->render(frameInfo);
+				}
+				else if (recordInline) {
+					vortexRenderer.beginSwapChainRenderPass(commandBuffer);
+					renderSystem->renderGameObjects(frameInfo, world, transforms, useSceneBVH ? &sceneBVH : nullptr);
+				}
+				else {
+					// one draw per visible model, recorded by several jobs
+					vortexRenderer.beginSwapChainRenderPass(commandBuffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+					renderSystem->renderGameObjectsParallel(frameInfo, world, transforms, vortexRenderer,
+						useSceneBVH ? &sceneBVH : nullptr);
+				}
 				vortexRenderer.endSwapChainRenderPass(commandBuffer);
 				vortexRenderer.endFrame();
+				framesRendered++;
+			}
+
+			float frameMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - frameStart).count();
+			if (!pipelinesCompiling) {
+				runWorstFrameMilliseconds = std::max(runWorstFrameMilliseconds, frameMilliseconds);
+			}
+			else {
+				worstCompileFrameMilliseconds = std::max(worstCompileFrameMilliseconds, frameMilliseconds);
+				runWorstCompileFrameMilliseconds = std::max(runWorstCompileFrameMilliseconds, frameMilliseconds);
+				compileFrames++;
+
+				if (pipelineRegistry.getPendingCount() == 0) {
+					std::cout << "Pipelines compiled, worst frame CPU time while compiling: " << worstCompileFrameMilliseconds << " ms" << std::endl;
+					worstCompileFrameMilliseconds = 0.0f;
+				}
 			}
 		}
 
 		vkDeviceWaitIdle(vortexDevice.device());
+
+		if (!vortexWindow && framesRendered > 0) {
+			float loopMilliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - loopStart).count();
+			std::cout << "Rendered " << framesRendered << " headless frames, " << loopMilliseconds / framesRendered
+				<< " ms per frame" << std::endl;
+			std::cout << "Worst frame CPU time: " << runWorstCompileFrameMilliseconds << " ms in " << compileFrames
+				<< " frames while pipelines compiled, " << runWorstFrameMilliseconds << " ms otherwise" << std::endl;
+		}
 	}
 
 	void VortexApp::loadGameObjects() {
 		//std::shared_ptr<VortexModel> vortexModel = VortexModel::createModelFromFile(vortexDevice, "C:/Users/judet/OneDrive/Desktop/vortex_engine_proj_1/Assets/Meshes/smooth_teapot.obj");
 
-        //auto cube = VortexGameObject::createGameObject();
-        //cube.model = vortexModel;
-        //cube.transform.translation = { 0.0f, 0.0f, 1.5f };
-        //cube.transform.scale = { 0.5f, 0.5f, 0.5f };
-        //gameObjects.push_back(std::move(cube));
+        //auto cube = world.createEntity();
+        //world.addComponent<ModelComponent>(cube, vortexModel);
+        //auto& cubeTransform = world.addComponent<TransformComponent>(cube);
+        //cubeTransform.translation = { 0.0f, 0.0f, 1.5f };
+        //cubeTransform.scale = { 0.5f, 0.5f, 0.5f };
 
 		SceneParser mainReader{ "C:/Users/judet/OneDrive/Desktop/vortex_engine_proj_1/Assets/Scenes/main.vscn" };
 
-		gameObjects = mainReader.parseScene(vortexDevice);
+		// models stream in as background jobs, run() uploads them as they finish parsing
+		sceneLoader.loadAsync(mainReader, world);
+	}
+
+	void VortexApp::runUploadBenchmark() {
+		// a unit cube with per face normals, about the size of a typical prop
+		VortexModel::Builder cube{};
+		const glm::vec3 normals[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		for (const auto& normal : normals) {
+			glm::vec3 tangent = std::abs(normal.y) > 0.5f ? glm::vec3{ 1, 0, 0 } : glm::vec3{ 0, 1, 0 };
+			glm::vec3 bitangent = glm::cross(normal, tangent);
+			uint32_t first = static_cast<uint32_t>(cube.vertices.size());
+			for (int corner = 0; corner < 4; corner++) {
+				float u = corner == 1 || corner == 2 ? 1.0f : 0.0f;
+				float v = corner >= 2 ? 1.0f : 0.0f;
+				VortexModel::Vertex vertex{};
+				vertex.position = (normal + tangent * (u * 2.0f - 1.0f) + bitangent * (v * 2.0f - 1.0f)) * 0.5f;
+				vertex.color = glm::vec3{ 1.0f };
+				vertex.normal = normal;
+				vertex.uv = { u, v };
+				cube.vertices.push_back(vertex);
+			}
+			cube.indices.insert(cube.indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+		}
+		cube.computeBounds();
+
+		auto statsBefore = vortexDevice.uploadQueue().getStats();
+		auto start = std::chrono::high_resolution_clock::now();
+
+		std::vector<std::unique_ptr<VortexModel>> models;
+		models.reserve(config.uploadBenchmarkMeshes);
+		for (uint32_t i = 0; i < config.uploadBenchmarkMeshes; i++) {
+			models.push_back(std::make_unique<VortexModel>(vortexDevice, cube));
+		}
+		// until the GPU has copied everything, same as a scene being ready to draw
+		vortexDevice.uploadQueue().waitIdle();
+
+		float milliseconds = std::chrono::duration<float, std::chrono::milliseconds::period>(
+			std::chrono::high_resolution_clock::now() - start).count();
+		auto stats = vortexDevice.uploadQueue().getStats();
+		std::cout << "Uploaded " << config.uploadBenchmarkMeshes << " small meshes in " << milliseconds << " ms ("
+			<< milliseconds * 1000.0f / config.uploadBenchmarkMeshes << " us per mesh), " << stats.copies - statsBefore.copies
+			<< " copies over " << stats.submissions - statsBefore.submissions << " submissions, "
+			<< stats.stalls - statsBefore.stalls << " waits for staging space" << std::endl;
+
+		models.clear();
+		vkDeviceWaitIdle(vortexDevice.device());
+	}
+
+	void VortexApp::rebuildSceneBVH() {
+		sceneBounds.clear();
+		sceneEntityIndices.clear();
+		sceneItems.assign(world.getEntityCapacity(), NO_SCENE_ITEM);
+		world.each<TransformComponent, ModelComponent>([this](VortexEntity entity, TransformComponent&, ModelComponent& model) {
+			if (model.model) {
+				sceneItems[entity.index] = static_cast<uint32_t>(sceneBounds.size());
+				sceneBounds.push_back(model.model->getBoundingBox().transformed(transforms.getModelMatrix(entity.index)));
+				sceneEntityIndices.push_back(entity.index);
+			}
+		});
+
+		// rebuilt when entities gain models while the scene streams in, moving entities only refit
+		sceneBVH.build(sceneBounds, sceneEntityIndices);
+	}
+
+	bool VortexApp::refitSceneBVH() {
+		changedSceneItems.clear();
+		auto& models = world.getPool<ModelComponent>();
+		for (uint32_t entityIndex : transforms.getUpdatedIndices()) {
+			if (entityIndex >= sceneItems.size() || sceneItems[entityIndex] == NO_SCENE_ITEM) {
+				continue;
+			}
+
+			// entities that lost their model since the last rebuild keep their old bounds
+			auto* model = models.tryGet(entityIndex);
+			if (!model || !model->model) {
+				continue;
+			}
+
+			uint32_t item = sceneItems[entityIndex];
+			sceneBounds[item] = model->model->getBoundingBox().transformed(transforms.getModelMatrix(entityIndex));
+			changedSceneItems.push_back(item);
+		}
+
+		if (changedSceneItems.empty()) {
+			return false;
+		}
+
+		sceneBVH.refit(sceneBounds, changedSceneItems);
+		return true;
 	}
 }
\ No newline at end of file
@@ -0,0 +1,57 @@
+#include "../headers/vortex_bindless_materials.h"
+#include "../headers/vortex_swap_chain.h"
+
+// std
+#include <algorithm>
+
+namespace VortexEngine {
+
+    VortexBindlessMaterials::VortexBindlessMaterials(VortexDevice& vortexDevice, VortexBindlessTable& bindlessTable)
+        : vortexDevice{ vortexDevice }, bindlessTable{ bindlessTable } {
+        buffers.resize(VortexSwapChain::MAX_FRAMES_IN_FLIGHT);
+    }
+
+    void VortexBindlessMaterials::clear() {
+        materials.clear();
+        indices.clear();
+    }
+
+    uint32_t VortexBindlessMaterials::add(const MaterialComponent* material) {
+        BindlessMaterialData data{};
+        if (material) {
+            data.opacity = material->getDrawOpacity();
+            data.baseColorTexture = material->baseColorTexture;
+            data.baseColorSampler = material->baseColorSampler;
+        }
+
+        auto key = std::make_tuple(data.opacity, data.baseColorTexture, data.baseColorSampler);
+        auto [it, inserted] = indices.emplace(key, static_cast<uint32_t>(materials.size()));
+        if (inserted) {
+            materials.push_back(data);
+        }
+        return it->second;
+    }
+
+    uint32_t VortexBindlessMaterials::upload(int frameIndex) {
+        // destroying a registered buffer releases its bindless index
+        auto& buffer = buffers[frameIndex];
+        if (!buffer || buffer->getInstanceCount() < materials.size()) {
+            uint32_t capacity = 64;
+            while (capacity < materials.size()) {
+                capacity *= 2;
+            }
+
+            buffer = std::make_unique<VortexBuffer>(
+                vortexDevice,
+                sizeof(BindlessMaterialData),
+                capacity,
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            buffer->map();
+        }
+
+        std::copy(materials.begin(), materials.end(), static_cast<BindlessMaterialData*>(buffer->getMappedMemory()));
+        return bindlessTable.registerStorageBuffer(buffer->getBuffer());
+    }
+
+}  // namespace VortexEngine
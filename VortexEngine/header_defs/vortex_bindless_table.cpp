@@ -0,0 +1,267 @@
+#include "../headers/vortex_bindless_table.h"
+#include "../headers/vortex_swap_chain.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+
+namespace VortexEngine {
+
+    namespace {
+        constexpr VkShaderStageFlags BINDLESS_STAGES = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VortexBindlessTable::VortexBindlessTable(
+        VortexDevice& vortexDevice,
+        uint32_t maxSampledImages,
+        uint32_t maxSamplers,
+        uint32_t maxStorageBuffers)
+        : vortexDevice{ vortexDevice } {
+        if (!vortexDevice.isBindlessSupported()) {
+            throw std::runtime_error("bindless resources need descriptor indexing, which the device does not support!");
+        }
+
+        // every stage sees the whole set, so the per stage limits apply as well
+        const auto& limits = vortexDevice.descriptorIndexingProperties;
+        sampledImages = Slots{ SAMPLED_IMAGE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+            std::min({ maxSampledImages,
+                limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                limits.maxPerStageDescriptorUpdateAfterBindSampledImages }),
+            "sampled image" };
+        samplers = Slots{ SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER,
+            std::min({ maxSamplers,
+                limits.maxDescriptorSetUpdateAfterBindSamplers,
+                limits.maxPerStageDescriptorUpdateAfterBindSamplers }),
+            "sampler" };
+        storageBuffers = Slots{ STORAGE_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            std::min({ maxStorageBuffers,
+                limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers }),
+            "storage buffer" };
+
+        const VkDescriptorBindingFlags bindingFlags =
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+
+        VortexDescriptorSetLayout::Builder layoutBuilder{ vortexDevice };
+        VortexDescriptorPool::Builder poolBuilder{ vortexDevice };
+        for (const Slots* slots : { &sampledImages, &samplers, &storageBuffers }) {
+            layoutBuilder.addBinding(slots->binding, slots->descriptorType, BINDLESS_STAGES, slots->capacity, bindingFlags);
+            poolBuilder.addPoolSize(slots->descriptorType, slots->capacity);
+        }
+
+        setLayout = layoutBuilder
+            .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT)
+            .build();
+        pool = poolBuilder
+            .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+            .setMaxSets(1)
+            .build();
+
+        if (!pool->allocateDescriptorSet(setLayout->getDescriptorSetLayout(), descriptorSet)) {
+            throw std::runtime_error("failed to allocate bindless descriptor set!");
+        }
+
+        createDefaultSampler();
+        vortexDevice.addResourceListener(this);
+    }
+
+    VortexBindlessTable::~VortexBindlessTable() {
+        // the set goes with its pool
+        vortexDevice.removeResourceListener(this);
+        vortexDevice.notifySamplerDestroyed(defaultSampler);
+        vkDestroySampler(vortexDevice.device(), defaultSampler, nullptr);
+    }
+
+    void VortexBindlessTable::createDefaultSampler() {
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+        samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+
+        if (vkCreateSampler(vortexDevice.device(), &samplerInfo, nullptr, &defaultSampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create default bindless sampler!");
+        }
+
+        uint32_t index = registerSampler(defaultSampler);
+        assert(index == DEFAULT_SAMPLER && "Default sampler must take the first sampler index");
+        (void)index;
+    }
+
+    uint32_t VortexBindlessTable::registerSampledImage(VkImageView imageView, VkImageLayout imageLayout) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        bool newIndex;
+        uint32_t index = acquire(sampledImages, handleKey(imageView), newIndex);
+        if (newIndex) {
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.imageView = imageView;
+            imageInfo.imageLayout = imageLayout;
+            write(sampledImages, index, &imageInfo, nullptr);
+        }
+        return index;
+    }
+
+    uint32_t VortexBindlessTable::registerSampler(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        bool newIndex;
+        uint32_t index = acquire(samplers, handleKey(sampler), newIndex);
+        if (newIndex) {
+            VkDescriptorImageInfo imageInfo{};
+            imageInfo.sampler = sampler;
+            write(samplers, index, &imageInfo, nullptr);
+        }
+        return index;
+    }
+
+    uint32_t VortexBindlessTable::registerStorageBuffer(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        bool newIndex;
+        uint32_t index = acquire(storageBuffers, handleKey(buffer), newIndex);
+        if (newIndex) {
+            VkDescriptorBufferInfo bufferInfo{};
+            bufferInfo.buffer = buffer;
+            bufferInfo.offset = 0;
+            bufferInfo.range = VK_WHOLE_SIZE;
+            write(storageBuffers, index, nullptr, &bufferInfo);
+        }
+        return index;
+    }
+
+    void VortexBindlessTable::releaseSampledImage(VkImageView imageView) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        release(sampledImages, handleKey(imageView));
+    }
+
+    void VortexBindlessTable::releaseSampler(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        release(samplers, handleKey(sampler));
+    }
+
+    void VortexBindlessTable::releaseStorageBuffer(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        release(storageBuffers, handleKey(buffer));
+    }
+
+    void VortexBindlessTable::beginFrame() {
+        std::lock_guard<std::mutex> lock{ mutex };
+        frameNumber++;
+
+        // the renderer has waited for every frame up to MAX_FRAMES_IN_FLIGHT ago
+        for (Slots* slots : { &sampledImages, &samplers, &storageBuffers }) {
+            auto& released = slots->releasedIndices;
+            while (!released.empty() && released.front().first + VortexSwapChain::MAX_FRAMES_IN_FLIGHT <= frameNumber) {
+                slots->freeIndices.push_back(released.front().second);
+                released.pop_front();
+            }
+        }
+    }
+
+    bool VortexBindlessTable::isCompatible(const std::vector<VkDescriptorSetLayoutBinding>& bindings) const {
+        for (const auto& binding : bindings) {
+            const Slots* slots = nullptr;
+            for (const Slots* candidate : { &sampledImages, &samplers, &storageBuffers }) {
+                if (candidate->binding == binding.binding) {
+                    slots = candidate;
+                }
+            }
+
+            // runtime sized arrays are reflected with a count of 0
+            if (!slots || slots->descriptorType != binding.descriptorType ||
+                binding.descriptorCount > slots->capacity ||
+                (binding.stageFlags & ~BINDLESS_STAGES) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    VortexBindlessTable::Stats VortexBindlessTable::getStats() const {
+        std::lock_guard<std::mutex> lock{ mutex };
+        Stats stats{};
+        stats.sampledImages = static_cast<uint32_t>(sampledImages.indices.size());
+        stats.samplers = static_cast<uint32_t>(samplers.indices.size());
+        stats.storageBuffers = static_cast<uint32_t>(storageBuffers.indices.size());
+        stats.pendingReleases = static_cast<uint32_t>(
+            sampledImages.releasedIndices.size() + samplers.releasedIndices.size() + storageBuffers.releasedIndices.size());
+        return stats;
+    }
+
+    void VortexBindlessTable::onBufferDestroyed(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        release(storageBuffers, handleKey(buffer));
+    }
+
+    void VortexBindlessTable::onImageViewDestroyed(VkImageView imageView) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        release(sampledImages, handleKey(imageView));
+    }
+
+    void VortexBindlessTable::onSamplerDestroyed(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        release(samplers, handleKey(sampler));
+    }
+
+    uint32_t VortexBindlessTable::acquire(Slots& slots, uint64_t handle, bool& newIndex) {
+        auto it = slots.indices.find(handle);
+        if (it != slots.indices.end()) {
+            newIndex = false;
+            return it->second;
+        }
+
+        uint32_t index;
+        if (!slots.freeIndices.empty()) {
+            index = slots.freeIndices.back();
+            slots.freeIndices.pop_back();
+        }
+        else if (slots.nextIndex < slots.capacity) {
+            index = slots.nextIndex++;
+        }
+        else {
+            throw std::runtime_error("bindless table is out of " + std::string(slots.name) + " slots!");
+        }
+
+        slots.indices.emplace(handle, index);
+        newIndex = true;
+        return index;
+    }
+
+    void VortexBindlessTable::release(Slots& slots, uint64_t handle) {
+        // most destroyed buffers and views were never registered
+        auto it = slots.indices.find(handle);
+        if (it == slots.indices.end()) {
+            return;
+        }
+
+        // the descriptor is left as is, partially bound sets allow stale slots nobody reads
+        slots.releasedIndices.emplace_back(frameNumber, it->second);
+        slots.indices.erase(it);
+    }
+
+    void VortexBindlessTable::write(const Slots& slots, uint32_t index,
+        const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet;
+        write.dstBinding = slots.binding;
+        write.dstArrayElement = index;
+        write.descriptorType = slots.descriptorType;
+        write.descriptorCount = 1;
+        write.pImageInfo = imageInfo;
+        write.pBufferInfo = bufferInfo;
+
+        vkUpdateDescriptorSets(vortexDevice.device(), 1, &write, 0, nullptr);
+    }
+
+}  // namespace VortexEngine
@@ -48,13 +48,17 @@ namespace VortexEngine {
 
     VortexBuffer::~VortexBuffer() {
         unmap();
+        vortexDevice.notifyBufferDestroyed(buffer);
         vkDestroyBuffer(vortexDevice.device(), buffer, nullptr);
-        vkFreeMemory(vortexDevice.device(), memory, nullptr);
+        vortexDevice.allocator().free(memory);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
+     * @note Host visible memory is mapped persistently by the allocator, so this only hands out a
+     * pointer into that mapping. Writes through writeToBuffer are checked against the mapped range.
+     *
      * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
      * buffer range.
      * @param offset (Optional) Byte offset from beginning
@@ -62,27 +66,32 @@ namespace VortexEngine {
      * @return VkResult of the buffer mapping call
      */
     VkResult VortexBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(vortexDevice.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && memory.isValid() && "Called map on buffer before create");
+        assert(offset <= bufferSize && (size == VK_WHOLE_SIZE || size <= bufferSize - offset) &&
+            "Mapped range must lie within the buffer");
+        if (!memory.mapped) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char*>(memory.mapped) + offset;
+        mappedSize = size == VK_WHOLE_SIZE ? bufferSize - offset : size;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The underlying memory block stays mapped until the allocator releases it
      */
     void VortexBuffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(vortexDevice.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
+        mappedSize = 0;
     }
 
     /**
      * Copies the specified data to the mapped buffer. Default value writes whole buffer range
      *
      * @param data Pointer to the data to copy
-     * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to flush the complete buffer
+     * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to write the complete mapped
      * range.
      * @param offset (Optional) Byte offset from beginning of mapped region
      *
@@ -91,9 +100,10 @@ namespace VortexEngine {
         assert(mapped && "Cannot copy to unmapped buffer");
 
         if (size == VK_WHOLE_SIZE) {
-            memcpy(mapped, data, bufferSize);
+            memcpy(mapped, data, mappedSize);
         }
         else {
+            assert(offset <= mappedSize && size <= mappedSize - offset && "Cannot write past the mapped range");
             char* memOffset = (char*)mapped;
             memOffset += offset;
             memcpy(memOffset, data, size);
@@ -114,9 +124,9 @@ namespace VortexEngine {
     VkResult VortexBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
         VkMappedMemoryRange mappedRange = {};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        mappedRange.memory = memory.memory;
+        mappedRange.offset = memory.offset + offset;
+        mappedRange.size = size == VK_WHOLE_SIZE ? memory.size - offset : size;
         return vkFlushMappedMemoryRanges(vortexDevice.device(), 1, &mappedRange);
     }
 
@@ -134,9 +144,9 @@ namespace VortexEngine {
     VkResult VortexBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
         VkMappedMemoryRange mappedRange = {};
         mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
+        mappedRange.memory = memory.memory;
+        mappedRange.offset = memory.offset + offset;
+        mappedRange.size = size == VK_WHOLE_SIZE ? memory.size - offset : size;
         return vkInvalidateMappedMemoryRanges(vortexDevice.device(), 1, &mappedRange);
     }
 
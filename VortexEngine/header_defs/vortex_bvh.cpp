@@ -0,0 +1,378 @@
+#include "../headers/vortex_bvh.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace VortexEngine {
+
+	namespace {
+		constexpr uint32_t SAH_BIN_COUNT = 16;
+		// past this depth nodes are split at the median, which bounds the tree depth for
+		// pathological inputs so traversal can use a fixed stack
+		constexpr uint32_t SAH_MAX_DEPTH = 64;
+		constexpr uint32_t TRAVERSAL_STACK_SIZE = 128;
+
+		struct Bin {
+			VortexAABB bounds = VortexAABB::empty();
+			uint32_t count = 0;
+		};
+
+		bool containsBox(const VortexAABB& outer, const VortexAABB& inner) {
+			return glm::all(glm::lessThanEqual(outer.min, inner.min)) && glm::all(glm::lessThanEqual(inner.max, outer.max));
+		}
+
+		// Distance at which the ray enters the box, or a negative value if it misses
+		float intersectRay(const VortexAABB& box, const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance) {
+			glm::vec3 t0 = (box.min - origin) * inverseDirection;
+			glm::vec3 t1 = (box.max - origin) * inverseDirection;
+			glm::vec3 tNear = glm::min(t0, t1);
+			glm::vec3 tFar = glm::max(t0, t1);
+
+			float entry = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+			float exit = std::min({ tFar.x, tFar.y, tFar.z, maxDistance });
+			return entry <= exit ? entry : -1.0f;
+		}
+	}
+
+	void VortexBVH::build(const std::vector<VortexAABB>& bounds, const std::vector<uint32_t>& ids) {
+		assert((ids.empty() || ids.size() == bounds.size()) && "Need one id per item");
+
+		clear();
+		if (bounds.empty()) {
+			return;
+		}
+
+		itemIds = ids;
+
+		const uint32_t itemCount = static_cast<uint32_t>(bounds.size());
+		itemBounds = bounds;
+		itemLeaves.resize(itemCount);
+		items.resize(itemCount);
+		centroids.resize(itemCount);
+		for (uint32_t i = 0; i < itemCount; i++) {
+			items[i] = i;
+			centroids[i] = bounds[i].center();
+		}
+
+		nodes.reserve(2 * (itemCount / MAX_LEAF_ITEMS) + 1);
+		Node root{};
+		root.itemCount = itemCount;
+		nodes.push_back(root);
+
+		// iterative so degenerate inputs can't overflow the call stack
+		std::vector<std::pair<uint32_t, uint32_t>> pending{ { 0, 0 } };
+		while (!pending.empty()) {
+			auto [nodeIndex, depth] = pending.back();
+			pending.pop_back();
+			split(nodeIndex, depth, pending);
+		}
+
+		centroids.clear();
+	}
+
+	void VortexBVH::clear() {
+		nodes.clear();
+		items.clear();
+		itemBounds.clear();
+		itemLeaves.clear();
+		itemIds.clear();
+	}
+
+	void VortexBVH::split(uint32_t nodeIndex, uint32_t depth, std::vector<std::pair<uint32_t, uint32_t>>& pending) {
+		const uint32_t first = nodes[nodeIndex].firstItem;
+		const uint32_t count = nodes[nodeIndex].itemCount;
+
+		VortexAABB nodeBounds = VortexAABB::empty();
+		VortexAABB centroidBounds = VortexAABB::empty();
+		for (uint32_t i = first; i < first + count; i++) {
+			nodeBounds.expand(itemBounds[items[i]]);
+			centroidBounds.expand(VortexAABB{ centroids[items[i]], centroids[items[i]] });
+		}
+		nodes[nodeIndex].bounds = nodeBounds;
+
+		if (count <= MAX_LEAF_ITEMS) {
+			for (uint32_t i = first; i < first + count; i++) {
+				itemLeaves[items[i]] = nodeIndex;
+			}
+			return;
+		}
+
+		// binned SAH over all three axes: cost of a split ~ count * area on each side
+		int bestAxis = -1;
+		uint32_t bestPlane = 0;
+		float bestCost = std::numeric_limits<float>::max();
+
+		for (int axis = 0; axis < 3 && depth < SAH_MAX_DEPTH; axis++) {
+			const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+			if (extent <= 0.0f) {
+				continue;
+			}
+
+			const float binScale = SAH_BIN_COUNT / extent;
+			Bin bins[SAH_BIN_COUNT];
+			for (uint32_t i = first; i < first + count; i++) {
+				uint32_t item = items[i];
+				uint32_t bin = std::min(
+					SAH_BIN_COUNT - 1, static_cast<uint32_t>((centroids[item][axis] - centroidBounds.min[axis]) * binScale));
+				bins[bin].count++;
+				bins[bin].bounds.expand(itemBounds[item]);
+			}
+
+			// sweep from the right, then evaluate each plane sweeping from the left
+			float rightCosts[SAH_BIN_COUNT]{};
+			VortexAABB rightBounds = VortexAABB::empty();
+			uint32_t rightCount = 0;
+			for (uint32_t plane = SAH_BIN_COUNT - 1; plane > 0; plane--) {
+				rightBounds.expand(bins[plane].bounds);
+				rightCount += bins[plane].count;
+				rightCosts[plane] = rightCount > 0 ? rightCount * rightBounds.surfaceArea() : 0.0f;
+			}
+
+			VortexAABB leftBounds = VortexAABB::empty();
+			uint32_t leftCount = 0;
+			for (uint32_t plane = 1; plane < SAH_BIN_COUNT; plane++) {
+				leftBounds.expand(bins[plane - 1].bounds);
+				leftCount += bins[plane - 1].count;
+				if (leftCount == 0 || leftCount == count) {
+					continue;
+				}
+
+				float cost = leftCount * leftBounds.surfaceArea() + rightCosts[plane];
+				if (cost < bestCost) {
+					bestCost = cost;
+					bestAxis = axis;
+					bestPlane = plane;
+				}
+			}
+		}
+
+		auto begin = items.begin() + first;
+		auto end = begin + count;
+		auto middle = begin;
+
+		if (bestAxis >= 0) {
+			const float binScale = SAH_BIN_COUNT / (centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis]);
+			const float axisMin = centroidBounds.min[bestAxis];
+			middle = std::partition(begin, end, [&](uint32_t item) {
+				uint32_t bin = std::min(
+					SAH_BIN_COUNT - 1, static_cast<uint32_t>((centroids[item][bestAxis] - axisMin) * binScale));
+				return bin < bestPlane;
+			});
+		}
+
+		// too deep, or every centroid in one spot: split at the median of the widest axis
+		if (middle == begin || middle == end) {
+			glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+			int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+			middle = begin + count / 2;
+			std::nth_element(begin, middle, end, [&](uint32_t a, uint32_t b) {
+				return centroids[a][axis] < centroids[b][axis];
+			});
+		}
+
+		const uint32_t leftCount = static_cast<uint32_t>(middle - begin);
+		const uint32_t left = static_cast<uint32_t>(nodes.size());
+
+		Node leftChild{};
+		leftChild.firstItem = first;
+		leftChild.itemCount = leftCount;
+		leftChild.parent = nodeIndex;
+
+		Node rightChild{};
+		rightChild.firstItem = first + leftCount;
+		rightChild.itemCount = count - leftCount;
+		rightChild.parent = nodeIndex;
+
+		nodes.push_back(leftChild);
+		nodes.push_back(rightChild);
+		nodes[nodeIndex].left = left;
+
+		pending.push_back({ left + 1, depth + 1 });
+		pending.push_back({ left, depth + 1 });
+	}
+
+	void VortexBVH::refit(const std::vector<VortexAABB>& bounds) {
+		assert(bounds.size() == itemBounds.size() && "Refit needs the item count the tree was built with");
+		if (nodes.empty()) {
+			return;
+		}
+
+		itemBounds = bounds;
+		for (size_t i = nodes.size(); i-- > 0;) {
+			refitNode(static_cast<uint32_t>(i));
+		}
+	}
+
+	void VortexBVH::refit(const std::vector<VortexAABB>& bounds, const std::vector<uint32_t>& changedItems) {
+		assert(bounds.size() == itemBounds.size() && "Refit needs the item count the tree was built with");
+
+		for (uint32_t item : changedItems) {
+			itemBounds[item] = bounds[item];
+
+			uint32_t nodeIndex = itemLeaves[item];
+			refitNode(nodeIndex);
+
+			// ancestors only change while their child's box does
+			while (nodeIndex != 0) {
+				nodeIndex = nodes[nodeIndex].parent;
+				VortexAABB previous = nodes[nodeIndex].bounds;
+				refitNode(nodeIndex);
+				if (previous.min == nodes[nodeIndex].bounds.min && previous.max == nodes[nodeIndex].bounds.max) {
+					break;
+				}
+			}
+		}
+	}
+
+	void VortexBVH::refitNode(uint32_t nodeIndex) {
+		Node& node = nodes[nodeIndex];
+		if (node.isLeaf()) {
+			node.bounds = VortexAABB::empty();
+			for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+				node.bounds.expand(itemBounds[items[i]]);
+			}
+		}
+		else {
+			node.bounds = nodes[node.left].bounds;
+			node.bounds.expand(nodes[node.left + 1].bounds);
+		}
+	}
+
+	void VortexBVH::queryFrustum(const VortexFrustum& frustum, std::vector<uint32_t>& results) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		uint32_t stack[TRAVERSAL_STACK_SIZE];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+			const Node& node = nodes[stack[--stackSize]];
+			if (!frustum.intersectsAABB(node.bounds)) {
+				continue;
+			}
+
+			// whole subtree visible, no need to test further down
+			if (frustum.containsAABB(node.bounds)) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					results.push_back(getItemId(items[i]));
+				}
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					if (frustum.intersectsAABB(itemBounds[items[i]])) {
+						results.push_back(getItemId(items[i]));
+					}
+				}
+				continue;
+			}
+
+			assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE && "BVH deeper than the traversal stack");
+			stack[stackSize++] = node.left + 1;
+			stack[stackSize++] = node.left;
+		}
+	}
+
+	void VortexBVH::queryOverlap(const VortexAABB& box, std::vector<uint32_t>& results) const {
+		if (nodes.empty()) {
+			return;
+		}
+
+		uint32_t stack[TRAVERSAL_STACK_SIZE];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+
+		while (stackSize > 0) {
+			const Node& node = nodes[stack[--stackSize]];
+			if (!box.overlaps(node.bounds)) {
+				continue;
+			}
+
+			if (containsBox(box, node.bounds)) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					results.push_back(getItemId(items[i]));
+				}
+				continue;
+			}
+
+			if (node.isLeaf()) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					if (box.overlaps(itemBounds[items[i]])) {
+						results.push_back(getItemId(items[i]));
+					}
+				}
+				continue;
+			}
+
+			assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE && "BVH deeper than the traversal stack");
+			stack[stackSize++] = node.left + 1;
+			stack[stackSize++] = node.left;
+		}
+	}
+
+	VortexBVH::RayHit VortexBVH::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance) const {
+		RayHit hit{};
+		if (nodes.empty()) {
+			return hit;
+		}
+
+		const glm::vec3 inverseDirection = 1.0f / direction;
+		hit.distance = maxDistance;
+
+		// (node, entry distance), nearer child popped first so farther subtrees can be pruned
+		std::pair<uint32_t, float> stack[TRAVERSAL_STACK_SIZE];
+		uint32_t stackSize = 0;
+
+		float rootEntry = intersectRay(nodes[0].bounds, origin, inverseDirection, hit.distance);
+		if (rootEntry < 0.0f) {
+			return hit;
+		}
+		stack[stackSize++] = { 0, rootEntry };
+
+		while (stackSize > 0) {
+			auto [nodeIndex, entry] = stack[--stackSize];
+			if (entry > hit.distance) {
+				continue;
+			}
+
+			const Node& node = nodes[nodeIndex];
+			if (node.isLeaf()) {
+				for (uint32_t i = node.firstItem; i < node.firstItem + node.itemCount; i++) {
+					float distance = intersectRay(itemBounds[items[i]], origin, inverseDirection, hit.distance);
+					if (distance >= 0.0f && (!hit.isValid() || distance < hit.distance)) {
+						hit.item = getItemId(items[i]);
+						hit.distance = distance;
+					}
+				}
+				continue;
+			}
+
+			float leftEntry = intersectRay(nodes[node.left].bounds, origin, inverseDirection, hit.distance);
+			float rightEntry = intersectRay(nodes[node.left + 1].bounds, origin, inverseDirection, hit.distance);
+
+			std::pair<uint32_t, float> nearChild{ node.left, leftEntry };
+			std::pair<uint32_t, float> farChild{ node.left + 1, rightEntry };
+			if (nearChild.second < 0.0f || (farChild.second >= 0.0f && farChild.second < nearChild.second)) {
+				std::swap(nearChild, farChild);
+			}
+
+			assert(stackSize + 2 <= TRAVERSAL_STACK_SIZE && "BVH deeper than the traversal stack");
+			if (farChild.second >= 0.0f) {
+				stack[stackSize++] = farChild;
+			}
+			if (nearChild.second >= 0.0f) {
+				stack[stackSize++] = nearChild;
+			}
+		}
+
+		if (!hit.isValid()) {
+			hit.distance = std::numeric_limits<float>::max();
+		}
+		return hit;
+	}
+}
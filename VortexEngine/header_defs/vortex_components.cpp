@@ -1,4 +1,4 @@
-#include "../headers/vortex_game_object.h"
+#include "../headers/vortex_components.h"
 
 namespace VortexEngine {
     glm::mat4 TransformComponent::mat4() {
@@ -48,7 +48,7 @@ namespace VortexEngine {
             {
                 inverseScale.y * (c3 * s1 * s2 - c1 * s3),
                 inverseScale.y * (c2 * c3),
-                scale.y * (c1 * c3 * s2 + s1 * s3),
+                inverseScale.y * (c1 * c3 * s2 + s1 * s3),
             },
             {
                 inverseScale.z * (c2 * s1),
@@ -1,6 +1,7 @@
 #include "../headers/vortex_descriptors.h"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -12,7 +13,8 @@ namespace VortexEngine {
         uint32_t binding,
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
-        uint32_t count) {
+        uint32_t count,
+        VkDescriptorBindingFlags flags) {
         assert(bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layoutBinding{};
         layoutBinding.binding = binding;
@@ -20,28 +22,53 @@ namespace VortexEngine {
         layoutBinding.descriptorCount = count;
         layoutBinding.stageFlags = stageFlags;
         bindings[binding] = layoutBinding;
+        if (flags != 0) {
+            bindingFlags[binding] = flags;
+        }
+        return *this;
+    }
+
+    VortexDescriptorSetLayout::Builder& VortexDescriptorSetLayout::Builder::setLayoutFlags(
+        VkDescriptorSetLayoutCreateFlags flags) {
+        layoutFlags = flags;
         return *this;
     }
 
     std::unique_ptr<VortexDescriptorSetLayout> VortexDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<VortexDescriptorSetLayout>(vortexDevice, bindings);
+        return std::make_unique<VortexDescriptorSetLayout>(vortexDevice, bindings, bindingFlags, layoutFlags);
     }
 
     // *************** Descriptor Set Layout *********************
 
     VortexDescriptorSetLayout::VortexDescriptorSetLayout(
-        VortexDevice& vortexDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+        VortexDevice& vortexDevice,
+        std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+        const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags,
+        VkDescriptorSetLayoutCreateFlags layoutFlags)
         : vortexDevice{ vortexDevice }, bindings{ bindings } {
         std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+        // parallel to setLayoutBindings
+        std::vector<VkDescriptorBindingFlags> setLayoutBindingFlags{};
         for (auto kv : bindings) {
             setLayoutBindings.push_back(kv.second);
+            auto flags = bindingFlags.find(kv.first);
+            setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
         }
 
         VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
         descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        descriptorSetLayoutInfo.flags = layoutFlags;
         descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
         descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+        VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+        if (!bindingFlags.empty()) {
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+            bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+            bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+        }
+
         if (vkCreateDescriptorSetLayout(
             vortexDevice.device(),
             &descriptorSetLayoutInfo,
@@ -103,6 +130,12 @@ namespace VortexEngine {
     }
 
     bool VortexDescriptorPool::allocateDescriptorSet(
+        const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const {
+        // VortexDescriptorAllocator handles full pools by building new ones
+        return tryAllocateDescriptorSet(descriptorSetLayout, descriptor) == VK_SUCCESS;
+    }
+
+    VkResult VortexDescriptorPool::tryAllocateDescriptorSet(
         const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const {
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
@@ -110,12 +143,7 @@ namespace VortexEngine {
         allocInfo.pSetLayouts = &descriptorSetLayout;
         allocInfo.descriptorSetCount = 1;
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-        // a new pool whenever an old pool fills up. But this is beyond our current scope
-        if (vkAllocateDescriptorSets(vortexDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
-            return false;
-        }
-        return true;
+        return vkAllocateDescriptorSets(vortexDevice.device(), &allocInfo, &descriptor);
     }
 
     void VortexDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const {
@@ -130,10 +158,252 @@ namespace VortexEngine {
         vkResetDescriptorPool(vortexDevice.device(), descriptorPool, 0);
     }
 
+    // *************** Descriptor Allocator *********************
+
+    VortexDescriptorAllocator::VortexDescriptorAllocator(
+        VortexDevice& vortexDevice,
+        uint32_t frameCount,
+        std::vector<PoolSizeRatio> poolSizeRatios,
+        uint32_t initialSetsPerPool)
+        : vortexDevice{ vortexDevice },
+        poolSizeRatios{ std::move(poolSizeRatios) },
+        setsPerPool{ std::min(initialSetsPerPool, MAX_SETS_PER_POOL) },
+        framePools(frameCount) {
+        assert(setsPerPool > 0 && "Descriptor pools need room for at least one set");
+    }
+
+    std::vector<VortexDescriptorAllocator::PoolSizeRatio> VortexDescriptorAllocator::getDefaultPoolSizeRatios() {
+        return {
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f },
+            { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4.0f },
+            { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1.0f },
+            { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1.0f },
+        };
+    }
+
+    void VortexDescriptorAllocator::beginFrame(int frameIndex) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        PoolList& poolList = framePools[frameIndex];
+
+        // pools past activePool have not been allocated from since their last reset
+        for (size_t i = 0; i < poolList.pools.size() && i <= poolList.activePool; i++) {
+            poolList.pools[i]->resetPool();
+        }
+        poolList.activePool = 0;
+    }
+
+    VkDescriptorSet VortexDescriptorAllocator::allocateTransient(int frameIndex, VkDescriptorSetLayout descriptorSetLayout) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return allocate(framePools[frameIndex], descriptorSetLayout);
+    }
+
+    VkDescriptorSet VortexDescriptorAllocator::allocatePersistent(VkDescriptorSetLayout descriptorSetLayout) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        return allocate(persistentPools, descriptorSetLayout);
+    }
+
+    size_t VortexDescriptorAllocator::getPoolCount() const {
+        std::lock_guard<std::mutex> lock{ mutex };
+        size_t count = persistentPools.pools.size();
+        for (const auto& poolList : framePools) {
+            count += poolList.pools.size();
+        }
+        return count;
+    }
+
+    VkDescriptorSet VortexDescriptorAllocator::allocate(PoolList& poolList, VkDescriptorSetLayout descriptorSetLayout) {
+        while (true) {
+            // sets of the pool about to be created, 0 when reusing one
+            uint32_t newPoolSets = 0;
+            if (poolList.activePool == poolList.pools.size()) {
+                newPoolSets = setsPerPool;
+                poolList.pools.push_back(createPool());
+            }
+
+            VkDescriptorSet descriptorSet;
+            VkResult result = poolList.pools[poolList.activePool]->tryAllocateDescriptorSet(descriptorSetLayout, descriptorSet);
+            if (result == VK_SUCCESS) {
+                return descriptorSet;
+            }
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+                throw std::runtime_error("failed to allocate descriptor set!");
+            }
+
+            // a set that does not fit an empty pool of the largest size never will
+            if (newPoolSets == MAX_SETS_PER_POOL) {
+                throw std::runtime_error("descriptor set layout does not fit in a descriptor pool!");
+            }
+            poolList.activePool++;
+        }
+    }
+
+    std::unique_ptr<VortexDescriptorPool> VortexDescriptorAllocator::createPool() {
+        VortexDescriptorPool::Builder builder{ vortexDevice };
+        builder.setMaxSets(setsPerPool);
+        for (const auto& poolSizeRatio : poolSizeRatios) {
+            builder.addPoolSize(
+                poolSizeRatio.descriptorType,
+                std::max(1u, static_cast<uint32_t>(poolSizeRatio.ratio * setsPerPool)));
+        }
+
+        // growing keeps the pool count logarithmic in the sets a frame needs
+        setsPerPool = std::min(setsPerPool * 2, MAX_SETS_PER_POOL);
+        return builder.build();
+    }
+
+    // *************** Descriptor Set Cache *********************
+
+    VortexDescriptorSetCache::VortexDescriptorSetCache(VortexDevice& vortexDevice, VortexDescriptorAllocator& allocator)
+        : vortexDevice{ vortexDevice }, allocator{ allocator } {
+        vortexDevice.addResourceListener(this);
+    }
+
+    VortexDescriptorSetCache::~VortexDescriptorSetCache() {
+        // the sets themselves belong to the allocator's persistent pools
+        vortexDevice.removeResourceListener(this);
+    }
+
+    VkDescriptorSet VortexDescriptorSetCache::getDescriptorSet(VortexDescriptorWriter& writer) {
+        VkDescriptorSetLayout layout = writer.setLayout.getDescriptorSetLayout();
+
+        // writes in binding order, so the order they were added in doesn't matter
+        std::vector<const VkWriteDescriptorSet*> writes;
+        for (const auto& write : writer.writes) {
+            writes.push_back(&write);
+        }
+        std::sort(writes.begin(), writes.end(), [](const VkWriteDescriptorSet* a, const VkWriteDescriptorSet* b) {
+            return a->dstBinding < b->dstBinding;
+        });
+
+        std::vector<uint64_t> signature{ handleKey(layout) };
+        std::vector<uint64_t> resources;
+        for (const VkWriteDescriptorSet* write : writes) {
+            signature.push_back(write->dstBinding);
+            signature.push_back(write->descriptorType);
+            for (uint32_t i = 0; i < write->descriptorCount; i++) {
+                if (write->pBufferInfo) {
+                    const auto& bufferInfo = write->pBufferInfo[i];
+                    signature.push_back(handleKey(bufferInfo.buffer));
+                    signature.push_back(bufferInfo.offset);
+                    signature.push_back(bufferInfo.range);
+                    resources.push_back(handleKey(bufferInfo.buffer));
+                }
+                if (write->pImageInfo) {
+                    const auto& imageInfo = write->pImageInfo[i];
+                    signature.push_back(handleKey(imageInfo.sampler));
+                    signature.push_back(handleKey(imageInfo.imageView));
+                    signature.push_back(imageInfo.imageLayout);
+                    resources.push_back(handleKey(imageInfo.imageView));
+                    if (imageInfo.sampler != VK_NULL_HANDLE) {
+                        resources.push_back(handleKey(imageInfo.sampler));
+                    }
+                }
+            }
+        }
+
+        // FNV-1a
+        uint64_t key = 14695981039346656037ull;
+        for (uint64_t value : signature) {
+            key ^= value;
+            key *= 1099511628211ull;
+        }
+
+        std::lock_guard<std::mutex> lock{ mutex };
+        auto it = cachedSets.find(key);
+        if (it != cachedSets.end() && it->second.signature == signature) {
+            hits++;
+            return it->second.descriptorSet;
+        }
+        misses++;
+
+        VkDescriptorSet descriptorSet;
+        auto& freeList = freeSets[layout];
+        if (!freeList.empty()) {
+            descriptorSet = freeList.back();
+            freeList.pop_back();
+        }
+        else {
+            descriptorSet = allocator.allocatePersistent(layout);
+        }
+        writer.overwrite(descriptorSet);
+
+        // on a hash collision the set is still correct, it just isn't cached
+        if (it == cachedSets.end()) {
+            std::sort(resources.begin(), resources.end());
+            resources.erase(std::unique(resources.begin(), resources.end()), resources.end());
+            for (uint64_t resource : resources) {
+                setsByResource.emplace(resource, key);
+            }
+            cachedSets.emplace(key, CachedSet{ descriptorSet, layout, std::move(signature), std::move(resources) });
+        }
+        return descriptorSet;
+    }
+
+    void VortexDescriptorSetCache::onBufferDestroyed(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        invalidate(handleKey(buffer));
+    }
+
+    void VortexDescriptorSetCache::onImageViewDestroyed(VkImageView imageView) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        invalidate(handleKey(imageView));
+    }
+
+    void VortexDescriptorSetCache::onSamplerDestroyed(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{ mutex };
+        invalidate(handleKey(sampler));
+    }
+
+    void VortexDescriptorSetCache::invalidate(uint64_t resource) {
+        auto [first, last] = setsByResource.equal_range(resource);
+        if (first == last) {
+            return;
+        }
+
+        std::vector<uint64_t> keys;
+        for (auto it = first; it != last; ++it) {
+            keys.push_back(it->second);
+        }
+        setsByResource.erase(first, last);
+
+        for (uint64_t key : keys) {
+            auto it = cachedSets.find(key);
+            if (it == cachedSets.end()) {
+                continue;
+            }
+            // the set's entries under its other resources would go stale
+            for (uint64_t otherResource : it->second.resources) {
+                auto [otherFirst, otherLast] = setsByResource.equal_range(otherResource);
+                for (auto other = otherFirst; other != otherLast;) {
+                    other = other->second == key ? setsByResource.erase(other) : std::next(other);
+                }
+            }
+
+            freeSets[it->second.layout].push_back(it->second.descriptorSet);
+            cachedSets.erase(it);
+        }
+    }
+
+    VortexDescriptorSetCache::Stats VortexDescriptorSetCache::getStats() const {
+        std::lock_guard<std::mutex> lock{ mutex };
+        Stats stats{};
+        stats.hits = hits;
+        stats.misses = misses;
+        stats.sets = cachedSets.size();
+        for (const auto& entry : freeSets) {
+            stats.freeSets += entry.second.size();
+        }
+        return stats;
+    }
+
     // *************** Descriptor Writer *********************
 
     VortexDescriptorWriter::VortexDescriptorWriter(VortexDescriptorSetLayout& setLayout, VortexDescriptorPool& pool)
-        : setLayout{ setLayout }, pool{ pool } {}
+        : setLayout{ setLayout }, pool{ &pool } {}
+
+    VortexDescriptorWriter::VortexDescriptorWriter(VortexDescriptorSetLayout& setLayout)
+        : setLayout{ setLayout } {}
 
     VortexDescriptorWriter& VortexDescriptorWriter::writeBuffer(
         uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
@@ -178,7 +448,8 @@ namespace VortexEngine {
     }
 
     bool VortexDescriptorWriter::build(VkDescriptorSet& set) {
-        bool success = pool.allocateDescriptorSet(setLayout.getDescriptorSetLayout(), set);
+        assert(pool && "Cannot build a descriptor set without a pool, allocate it and use overwrite");
+        bool success = pool->allocateDescriptorSet(setLayout.getDescriptorSetLayout(), set);
         if (!success) {
             return false;
         }
@@ -186,11 +457,15 @@ namespace VortexEngine {
         return true;
     }
 
+    VkDescriptorSet VortexDescriptorWriter::build(VortexDescriptorSetCache& cache) {
+        return cache.getDescriptorSet(*this);
+    }
+
     void VortexDescriptorWriter::overwrite(VkDescriptorSet& set) {
         for (auto& write : writes) {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(pool.vortexDevice.device(), writes.size(), writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(setLayout.vortexDevice.device(), writes.size(), writes.data(), 0, nullptr);
     }
 
 }  // namespace vortex
\ No newline at end of file
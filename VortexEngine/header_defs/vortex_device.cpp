@@ -1,7 +1,13 @@
 #include "../headers/vortex_device.h"
+#include "../headers/vortex_geometry_pool.h"
+#include "../headers/vortex_model.h"
+#include "../headers/vortex_upload_queue.h"
 
 // std headers
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -48,17 +54,37 @@ namespace VortexEngine {
     }
 
     // class member functions
-    VortexDevice::VortexDevice(VortexWindow& window) : window{ window } {
+    VortexDevice::VortexDevice(VortexWindow& window) : window{ &window } {
+        init();
+    }
+
+    VortexDevice::VortexDevice() {
+        init();
+    }
+
+    void VortexDevice::init() {
         createInstance();
         setupDebugMessenger();
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createPipelineCache();
+
+        allocator_ = std::make_unique<VortexAllocator>(device_, physicalDevice);
+        uploadQueue_ = std::make_unique<VortexUploadQueue>(*this);
+        geometryPool_ = std::make_unique<VortexGeometryPool>(*this, static_cast<uint32_t>(sizeof(VortexModel::Vertex)));
     }
 
     VortexDevice::~VortexDevice() {
+        // owns command buffers from commandPool and a staging buffer
+        uploadQueue_.reset();
+        geometryPool_.reset();
+
+        savePipelineCache();
+        vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
         vkDestroyCommandPool(device_, commandPool, nullptr);
+        allocator_.reset();
         vkDestroyDevice(device_, nullptr);
 
         if (enableValidationLayers) {
@@ -80,7 +106,8 @@ namespace VortexEngine {
         appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.pEngineName = "Vortex Engine";
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        // 1.1 for vkGetPhysicalDeviceFeatures2, used to detect descriptor indexing
+        appInfo.apiVersion = VK_API_VERSION_1_1;
 
         VkInstanceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -151,18 +178,70 @@ namespace VortexEngine {
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
         VkPhysicalDeviceFeatures deviceFeatures = {};
         deviceFeatures.samplerAnisotropy = VK_TRUE;
+        // optional, used by the GPU driven render path when present
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+        // optional bindless resources
+        VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexingFeatures = {};
+        supportedIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        if (properties.apiVersion >= VK_API_VERSION_1_1 &&
+            isDeviceExtensionAvailable(physicalDevice, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+            VkPhysicalDeviceFeatures2 features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &supportedIndexingFeatures;
+            vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+            // the material buffer index is dynamically uniform, which is a core feature
+            bindlessSupported =
+                supportedFeatures.shaderStorageBufferArrayDynamicIndexing &&
+                supportedIndexingFeatures.runtimeDescriptorArray &&
+                supportedIndexingFeatures.descriptorBindingPartiallyBound &&
+                supportedIndexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+                supportedIndexingFeatures.shaderStorageBufferArrayNonUniformIndexing &&
+                supportedIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+                supportedIndexingFeatures.descriptorBindingStorageBufferUpdateAfterBind &&
+                supportedIndexingFeatures.descriptorBindingUpdateUnusedWhilePending;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures = {};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+        auto requiredDeviceExtensions = getRequiredDeviceExtensions();
+        if (bindlessSupported) {
+            deviceFeatures.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+            indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            indexingFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            requiredDeviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+            descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+            VkPhysicalDeviceProperties2 properties2 = {};
+            properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties2.pNext = &descriptorIndexingProperties;
+            vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+            descriptorIndexingProperties.pNext = nullptr;
+        }
+        enabledFeatures = deviceFeatures;
 
         VkDeviceCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = bindlessSupported ? &indexingFeatures : nullptr;
 
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
         createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(requiredDeviceExtensions.size());
+        createInfo.ppEnabledExtensionNames = requiredDeviceExtensions.data();
 
         // might not really be necessary anymore because device specific validation layers
         // have been deprecated
@@ -196,15 +275,157 @@ namespace VortexEngine {
         }
     }
 
-    void VortexDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+    void VortexDevice::createPipelineCache() {
+        std::vector<char> initialData;
+        {
+            std::ifstream file{ PIPELINE_CACHE_PATH, std::ios::ate | std::ios::binary };
+            if (file.is_open()) {
+                initialData.resize(static_cast<size_t>(file.tellg()));
+                file.seekg(0);
+                file.read(initialData.data(), static_cast<std::streamsize>(initialData.size()));
+                if (!file.good()) {
+                    initialData.clear();
+                }
+            }
+        }
+
+        // some drivers crash on data from another driver version instead of ignoring it, so a
+        // mismatching file is dropped here and the cache starts empty
+        if (!initialData.empty() && !isPipelineCacheCompatible(initialData)) {
+            std::cout << "Ignoring pipeline cache written by a different GPU or driver" << std::endl;
+            initialData.clear();
+        }
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = initialData.size();
+        createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+        if (vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+            // the driver may still reject data that passed the header check
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            initialData.clear();
+            if (vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create pipeline cache!");
+            }
+        }
+
+        pipelineCacheWarm = !initialData.empty();
+    }
+
+    bool VortexDevice::isPipelineCacheCompatible(const std::vector<char>& data) const {
+        // VkPipelineCacheHeaderVersionOne: headerSize, headerVersion, vendorID, deviceID, UUID
+        constexpr size_t headerSize = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+        if (data.size() < headerSize) {
+            return false;
+        }
+
+        uint32_t fields[4];
+        memcpy(fields, data.data(), sizeof(fields));
+        if (fields[0] < headerSize ||
+            fields[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            fields[2] != properties.vendorID ||
+            fields[3] != properties.deviceID) {
+            return false;
+        }
+
+        return memcmp(data.data() + sizeof(fields), properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+    }
+
+    void VortexDevice::addResourceListener(VortexResourceListener* listener) {
+        std::lock_guard<std::mutex> lock{ resourceListenerMutex };
+        resourceListeners.push_back(listener);
+    }
+
+    void VortexDevice::removeResourceListener(VortexResourceListener* listener) {
+        std::lock_guard<std::mutex> lock{ resourceListenerMutex };
+        resourceListeners.erase(
+            std::remove(resourceListeners.begin(), resourceListeners.end(), listener),
+            resourceListeners.end());
+    }
+
+    void VortexDevice::notifyBufferDestroyed(VkBuffer buffer) {
+        std::lock_guard<std::mutex> lock{ resourceListenerMutex };
+        for (auto* listener : resourceListeners) {
+            listener->onBufferDestroyed(buffer);
+        }
+    }
+
+    void VortexDevice::notifyImageViewDestroyed(VkImageView imageView) {
+        std::lock_guard<std::mutex> lock{ resourceListenerMutex };
+        for (auto* listener : resourceListeners) {
+            listener->onImageViewDestroyed(imageView);
+        }
+    }
+
+    void VortexDevice::notifySamplerDestroyed(VkSampler sampler) {
+        std::lock_guard<std::mutex> lock{ resourceListenerMutex };
+        for (auto* listener : resourceListeners) {
+            listener->onSamplerDestroyed(sampler);
+        }
+    }
+
+    bool VortexDevice::savePipelineCache() {
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+            return false;
+        }
+
+        std::vector<char> data(dataSize);
+        if (vkGetPipelineCacheData(device_, pipelineCache_, &dataSize, data.data()) != VK_SUCCESS) {
+            return false;
+        }
+
+        std::error_code error;
+        std::filesystem::path cachePath{ PIPELINE_CACHE_PATH };
+        std::filesystem::create_directories(cachePath.parent_path(), error);
+        if (error) {
+            return false;
+        }
+
+        // write to a temporary file first so a crash never leaves a half written cache behind
+        std::filesystem::path tempPath = cachePath;
+        tempPath += ".tmp";
+        {
+            std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+            if (!file.is_open()) {
+                return false;
+            }
+
+            file.write(data.data(), static_cast<std::streamsize>(dataSize));
+            if (!file.good()) {
+                file.close();
+                std::filesystem::remove(tempPath, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, cachePath, error);
+        if (error) {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+
+        return true;
+    }
+
+    void VortexDevice::createSurface() {
+        if (isHeadless()) {
+            return;
+        }
+
+        window->createWindowSurface(instance, &surface_);
+    }
 
     bool VortexDevice::isDeviceSuitable(VkPhysicalDevice device) {
         QueueFamilyIndices indices = findQueueFamilies(device);
 
         bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-        bool swapChainAdequate = false;
-        if (extensionsSupported) {
+        // a headless device renders into offscreen images and never presents
+        bool swapChainAdequate = isHeadless();
+        if (extensionsSupported && !isHeadless()) {
             SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -264,11 +485,15 @@ namespace VortexEngine {
     }
 
     std::vector<const char*> VortexDevice::getRequiredExtensions() {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        std::vector<const char*> extensions;
 
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        if (!isHeadless()) {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -277,6 +502,14 @@ namespace VortexEngine {
         return extensions;
     }
 
+    std::vector<const char*> VortexDevice::getRequiredDeviceExtensions() {
+        if (isHeadless()) {
+            return {};
+        }
+
+        return deviceExtensions;
+    }
+
     void VortexDevice::hasGflwRequiredInstanceExtensions() {
         uint32_t extensionCount = 0;
         vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
@@ -311,7 +544,8 @@ namespace VortexEngine {
             &extensionCount,
             availableExtensions.data());
 
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+        auto requiredDeviceExtensions = getRequiredDeviceExtensions();
+        std::set<std::string> requiredExtensions(requiredDeviceExtensions.begin(), requiredDeviceExtensions.end());
 
         for (const auto& extension : availableExtensions) {
             requiredExtensions.erase(extension.extensionName);
@@ -320,6 +554,25 @@ namespace VortexEngine {
         return requiredExtensions.empty();
     }
 
+    bool VortexDevice::isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName) {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(
+            device,
+            nullptr,
+            &extensionCount,
+            availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, extensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     QueueFamilyIndices VortexDevice::findQueueFamilies(VkPhysicalDevice device) {
         QueueFamilyIndices indices;
 
@@ -336,7 +589,13 @@ namespace VortexEngine {
                 indices.graphicsFamilyHasValue = true;
             }
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+            if (isHeadless()) {
+                // nothing is presented, so the graphics queue doubles as the "present" queue
+                presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == static_cast<uint32_t>(i);
+            }
+            else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+            }
             if (queueFamily.queueCount > 0 && presentSupport) {
                 indices.presentFamily = i;
                 indices.presentFamilyHasValue = true;
@@ -412,7 +671,7 @@ namespace VortexEngine {
         VkBufferUsageFlags usage,
         VkMemoryPropertyFlags properties,
         VkBuffer& buffer,
-        VkDeviceMemory& bufferMemory) {
+        VortexAllocation& bufferMemory) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
@@ -426,16 +685,11 @@ namespace VortexEngine {
         VkMemoryRequirements memRequirements;
         vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+        bufferMemory = allocator_->allocate(memRequirements, properties, VortexAllocator::ResourceType::Buffer);
 
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+        if (vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind vertex buffer memory!");
         }
-
-        vkBindBufferMemory(device_, buffer, bufferMemory, 0);
     }
 
     VkCommandBuffer VortexDevice::beginSingleTimeCommands() {
@@ -470,50 +724,11 @@ namespace VortexEngine {
         vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
     }
 
-    void VortexDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-        VkBufferCopy copyRegion{};
-        copyRegion.srcOffset = 0;  // Optional
-        copyRegion.dstOffset = 0;  // Optional
-        copyRegion.size = size;
-        vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-        endSingleTimeCommands(commandBuffer);
-    }
-
-    void VortexDevice::copyBufferToImage(
-        VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-        VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = layerCount;
-
-        region.imageOffset = { 0, 0, 0 };
-        region.imageExtent = { width, height, 1 };
-
-        vkCmdCopyBufferToImage(
-            commandBuffer,
-            buffer,
-            image,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region);
-        endSingleTimeCommands(commandBuffer);
-    }
-
     void VortexDevice::createImageWithInfo(
         const VkImageCreateInfo& imageInfo,
         VkMemoryPropertyFlags properties,
         VkImage& image,
-        VkDeviceMemory& imageMemory) {
+        VortexAllocation& imageMemory) {
         if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
@@ -521,16 +736,12 @@ namespace VortexEngine {
         VkMemoryRequirements memRequirements;
         vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-        if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
+        auto resourceType = imageInfo.tiling == VK_IMAGE_TILING_LINEAR
+            ? VortexAllocator::ResourceType::Buffer
+            : VortexAllocator::ResourceType::Image;
+        imageMemory = allocator_->allocate(memRequirements, properties, resourceType);
 
-        if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+        if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
             throw std::runtime_error("failed to bind image memory!");
         }
     }
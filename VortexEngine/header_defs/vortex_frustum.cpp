@@ -0,0 +1,119 @@
+#include "../headers/vortex_frustum.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define VORTEX_FRUSTUM_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace VortexEngine {
+
+	VortexAABB VortexAABB::transformed(const glm::mat4& transform) const {
+		// Arvo: the new half extents are the old ones through the absolute rotation/scale part
+		const glm::mat3 linear{ transform };
+		const glm::mat3 absLinear{ glm::abs(linear[0]), glm::abs(linear[1]), glm::abs(linear[2]) };
+
+		const glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center(), 1.0f));
+		const glm::vec3 newExtents = absLinear * extents();
+		return VortexAABB{ newCenter - newExtents, newCenter + newExtents };
+	}
+
+	glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& transform) {
+		const glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f));
+		const float scale = std::max({
+			glm::length(glm::vec3(transform[0])),
+			glm::length(glm::vec3(transform[1])),
+			glm::length(glm::vec3(transform[2])) });
+		return glm::vec4(center, sphere.w * scale);
+	}
+
+	VortexFrustum::VortexFrustum(const std::array<glm::vec4, 6>& planes) : planes{ planes } {}
+
+	bool VortexFrustum::intersectsSphere(const glm::vec4& sphere) const {
+		for (auto& plane : planes) {
+			if (glm::dot(glm::vec3(plane), glm::vec3(sphere)) + plane.w < -sphere.w) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VortexFrustum::intersectsAABB(const VortexAABB& box) const {
+		const glm::vec3 center = box.center();
+		const glm::vec3 extents = box.extents();
+
+		for (auto& plane : planes) {
+			const glm::vec3 normal{ plane };
+			const float radius = glm::dot(extents, glm::abs(normal));
+			if (glm::dot(normal, center) + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool VortexFrustum::containsAABB(const VortexAABB& box) const {
+		const glm::vec3 center = box.center();
+		const glm::vec3 extents = box.extents();
+
+		for (auto& plane : planes) {
+			const glm::vec3 normal{ plane };
+			const float radius = glm::dot(extents, glm::abs(normal));
+			if (glm::dot(normal, center) + plane.w < radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	size_t VortexFrustum::cullSpheres(const glm::vec4* spheres, size_t count, uint8_t* visible) const {
+		size_t visibleCount = 0;
+		size_t i = 0;
+
+#ifdef VORTEX_FRUSTUM_SSE
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		for (size_t p = 0; p < planes.size(); p++) {
+			planeX[p] = _mm_set1_ps(planes[p].x);
+			planeY[p] = _mm_set1_ps(planes[p].y);
+			planeZ[p] = _mm_set1_ps(planes[p].z);
+			planeW[p] = _mm_set1_ps(planes[p].w);
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; i + 4 <= count; i += 4) {
+			// four (x, y, z, r) spheres into x, y, z and r lanes
+			__m128 x = _mm_loadu_ps(&spheres[i].x);
+			__m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+			__m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+			__m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+			_MM_TRANSPOSE4_PS(x, y, z, r);
+			const __m128 negativeRadius = _mm_sub_ps(zero, r);
+
+			__m128 outside = _mm_setzero_ps();
+			for (size_t p = 0; p < planes.size(); p++) {
+				__m128 distance = _mm_add_ps(
+					_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+					_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+			}
+
+			const int outsideMask = _mm_movemask_ps(outside);
+			for (int lane = 0; lane < 4; lane++) {
+				const uint8_t isVisible = ((outsideMask >> lane) & 1) ? 0 : 1;
+				visible[i + lane] = isVisible;
+				visibleCount += isVisible;
+			}
+		}
+#endif
+
+		for (; i < count; i++) {
+			const uint8_t isVisible = intersectsSphere(spheres[i]) ? 1 : 0;
+			visible[i] = isVisible;
+			visibleCount += isVisible;
+		}
+
+		return visibleCount;
+	}
+}
@@ -0,0 +1,126 @@
+#include "../headers/vortex_geometry_pool.h"
+#include "../headers/vortex_upload_queue.h"
+#include "../headers/vortex_swap_chain.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace VortexEngine {
+
+    VortexGeometryPool::VortexGeometryPool(
+        VortexDevice& device, uint32_t vertexStride, uint32_t verticesPerPage, uint32_t indicesPerPage)
+        : vortexDevice{ device },
+        vertexArena{ vertexStride, verticesPerPage, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT },
+        indexArena{ sizeof(uint32_t), indicesPerPage, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT } {}
+
+    VortexGeometryPool::~VortexGeometryPool() {}
+
+    VortexGeometryPool::Range VortexGeometryPool::allocateVertices(const void* vertices, uint32_t count) {
+        return allocate(vertexArena, vertices, count);
+    }
+
+    VortexGeometryPool::Range VortexGeometryPool::allocateIndices(const uint32_t* indices, uint32_t count) {
+        return allocate(indexArena, indices, count);
+    }
+
+    void VortexGeometryPool::freeVertices(Range& range) {
+        free(vertexArena, range);
+    }
+
+    void VortexGeometryPool::freeIndices(Range& range) {
+        free(indexArena, range);
+    }
+
+    void VortexGeometryPool::beginFrame() {
+        frameNumber++;
+
+        // the renderer has waited for every frame up to MAX_FRAMES_IN_FLIGHT ago
+        while (!releasedRanges.empty() &&
+            releasedRanges.front().frame + VortexSwapChain::MAX_FRAMES_IN_FLIGHT <= frameNumber) {
+            ReleasedRange& released = releasedRanges.front();
+            released.arena->pages[released.range.page].ranges.free(released.range.allocation);
+            releasedRanges.pop_front();
+        }
+    }
+
+    void VortexGeometryPool::bindVertexPage(VkCommandBuffer commandBuffer, uint32_t page) {
+        VkBuffer buffers[] = { getVertexBuffer(page) };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+    }
+
+    void VortexGeometryPool::bindIndexPage(VkCommandBuffer commandBuffer, uint32_t page) {
+        vkCmdBindIndexBuffer(commandBuffer, getIndexBuffer(page), 0, VK_INDEX_TYPE_UINT32);
+    }
+
+    VortexGeometryPool::Stats VortexGeometryPool::getStats() const {
+        Stats stats{};
+        stats.vertexPages = static_cast<uint32_t>(vertexArena.pages.size());
+        stats.indexPages = static_cast<uint32_t>(indexArena.pages.size());
+
+        for (auto& page : vertexArena.pages) {
+            stats.verticesUsed += page.ranges.getUsedSize();
+            stats.vertexCapacity += page.ranges.getSize();
+        }
+        for (auto& page : indexArena.pages) {
+            stats.indicesUsed += page.ranges.getUsedSize();
+            stats.indexCapacity += page.ranges.getSize();
+        }
+        return stats;
+    }
+
+    VortexGeometryPool::Range VortexGeometryPool::allocate(Arena& arena, const void* data, uint32_t count) {
+        assert(count > 0 && "Cannot allocate an empty geometry range");
+
+        Range range{};
+        range.count = count;
+
+        for (uint32_t i = 0; i < arena.pages.size() && !range.isValid(); i++) {
+            range.allocation = arena.pages[i].ranges.allocate(count);
+            range.page = i;
+        }
+
+        if (!range.isValid()) {
+            uint32_t pageElements = std::max(count, arena.elementsPerPage);
+
+            Page page{
+                std::make_unique<VortexBuffer>(
+                    vortexDevice,
+                    arena.elementSize,
+                    pageElements,
+                    arena.usage,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+                VortexOffsetAllocator{ pageElements },
+            };
+            arena.pages.push_back(std::move(page));
+
+            range.page = static_cast<uint32_t>(arena.pages.size() - 1);
+            range.allocation = arena.pages.back().ranges.allocate(count);
+            if (!range.isValid()) {
+                throw std::runtime_error("failed to allocate geometry from a fresh page!");
+            }
+        }
+
+        range.first = static_cast<uint32_t>(range.allocation.offset);
+
+        vortexDevice.uploadQueue().uploadToBuffer(
+            arena.pages[range.page].buffer->getBuffer(),
+            data,
+            static_cast<VkDeviceSize>(count) * arena.elementSize,
+            static_cast<VkDeviceSize>(range.first) * arena.elementSize);
+
+        return range;
+    }
+
+    void VortexGeometryPool::free(Arena& arena, Range& range) {
+        if (!range.isValid()) {
+            return;
+        }
+
+        releasedRanges.push_back({ frameNumber, &arena, range });
+        range = Range{};
+    }
+
+}  // namespace VortexEngine
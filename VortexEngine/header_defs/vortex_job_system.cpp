@@ -0,0 +1,177 @@
+#include "../headers/vortex_job_system.h"
+
+namespace VortexEngine {
+
+	namespace {
+		// set on worker threads, so jobs queued from inside a job land on that worker's deque
+		thread_local const VortexJobSystem* currentJobSystem = nullptr;
+		thread_local uint32_t currentQueueIndex = 0;
+	}
+
+	VortexJobSystem::VortexJobSystem(uint32_t workerCount) {
+		if (workerCount == 0) {
+			uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		queues.reserve(static_cast<size_t>(workerCount) + 1);
+		for (uint32_t i = 0; i <= workerCount; i++) {
+			queues.push_back(std::make_unique<WorkQueue>());
+		}
+
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++) {
+			workers.emplace_back(&VortexJobSystem::workerLoop, this, i + 1);
+		}
+	}
+
+	VortexJobSystem::~VortexJobSystem() {
+		stopping = true;
+		wakeWorkers(true);
+
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	void VortexJobSystem::run(Job job, VortexJobCounter* counter, const VortexJobCounter* dependency) {
+		if (counter) {
+			counter->pending.fetch_add(1, std::memory_order_relaxed);
+		}
+		push(*queues[currentQueue()], QueuedJob{ std::move(job), counter, dependency });
+	}
+
+	void VortexJobSystem::runBackground(Job job, VortexJobCounter* counter, Priority priority) {
+		if (counter) {
+			counter->pending.fetch_add(1, std::memory_order_relaxed);
+		}
+		push(priority == Priority::High ? highPriorityBackgroundQueue : backgroundQueue, QueuedJob{ std::move(job), counter, nullptr });
+	}
+
+	void VortexJobSystem::wait(const VortexJobCounter& counter) {
+		uint32_t queueIndex = currentQueue();
+		while (!counter.isDone()) {
+			if (!tryRunJob(queueIndex, false)) {
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	void VortexJobSystem::push(WorkQueue& queue, QueuedJob job) {
+		{
+			std::lock_guard<std::mutex> lock{ queue.mutex };
+			queue.jobs.push_back(std::move(job));
+		}
+		queuedJobs.fetch_add(1);
+		wakeWorkers(false);
+	}
+
+	void VortexJobSystem::wakeWorkers(bool all) {
+		// a worker checks queuedJobs under sleepMutex before sleeping, so taking it here means the
+		// notification cannot slip in between that check and the wait
+		{
+			std::lock_guard<std::mutex> lock{ sleepMutex };
+		}
+
+		if (all) {
+			wakeCondition.notify_all();
+		}
+		else {
+			wakeCondition.notify_one();
+		}
+	}
+
+	bool VortexJobSystem::takeJob(uint32_t queueIndex, bool allowBackground, QueuedJob& job) {
+		// newest own job first, its data is most likely still in cache
+		{
+			WorkQueue& own = *queues[queueIndex];
+			std::lock_guard<std::mutex> lock{ own.mutex };
+			if (!own.jobs.empty()) {
+				job = std::move(own.jobs.back());
+				own.jobs.pop_back();
+				queuedJobs.fetch_sub(1);
+				return true;
+			}
+		}
+
+		// then the oldest job of another queue, starting after our own so thieves spread out
+		for (size_t offset = 1; offset < queues.size(); offset++) {
+			WorkQueue& victim = *queues[(queueIndex + offset) % queues.size()];
+			std::lock_guard<std::mutex> lock{ victim.mutex };
+			if (!victim.jobs.empty()) {
+				job = std::move(victim.jobs.front());
+				victim.jobs.pop_front();
+				queuedJobs.fetch_sub(1);
+				return true;
+			}
+		}
+
+		if (allowBackground) {
+			for (WorkQueue* background : { &highPriorityBackgroundQueue, &backgroundQueue }) {
+				std::lock_guard<std::mutex> lock{ background->mutex };
+				if (!background->jobs.empty()) {
+					job = std::move(background->jobs.front());
+					background->jobs.pop_front();
+					queuedJobs.fetch_sub(1);
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	bool VortexJobSystem::tryRunJob(uint32_t queueIndex, bool allowBackground) {
+		QueuedJob job;
+		if (!takeJob(queueIndex, allowBackground, job)) {
+			return false;
+		}
+
+		if (job.dependency && !job.dependency->isDone()) {
+			// not runnable yet; the front of our own deque is the last place we pop from
+			WorkQueue& own = *queues[queueIndex];
+			{
+				std::lock_guard<std::mutex> lock{ own.mutex };
+				own.jobs.push_front(std::move(job));
+			}
+			queuedJobs.fetch_add(1);
+			return false;
+		}
+
+		execute(job);
+		return true;
+	}
+
+	void VortexJobSystem::execute(QueuedJob& job) {
+		job.job();
+		// release whatever the job captured before anyone waiting on the counter moves on
+		job.job = nullptr;
+		if (job.counter) {
+			job.counter->pending.fetch_sub(1, std::memory_order_release);
+		}
+	}
+
+	uint32_t VortexJobSystem::currentQueue() const {
+		return currentJobSystem == this ? currentQueueIndex : 0;
+	}
+
+	void VortexJobSystem::workerLoop(uint32_t queueIndex) {
+		currentJobSystem = this;
+		currentQueueIndex = queueIndex;
+
+		while (!stopping) {
+			if (tryRunJob(queueIndex, true)) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock{ sleepMutex };
+			if (queuedJobs > 0) {
+				// queued jobs are waiting on dependencies or were just taken by someone else
+				lock.unlock();
+				std::this_thread::yield();
+				continue;
+			}
+			wakeCondition.wait(lock, [this]() { return stopping || queuedJobs > 0; });
+		}
+	}
+}
@@ -0,0 +1,295 @@
+#include "../headers/vortex_mesh_cache.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <type_traits>
+
+namespace VortexEngine {
+
+	namespace {
+		constexpr char MESH_CACHE_MAGIC[4] = { 'V', 'X', 'M', 'C' };
+		constexpr uint64_t MESH_CACHE_DATA_ALIGNMENT = 16;
+
+		// Fixed size file header. Geometry follows the source path at vertexOffset / indexOffset.
+		struct MeshCacheHeader {
+			char magic[4];
+			uint32_t version;
+			uint32_t vertexStride;
+			uint32_t pathLength;
+			uint64_t sourceSize;
+			int64_t sourceModifiedTime;
+			uint32_t vertexCount;
+			uint32_t indexCount;
+			uint64_t vertexOffset;
+			uint64_t indexOffset;
+			float boundsMin[3];
+			float boundsMax[3];
+			float boundingSphere[4];
+		};
+
+		static_assert(std::is_trivially_copyable<MeshCacheHeader>::value, "Mesh cache header must be POD");
+		static_assert(std::is_trivially_copyable<VortexModel::Vertex>::value, "Vertex must be POD to be cached");
+
+		struct SourceKey {
+			std::string path;
+			uint64_t size;
+			int64_t modifiedTime;
+		};
+
+		bool getSourceKey(const std::string& sourcePath, SourceKey& key) {
+			std::error_code error;
+			std::filesystem::path absolutePath = std::filesystem::absolute(sourcePath, error);
+			if (error) {
+				return false;
+			}
+
+			key.path = absolutePath.lexically_normal().generic_string();
+			key.size = static_cast<uint64_t>(std::filesystem::file_size(absolutePath, error));
+			if (error) {
+				return false;
+			}
+
+			auto writeTime = std::filesystem::last_write_time(absolutePath, error);
+			if (error) {
+				return false;
+			}
+			key.modifiedTime = static_cast<int64_t>(writeTime.time_since_epoch().count());
+
+			return true;
+		}
+
+		uint64_t alignOffset(uint64_t offset, uint64_t alignment) {
+			return (offset + alignment - 1) & ~(alignment - 1);
+		}
+
+		uint64_t hashPath(const std::string& path) {
+			// FNV-1a, only used to derive a stable file name
+			uint64_t hash = 14695981039346656037ull;
+			for (char c : path) {
+				hash ^= static_cast<uint8_t>(c);
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+	}
+
+	VortexMeshCache::MappedMesh::~MappedMesh() {
+#ifdef _WIN32
+		if (view) {
+			UnmapViewOfFile(view);
+		}
+		if (mappingHandle) {
+			CloseHandle(mappingHandle);
+		}
+		if (fileHandle) {
+			CloseHandle(fileHandle);
+		}
+#else
+		if (view) {
+			munmap(view, viewSize);
+		}
+#endif
+	}
+
+	std::string& VortexMeshCache::cacheDirectory() {
+		static std::string directory = "cache/meshes";
+		return directory;
+	}
+
+	std::string VortexMeshCache::cacheFilePath(const std::string& sourcePath) {
+		SourceKey key{};
+		std::string keyPath = getSourceKey(sourcePath, key) ? key.path : sourcePath;
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.vmesh", static_cast<unsigned long long>(hashPath(keyPath)));
+
+		return (std::filesystem::path(cacheDirectory()) / name).string();
+	}
+
+	std::unique_ptr<VortexMeshCache::MappedMesh> VortexMeshCache::mapFile(const std::string& path) {
+		std::unique_ptr<MappedMesh> mesh{ new MappedMesh() };
+
+#ifdef _WIN32
+		HANDLE file = CreateFileA(
+			path.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			return nullptr;
+		}
+		mesh->fileHandle = file;
+
+		LARGE_INTEGER fileSize{};
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			return nullptr;
+		}
+		mesh->viewSize = static_cast<size_t>(fileSize.QuadPart);
+
+		mesh->mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mesh->mappingHandle) {
+			return nullptr;
+		}
+
+		mesh->view = MapViewOfFile(mesh->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		if (!mesh->view) {
+			return nullptr;
+		}
+#else
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return nullptr;
+		}
+
+		struct stat fileStat {};
+		if (fstat(fd, &fileStat) != 0 || fileStat.st_size == 0) {
+			close(fd);
+			return nullptr;
+		}
+		mesh->viewSize = static_cast<size_t>(fileStat.st_size);
+
+		void* view = mmap(nullptr, mesh->viewSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (view == MAP_FAILED) {
+			return nullptr;
+		}
+		mesh->view = view;
+#endif
+
+		return mesh;
+	}
+
+	std::unique_ptr<VortexMeshCache::MappedMesh> VortexMeshCache::load(const std::string& sourcePath) {
+		SourceKey key{};
+		if (!getSourceKey(sourcePath, key)) {
+			return nullptr;
+		}
+
+		auto mesh = mapFile(cacheFilePath(sourcePath));
+		if (!mesh || mesh->viewSize < sizeof(MeshCacheHeader)) {
+			return nullptr;
+		}
+
+		const char* bytes = static_cast<const char*>(mesh->view);
+		MeshCacheHeader header{};
+		memcpy(&header, bytes, sizeof(header));
+
+		if (memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+			header.version != VERSION ||
+			header.vertexStride != sizeof(VortexModel::Vertex) ||
+			header.sourceSize != key.size ||
+			header.sourceModifiedTime != key.modifiedTime ||
+			header.pathLength != key.path.size() ||
+			header.vertexCount == 0) {
+			return nullptr;
+		}
+
+		if (sizeof(header) + header.pathLength > mesh->viewSize ||
+			memcmp(bytes + sizeof(header), key.path.data(), header.pathLength) != 0) {
+			return nullptr;
+		}
+
+		uint64_t vertexBytes = static_cast<uint64_t>(header.vertexCount) * sizeof(VortexModel::Vertex);
+		uint64_t indexBytes = static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t);
+		if (header.vertexOffset + vertexBytes > mesh->viewSize || header.indexOffset + indexBytes > mesh->viewSize) {
+			return nullptr;
+		}
+
+		mesh->vertexData = reinterpret_cast<const VortexModel::Vertex*>(bytes + header.vertexOffset);
+		mesh->indexData = reinterpret_cast<const uint32_t*>(bytes + header.indexOffset);
+		mesh->vertexCount = header.vertexCount;
+		mesh->indexCount = header.indexCount;
+		mesh->boundingBox = VortexAABB{
+			glm::vec3{ header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] },
+			glm::vec3{ header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] } };
+		mesh->boundingSphere = glm::vec4{
+			header.boundingSphere[0], header.boundingSphere[1], header.boundingSphere[2], header.boundingSphere[3] };
+
+		return mesh;
+	}
+
+	bool VortexMeshCache::store(const std::string& sourcePath, const VortexModel::Builder& builder) {
+		SourceKey key{};
+		if (!getSourceKey(sourcePath, key) || builder.vertices.empty()) {
+			return false;
+		}
+
+		MeshCacheHeader header{};
+		memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+		header.version = VERSION;
+		header.vertexStride = sizeof(VortexModel::Vertex);
+		header.pathLength = static_cast<uint32_t>(key.path.size());
+		header.sourceSize = key.size;
+		header.sourceModifiedTime = key.modifiedTime;
+		header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+		header.indexCount = static_cast<uint32_t>(builder.indices.size());
+		for (int axis = 0; axis < 3; axis++) {
+			header.boundsMin[axis] = builder.boundingBox.min[axis];
+			header.boundsMax[axis] = builder.boundingBox.max[axis];
+		}
+		for (int component = 0; component < 4; component++) {
+			header.boundingSphere[component] = builder.boundingSphere[component];
+		}
+
+		uint64_t vertexBytes = static_cast<uint64_t>(header.vertexCount) * sizeof(VortexModel::Vertex);
+		header.vertexOffset = alignOffset(sizeof(header) + header.pathLength, MESH_CACHE_DATA_ALIGNMENT);
+		header.indexOffset = alignOffset(header.vertexOffset + vertexBytes, MESH_CACHE_DATA_ALIGNMENT);
+
+		std::error_code error;
+		std::filesystem::create_directories(cacheDirectory(), error);
+		if (error) {
+			return false;
+		}
+
+		// write to a temporary file first so a crash never leaves a half written entry behind
+		std::string cachePath = cacheFilePath(sourcePath);
+		std::string tempPath = cachePath + ".tmp";
+		{
+			std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+			if (!file.is_open()) {
+				return false;
+			}
+
+			const char padding[MESH_CACHE_DATA_ALIGNMENT] = {};
+
+			file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			file.write(key.path.data(), header.pathLength);
+			file.write(padding, header.vertexOffset - (sizeof(header) + header.pathLength));
+			file.write(reinterpret_cast<const char*>(builder.vertices.data()), vertexBytes);
+			file.write(padding, header.indexOffset - (header.vertexOffset + vertexBytes));
+			file.write(
+				reinterpret_cast<const char*>(builder.indices.data()),
+				static_cast<std::streamsize>(header.indexCount) * sizeof(uint32_t));
+
+			if (!file.good()) {
+				file.close();
+				std::filesystem::remove(tempPath, error);
+				return false;
+			}
+		}
+
+		std::filesystem::rename(tempPath, cachePath, error);
+		if (error) {
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -1,122 +1,107 @@
 #include "../headers/vortex_model.h"
 
 #include "../headers/vortex_utils.h"
+#include "../headers/vortex_mesh_cache.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
-
-#include <cstring>
-#include <unordered_map>
-
-namespace std {
-	template<>
-	struct hash<VortexEngine::VortexModel::Vertex> {
-		size_t operator()(VortexEngine::VortexModel::Vertex const& vertex) const {
-			size_t seed = 0;
-			VortexEngine::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-
-			return seed;
-		}
-	};
-}
+#include <cassert>
 
 namespace VortexEngine {
-	VortexModel::VortexModel(VortexDevice& vortexDevice, const VortexModel::Builder &builder) : vortexDevice{ vortexDevice } {
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+	VortexModel::VortexModel(VortexDevice& vortexDevice, const VortexModel::Builder &builder)
+		: VortexModel(
+			vortexDevice,
+			builder.vertices.data(),
+			static_cast<uint32_t>(builder.vertices.size()),
+			builder.indices.data(),
+			static_cast<uint32_t>(builder.indices.size()),
+			builder.boundingBox,
+			builder.boundingSphere) {}
+
+	VortexModel::VortexModel(
+		VortexDevice& vortexDevice,
+		const Vertex* vertices,
+		uint32_t vertexCount,
+		const uint32_t* indices,
+		uint32_t indexCount,
+		const VortexAABB& boundingBox,
+		const glm::vec4& boundingSphere)
+		: vortexDevice{ vortexDevice }, boundingSphere{ boundingSphere }, boundingBox{ boundingBox } {
+		createVertexBuffers(vertices, vertexCount);
+		createIndexBuffers(indices, indexCount);
 	}
 
-	VortexModel::~VortexModel() {}
+	VortexModel::~VortexModel() {
+		vortexDevice.geometryPool().freeVertices(vertexRange);
+		vortexDevice.geometryPool().freeIndices(indexRange);
+	}
 
 	std::unique_ptr<VortexModel> VortexModel::createModelFromFile(VortexDevice& device, const std::string& filepath) {
+		// warm start: upload straight out of the mapped cache file
+		if (auto cachedMesh = VortexMeshCache::load(filepath)) {
+			return std::make_unique<VortexModel>(
+				device,
+				cachedMesh->vertices(),
+				cachedMesh->getVertexCount(),
+				cachedMesh->indices(),
+				cachedMesh->getIndexCount(),
+				cachedMesh->getBoundingBox(),
+				cachedMesh->getBoundingSphere());
+		}
+
 		Builder builder{};
 		builder.loadModel(filepath);
+		VortexMeshCache::store(filepath, builder);
 
 		return std::make_unique<VortexModel>(device, builder);
 	}
 
-	void VortexModel::createVertexBuffers(const std::vector<Vertex>& vertices) {
-		vertexCount = static_cast<uint32_t>(vertices.size());
+	void VortexModel::createVertexBuffers(const Vertex* vertices, uint32_t count) {
+		vertexCount = count;
 		assert(vertexCount >= 3 && "Vertex count must be at least 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
-
-		VortexBuffer stagingBuffer {
-			vortexDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
 
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data());
-
-		vertexBuffer = std::make_unique<VortexBuffer>(
-			vortexDevice,
-			vertexSize,
-			vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
-
-		vortexDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		// recorded into the shared upload batch, visible to the next frame submitted after a flush
+		vertexRange = vortexDevice.geometryPool().allocateVertices(vertices, vertexCount);
 	}
 
-	void VortexModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
-		indexCount = static_cast<uint32_t>(indices.size());
+	void VortexModel::createIndexBuffers(const uint32_t* indices, uint32_t count) {
+		indexCount = count;
 		hasIndexBuffer = indexCount > 0;
 
 		if (!hasIndexBuffer) {
 			return;
 		};
 
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-		uint32_t indexSize = sizeof(indices[0]);
-
-		VortexBuffer stagingBuffer{
-			vortexDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-		};
-
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
-
-		indexBuffer = std::make_unique<VortexBuffer>(
-			vortexDevice,
-			indexSize,
-			indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-		);
-
-		vortexDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+		indexRange = vortexDevice.geometryPool().allocateIndices(indices, indexCount);
 	}
 
-	void VortexModel::draw(VkCommandBuffer commandBuffer) {
+	void VortexModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
 		if (hasIndexBuffer) {
-			vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+			vkCmdDrawIndexed(
+				commandBuffer,
+				indexCount,
+				instanceCount,
+				indexRange.first,
+				static_cast<int32_t>(vertexRange.first),
+				firstInstance);
 		}
 		else {
-			vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+			vkCmdDraw(commandBuffer, vertexCount, instanceCount, vertexRange.first, firstInstance);
 		}
 	}
 
 	void VortexModel::bind(VkCommandBuffer commandBuffer) {
-		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-		
+		vortexDevice.geometryPool().bindVertexPage(commandBuffer, vertexRange.page);
+
 		if (hasIndexBuffer) {
-			vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+			vortexDevice.geometryPool().bindIndexPage(commandBuffer, indexRange.page);
 		}
 	}
 
+	bool VortexModel::sharesBindingsWith(const VortexModel& other) const {
+		return vertexRange.page == other.vertexRange.page &&
+			hasIndexBuffer == other.hasIndexBuffer &&
+			(!hasIndexBuffer || indexRange.page == other.indexRange.page);
+	}
+
 	std::vector<VkVertexInputBindingDescription> VortexModel::Vertex::getBindingDescriptions() {
 		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
 		bindingDescriptions[0].binding = 0;
@@ -136,62 +121,4 @@ namespace VortexEngine {
 
 		return attributeDescriptions;
 	}
-
-	void VortexModel::Builder::loadModel(const std::string& filepath) {
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
-
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
-			throw std::runtime_error(warn + err);
-		}
-
-		vertices.clear();
-		indices.clear();
-
-		std::unordered_map<Vertex, uint32_t> uniqueVertices{};
-
-		for (const auto& shape : shapes) {
-			for (const auto& index : shape.mesh.indices) {
-				Vertex vertex{};
-
-				if (index.vertex_index >= 0) {
-					vertex.position = {
-						attrib.vertices[3 * index.vertex_index + 0],
-						attrib.vertices[3 * index.vertex_index + 1],
-						attrib.vertices[3 * index.vertex_index + 2],
-					};
-
-					vertex.color = {
-						attrib.colors[3 * index.vertex_index + 0],
-						attrib.colors[3 * index.vertex_index + 1],
-						attrib.colors[3 * index.vertex_index + 2],
-					};
-				}
-
-				if (index.normal_index >= 0) {
-					vertex.normal = {
-						attrib.normals[3 * index.normal_index + 0],
-						attrib.normals[3 * index.normal_index + 1],
-						attrib.normals[3 * index.normal_index + 2],
-					};
-				}
-
-				if (index.texcoord_index >= 0) {
-					vertex.uv = {
-						attrib.texcoords[2 * index.texcoord_index + 0],
-						attrib.texcoords[2 * index.texcoord_index + 1],
-					};
-				}
-
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-					vertices.push_back(vertex);
-				}
-
-				indices.push_back(uniqueVertices[vertex]);
-			}
-		}
-	}
-}
\ No newline at end of file
+}
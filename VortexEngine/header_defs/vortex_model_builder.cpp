@@ -0,0 +1,359 @@
+#include "../headers/vortex_model.h"
+
+#include "../headers/vortex_job_system.h"
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+// OBJ loading lives apart from the GPU side of VortexModel so tools and tests can use it without a
+// device.
+namespace {
+	using Vertex = VortexEngine::VortexModel::Vertex;
+
+	// meshes smaller than this are not worth handing out to the job system
+	constexpr size_t PARALLEL_LOAD_THRESHOLD = 1 << 16;
+	constexpr uint32_t EMPTY_SLOT = std::numeric_limits<uint32_t>::max();
+
+	// Runs job(0..jobCount-1), spread across jobSystem when there is one
+	template<typename Job>
+	void forEachJob(VortexEngine::VortexJobSystem* jobSystem, uint32_t jobCount, const Job& job) {
+		if (!jobSystem) {
+			for (uint32_t i = 0; i < jobCount; i++) {
+				job(i);
+			}
+			return;
+		}
+
+		jobSystem->parallelFor(jobCount, 1, [&job](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++) {
+				job(static_cast<uint32_t>(i));
+			}
+		});
+	}
+
+	Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+		Vertex vertex{};
+
+		if (index.vertex_index >= 0) {
+			vertex.position = {
+				attrib.vertices[3 * index.vertex_index + 0],
+				attrib.vertices[3 * index.vertex_index + 1],
+				attrib.vertices[3 * index.vertex_index + 2],
+			};
+
+			vertex.color = {
+				attrib.colors[3 * index.vertex_index + 0],
+				attrib.colors[3 * index.vertex_index + 1],
+				attrib.colors[3 * index.vertex_index + 2],
+			};
+		}
+
+		if (index.normal_index >= 0) {
+			vertex.normal = {
+				attrib.normals[3 * index.normal_index + 0],
+				attrib.normals[3 * index.normal_index + 1],
+				attrib.normals[3 * index.normal_index + 2],
+			};
+		}
+
+		if (index.texcoord_index >= 0) {
+			vertex.uv = {
+				attrib.texcoords[2 * index.texcoord_index + 0],
+				attrib.texcoords[2 * index.texcoord_index + 1],
+			};
+		}
+
+		return vertex;
+	}
+
+	bool isSameIndex(const tinyobj::index_t& a, const tinyobj::index_t& b) {
+		return a.vertex_index == b.vertex_index && a.normal_index == b.normal_index && a.texcoord_index == b.texcoord_index;
+	}
+
+	// the shard comes from the top bits and the slot from the bottom ones, so mix both
+	uint64_t mixHash(uint64_t hash) {
+		hash ^= hash >> 30;
+		hash *= 0xbf58476d1ce4e5b9ull;
+		hash ^= hash >> 27;
+		hash *= 0x94d049bb133111ebull;
+		hash ^= hash >> 31;
+		return hash;
+	}
+
+	uint64_t hashIndex(const tinyobj::index_t& index) {
+		uint64_t hash = static_cast<uint32_t>(index.vertex_index);
+		hash = (hash << 32) ^ static_cast<uint32_t>(index.normal_index);
+		hash ^= static_cast<uint64_t>(static_cast<uint32_t>(index.texcoord_index)) * 0x9e3779b97f4a7c15ull;
+		return mixHash(hash);
+	}
+
+	// must agree with Vertex::operator==, so 0 and -0 hash alike
+	uint64_t hashVertex(const Vertex& vertex) {
+		const float values[] = {
+			vertex.position.x, vertex.position.y, vertex.position.z,
+			vertex.color.x, vertex.color.y, vertex.color.z,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z,
+			vertex.uv.x, vertex.uv.y,
+		};
+
+		uint64_t hash = 0;
+		for (float value : values) {
+			uint32_t bits = 0;
+			if (value != 0.0f) {
+				std::memcpy(&bits, &value, sizeof(bits));
+			}
+			hash = (hash ^ bits) * 0x100000001b3ull + 0x9e3779b97f4a7c15ull;
+		}
+		return mixHash(hash);
+	}
+
+	// How a pass over count entries is cut into chunks and hash shards for the job system
+	struct Split {
+		VortexEngine::VortexJobSystem* jobSystem;
+		size_t count;
+		uint32_t chunkCount;
+		uint32_t shardBits;
+		size_t chunkSize;
+
+		Split(VortexEngine::VortexJobSystem* jobSystem, size_t count) : jobSystem{ jobSystem }, count{ count } {
+			const uint32_t workerCount = jobSystem ? jobSystem->getWorkerCount() + 1 : 1;
+			chunkCount = workerCount == 1 ? 1 : workerCount * 4;
+			shardBits = workerCount == 1 ? 0 : 6;
+			chunkSize = (count + chunkCount - 1) / chunkCount;
+		}
+
+		// Runs job(chunk, begin, end) for every chunk
+		template<typename Job>
+		void forEachChunk(const Job& job) const {
+			forEachJob(jobSystem, chunkCount, [&](uint32_t chunk) {
+				size_t begin = std::min(count, chunk * chunkSize);
+				job(chunk, begin, std::min(count, begin + chunkSize));
+			});
+		}
+	};
+
+	// Maps every entry to the first entry equal to it. Entries are bucketed by the shard of their
+	// hash and each shard owns a private open addressing table. Chunks are visited in order, so
+	// "first" matches a serial scan.
+	template<typename Hash, typename Equal>
+	std::vector<uint32_t> findFirstEqual(const Split& split, const Hash& hash, const Equal& equal) {
+		const uint32_t shardCount = 1u << split.shardBits;
+
+		std::vector<std::vector<uint32_t>> buckets(static_cast<size_t>(split.chunkCount) * shardCount);
+		if (shardCount > 1) {
+			split.forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+				for (size_t i = begin; i < end; i++) {
+					uint32_t shard = static_cast<uint32_t>(hash(i) >> (64 - split.shardBits));
+					buckets[static_cast<size_t>(chunk) * shardCount + shard].push_back(static_cast<uint32_t>(i));
+				}
+			});
+		}
+
+		std::vector<uint32_t> canonical(split.count);
+		forEachJob(split.jobSystem, shardCount, [&](uint32_t shard) {
+			auto forEachIndex = [&](auto&& fn) {
+				if (shardCount == 1) {
+					for (size_t i = 0; i < split.count; i++) {
+						fn(static_cast<uint32_t>(i));
+					}
+					return;
+				}
+				for (uint32_t chunk = 0; chunk < split.chunkCount; chunk++) {
+					for (uint32_t i : buckets[static_cast<size_t>(chunk) * shardCount + shard]) {
+						fn(i);
+					}
+				}
+			};
+
+			size_t entryCount = 0;
+			forEachIndex([&entryCount](uint32_t) { entryCount++; });
+			if (entryCount == 0) {
+				return;
+			}
+
+			size_t capacity = 16;
+			while (capacity < entryCount * 2) {
+				capacity <<= 1;
+			}
+			const size_t mask = capacity - 1;
+			std::vector<uint32_t> table(capacity, EMPTY_SLOT);
+
+			forEachIndex([&](uint32_t i) {
+				size_t slot = static_cast<size_t>(hash(i)) & mask;
+				while (true) {
+					uint32_t existing = table[slot];
+					if (existing == EMPTY_SLOT) {
+						table[slot] = i;
+						canonical[i] = i;
+						return;
+					}
+					if (equal(existing, i)) {
+						canonical[i] = existing;
+						return;
+					}
+					slot = (slot + 1) & mask;
+				}
+			});
+		});
+
+		return canonical;
+	}
+
+	// Numbers the entries that are their own canonical entry in order of appearance, and gives the
+	// others the number of their canonical entry
+	std::vector<uint32_t> numberFirstOccurrences(const Split& split, const std::vector<uint32_t>& canonical, uint32_t& uniqueCount) {
+		std::vector<uint32_t> chunkUniqueBase(split.chunkCount + 1, 0);
+		split.forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+			uint32_t count = 0;
+			for (size_t i = begin; i < end; i++) {
+				count += canonical[i] == i ? 1 : 0;
+			}
+			chunkUniqueBase[chunk + 1] = count;
+		});
+
+		for (uint32_t chunk = 0; chunk < split.chunkCount; chunk++) {
+			chunkUniqueBase[chunk + 1] += chunkUniqueBase[chunk];
+		}
+		uniqueCount = chunkUniqueBase[split.chunkCount];
+
+		std::vector<uint32_t> numbers(split.count);
+		split.forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+			uint32_t next = chunkUniqueBase[chunk];
+			for (size_t i = begin; i < end; i++) {
+				if (canonical[i] == i) {
+					numbers[i] = next++;
+				}
+			}
+		});
+
+		// a canonical entry may sit in an earlier chunk, so duplicates look up once every one is numbered
+		split.forEachChunk([&](uint32_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (canonical[i] != i) {
+					numbers[i] = numbers[canonical[i]];
+				}
+			}
+		});
+
+		return numbers;
+	}
+}
+
+namespace VortexEngine {
+	void VortexModel::Builder::loadModel(const std::string& filepath, VortexJobSystem* jobSystem) {
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string warn, err;
+
+		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
+			throw std::runtime_error(warn + err);
+		}
+
+		vertices.clear();
+		indices.clear();
+		boundingBox = VortexAABB{};
+		boundingSphere = glm::vec4{ 0.0f };
+
+		size_t totalIndices = 0;
+		for (const auto& shape : shapes) {
+			totalIndices += shape.mesh.indices.size();
+		}
+		if (totalIndices == 0) {
+			return;
+		}
+
+		// the index triples of every shape in one array, so jobs can split the mesh without caring
+		// about shapes. Shapes release theirs as they go, the triples are all that's needed now.
+		std::vector<tinyobj::index_t> keys;
+		keys.reserve(totalIndices);
+		for (auto& shape : shapes) {
+			keys.insert(keys.end(), shape.mesh.indices.begin(), shape.mesh.indices.end());
+			std::vector<tinyobj::index_t>().swap(shape.mesh.indices);
+		}
+
+		if (totalIndices < PARALLEL_LOAD_THRESHOLD) {
+			jobSystem = nullptr;
+		}
+
+		// pass 1: equal index triples always make equal vertices and are cheap to compare, so build
+		// one Vertex per unique triple first
+		const Split indexSplit{ jobSystem, totalIndices };
+		std::vector<uint32_t> canonicalTriples = findFirstEqual(indexSplit,
+			[&keys](size_t i) { return hashIndex(keys[i]); },
+			[&keys](uint32_t a, uint32_t b) { return isSameIndex(keys[a], keys[b]); });
+
+		uint32_t tripleCount = 0;
+		std::vector<uint32_t> tripleNumbers = numberFirstOccurrences(indexSplit, canonicalTriples, tripleCount);
+
+		std::vector<Vertex> tripleVertices(tripleCount);
+		indexSplit.forEachChunk([&](uint32_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (canonicalTriples[i] == i) {
+					tripleVertices[tripleNumbers[i]] = makeVertex(attrib, keys[i]);
+				}
+			}
+		});
+
+		std::vector<uint32_t>().swap(canonicalTriples);
+		std::vector<tinyobj::index_t>().swap(keys);
+
+		// pass 2: different triples can still resolve to the same data (repeated v/vn/vt lines), so
+		// merge equal vertices too. Triples are numbered by first use, so numbering their vertices by
+		// first use gives the same order as deduplicating every index by value.
+		const Split vertexSplit{ jobSystem, tripleCount };
+		uint32_t vertexCount = 0;
+		std::vector<uint32_t> canonicalVertices = findFirstEqual(vertexSplit,
+			[&tripleVertices](size_t i) { return hashVertex(tripleVertices[i]); },
+			[&tripleVertices](uint32_t a, uint32_t b) { return tripleVertices[a] == tripleVertices[b]; });
+		std::vector<uint32_t> vertexNumbers = numberFirstOccurrences(vertexSplit, canonicalVertices, vertexCount);
+
+		vertices.resize(vertexCount);
+		vertexSplit.forEachChunk([&](uint32_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				if (canonicalVertices[i] == i) {
+					vertices[vertexNumbers[i]] = tripleVertices[i];
+				}
+			}
+		});
+
+		indices.resize(totalIndices);
+		indexSplit.forEachChunk([&](uint32_t, size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				indices[i] = vertexNumbers[tripleNumbers[i]];
+			}
+		});
+
+		computeBounds();
+	}
+
+	void VortexModel::Builder::computeBounds() {
+		if (vertices.empty()) {
+			boundingBox = VortexAABB{};
+			boundingSphere = glm::vec4{ 0.0f };
+			return;
+		}
+
+		// centered on the box, not minimal, but tight enough for culling
+		boundingBox = VortexAABB::empty();
+		for (const auto& vertex : vertices) {
+			boundingBox.min = glm::min(boundingBox.min, vertex.position);
+			boundingBox.max = glm::max(boundingBox.max, vertex.position);
+		}
+
+		glm::vec3 center = boundingBox.center();
+		float radiusSquared = 0.0f;
+		for (const auto& vertex : vertices) {
+			glm::vec3 offset = vertex.position - center;
+			radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+		}
+
+		boundingSphere = glm::vec4(center, std::sqrt(radiusSquared));
+	}
+}
\ No newline at end of file
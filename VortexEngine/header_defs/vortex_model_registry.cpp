@@ -0,0 +1,102 @@
+#include "../headers/vortex_model_registry.h"
+
+#include <filesystem>
+
+namespace VortexEngine {
+	VortexModelRegistry::VortexModelRegistry(VortexDevice& device) : vortexDevice{ device } {}
+
+	VortexModelRegistry::~VortexModelRegistry() {}
+
+	std::string VortexModelRegistry::makeKey(const std::string& filepath) {
+		// "a/../rock.obj" and "rock.obj" should hit the same entry
+		std::error_code error;
+		std::filesystem::path absolutePath = std::filesystem::absolute(filepath, error);
+		if (error) {
+			return filepath;
+		}
+
+		return absolutePath.lexically_normal().generic_string();
+	}
+
+	std::shared_ptr<VortexModel> VortexModelRegistry::getModel(const std::string& filepath) {
+		std::string key = makeKey(filepath);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			auto it = models.find(key);
+			if (it != models.end()) {
+				hits++;
+				return it->second;
+			}
+			misses++;
+		}
+
+		// load outside the lock so workers calling acquireModel are not held up by a large mesh
+		std::shared_ptr<VortexModel> model = VortexModel::createModelFromFile(vortexDevice, filepath);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		// a SceneLoader may have inserted the same file in the meantime, keep the first copy
+		return models.emplace(key, std::move(model)).first->second;
+	}
+
+	std::shared_ptr<VortexModel> VortexModelRegistry::findModel(const std::string& filepath) const {
+		std::string key = makeKey(filepath);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto it = models.find(key);
+		return it != models.end() ? it->second : nullptr;
+	}
+
+	std::shared_ptr<VortexModel> VortexModelRegistry::acquireModel(const std::string& filepath) {
+		std::string key = makeKey(filepath);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto it = models.find(key);
+		if (it == models.end()) {
+			return nullptr;
+		}
+
+		hits++;
+		return it->second;
+	}
+
+	std::shared_ptr<VortexModel> VortexModelRegistry::insertModel(const std::string& filepath, std::shared_ptr<VortexModel> model) {
+		std::string key = makeKey(filepath);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		misses++;
+		return models.emplace(key, std::move(model)).first->second;
+	}
+
+	size_t VortexModelRegistry::releaseUnused() {
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		size_t released = 0;
+		for (auto it = models.begin(); it != models.end();) {
+			if (it->second.use_count() == 1) {
+				it = models.erase(it);
+				released++;
+			}
+			else {
+				++it;
+			}
+		}
+
+		return released;
+	}
+
+	void VortexModelRegistry::clear() {
+		std::lock_guard<std::mutex> lock{ mutex };
+		models.clear();
+	}
+
+	VortexModelRegistry::Stats VortexModelRegistry::getStats() const {
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Stats stats{};
+		stats.hits = hits;
+		stats.misses = misses;
+		stats.residentModels = models.size();
+		return stats;
+	}
+}
@@ -0,0 +1,294 @@
+#include "../headers/vortex_offset_allocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// std
+#include <algorithm>
+#include <cassert>
+
+namespace VortexEngine {
+
+    namespace {
+        // the 64 bit scan intrinsics don't exist on 32 bit MSVC targets, so scan the halves
+        uint32_t lowestBit(uint64_t value) {
+#ifdef _MSC_VER
+            unsigned long index;
+            if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+                return static_cast<uint32_t>(index);
+            }
+            _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+            return static_cast<uint32_t>(index) + 32;
+#else
+            return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+        }
+
+        uint32_t highestBit(uint64_t value) {
+#ifdef _MSC_VER
+            unsigned long index;
+            if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+                return static_cast<uint32_t>(index) + 32;
+            }
+            _BitScanReverse(&index, static_cast<unsigned long>(value));
+            return static_cast<uint32_t>(index);
+#else
+            return static_cast<uint32_t>(63 - __builtin_clzll(value));
+#endif
+        }
+    }
+
+    VortexOffsetAllocator::VortexOffsetAllocator(uint64_t size) : size{ size } {
+        reset();
+    }
+
+    void VortexOffsetAllocator::reset() {
+        nodes.clear();
+        unusedNodes.clear();
+
+        firstLevelBitmap = 0;
+        std::fill(std::begin(secondLevelBitmaps), std::end(secondLevelBitmaps), 0u);
+        for (auto& heads : freeHeads) {
+            std::fill(std::begin(heads), std::end(heads), INVALID_NODE);
+        }
+
+        freeSize = 0;
+        allocationCount = 0;
+
+        if (size > 0) {
+            insertFree(createNode(0, size));
+            freeSize = size;
+        }
+    }
+
+    void VortexOffsetAllocator::mapping(uint64_t rangeSize, uint32_t& firstLevel, uint32_t& secondLevel) {
+        if (rangeSize < SECOND_LEVEL_COUNT) {
+            // small sizes get one bin each in the first row
+            firstLevel = 0;
+            secondLevel = static_cast<uint32_t>(rangeSize);
+            return;
+        }
+
+        uint32_t msb = highestBit(rangeSize);
+        firstLevel = msb - SECOND_LEVEL_LOG2 + 1;
+        secondLevel = static_cast<uint32_t>(rangeSize >> (msb - SECOND_LEVEL_LOG2)) - SECOND_LEVEL_COUNT;
+    }
+
+    bool VortexOffsetAllocator::fits(const Node& node, uint64_t allocationSize, uint64_t alignment) {
+        uint64_t alignedOffset = (node.offset + alignment - 1) & ~(alignment - 1);
+        return alignedOffset + allocationSize <= node.offset + node.size;
+    }
+
+    uint32_t VortexOffsetAllocator::findFreeNode(uint64_t allocationSize, uint64_t alignment) const {
+        // worst case padding, so any node found can be aligned in place
+        uint64_t requestSize = allocationSize + alignment - 1;
+
+        // round the request up to the next bin boundary so every node in the bin we find is large enough
+        uint64_t roundedSize = requestSize;
+        if (roundedSize >= SECOND_LEVEL_COUNT) {
+            roundedSize += (1ull << (highestBit(roundedSize) - SECOND_LEVEL_LOG2)) - 1;
+        }
+
+        uint32_t firstLevel;
+        uint32_t secondLevel;
+        mapping(roundedSize, firstLevel, secondLevel);
+
+        uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+        uint64_t firstLevelMap = firstLevelBitmap & (~0ull << (firstLevel + 1));
+        if (secondLevelMap != 0) {
+            return freeHeads[firstLevel][lowestBit(secondLevelMap)];
+        }
+        if (firstLevelMap != 0) {
+            firstLevel = lowestBit(firstLevelMap);
+            return freeHeads[firstLevel][lowestBit(secondLevelBitmaps[firstLevel])];
+        }
+
+        // Only the request's own bin is left, whose nodes may or may not be large enough. Without
+        // checking them a range could never be allocated whole, e.g. a fresh allocator's capacity.
+        mapping(allocationSize, firstLevel, secondLevel);
+        for (uint32_t node = freeHeads[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree) {
+            if (fits(nodes[node], allocationSize, alignment)) {
+                return node;
+            }
+        }
+        return INVALID_NODE;
+    }
+
+    VortexOffsetAllocator::Allocation VortexOffsetAllocator::allocate(uint64_t requestedSize, uint64_t alignment) {
+        assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "Alignment must be a power of two");
+
+        uint64_t allocationSize = std::max<uint64_t>(requestedSize, 1);
+        if (allocationSize > freeSize) {
+            return Allocation{};
+        }
+
+        uint32_t node = findFreeNode(allocationSize, alignment);
+        if (node == INVALID_NODE) {
+            return Allocation{};
+        }
+        removeFree(node);
+
+        uint64_t alignedOffset = (nodes[node].offset + alignment - 1) & ~(alignment - 1);
+        uint64_t padding = alignedOffset - nodes[node].offset;
+        if (padding > 0) {
+            // the padding stays free, the previous physical node is used or the merge would have happened already
+            uint32_t aligned = splitTail(node, padding);
+            insertFree(node);
+            node = aligned;
+        }
+
+        if (nodes[node].size > allocationSize) {
+            insertFree(splitTail(node, allocationSize));
+        }
+
+        nodes[node].used = true;
+        freeSize -= nodes[node].size;
+        allocationCount++;
+
+        Allocation allocation{};
+        allocation.offset = nodes[node].offset;
+        allocation.size = nodes[node].size;
+        allocation.node = node;
+        return allocation;
+    }
+
+    void VortexOffsetAllocator::free(Allocation allocation) {
+        if (!allocation.isValid()) {
+            return;
+        }
+
+        uint32_t node = allocation.node;
+        assert(node < nodes.size() && nodes[node].used && "Freeing an allocation that is not live");
+
+        nodes[node].used = false;
+        freeSize += nodes[node].size;
+        allocationCount--;
+
+        uint32_t prev = nodes[node].prevPhysical;
+        if (prev != INVALID_NODE && !nodes[prev].used) {
+            removeFree(prev);
+
+            nodes[prev].size += nodes[node].size;
+            nodes[prev].nextPhysical = nodes[node].nextPhysical;
+            if (nodes[node].nextPhysical != INVALID_NODE) {
+                nodes[nodes[node].nextPhysical].prevPhysical = prev;
+            }
+
+            releaseNode(node);
+            node = prev;
+        }
+
+        uint32_t next = nodes[node].nextPhysical;
+        if (next != INVALID_NODE && !nodes[next].used) {
+            removeFree(next);
+
+            nodes[node].size += nodes[next].size;
+            nodes[node].nextPhysical = nodes[next].nextPhysical;
+            if (nodes[next].nextPhysical != INVALID_NODE) {
+                nodes[nodes[next].nextPhysical].prevPhysical = node;
+            }
+
+            releaseNode(next);
+        }
+
+        insertFree(node);
+    }
+
+    uint64_t VortexOffsetAllocator::getLargestFreeRange() const {
+        if (firstLevelBitmap == 0) {
+            return 0;
+        }
+
+        uint32_t firstLevel = highestBit(firstLevelBitmap);
+        uint32_t secondLevel = highestBit(secondLevelBitmaps[firstLevel]);
+
+        // a bin covers a range of sizes, so look at every node in the top one
+        uint64_t largest = 0;
+        for (uint32_t node = freeHeads[firstLevel][secondLevel]; node != INVALID_NODE; node = nodes[node].nextFree) {
+            largest = std::max(largest, nodes[node].size);
+        }
+        return largest;
+    }
+
+    uint32_t VortexOffsetAllocator::createNode(uint64_t offset, uint64_t nodeSize) {
+        uint32_t node;
+        if (!unusedNodes.empty()) {
+            node = unusedNodes.back();
+            unusedNodes.pop_back();
+            nodes[node] = Node{};
+        }
+        else {
+            node = static_cast<uint32_t>(nodes.size());
+            nodes.emplace_back();
+        }
+
+        nodes[node].offset = offset;
+        nodes[node].size = nodeSize;
+        return node;
+    }
+
+    void VortexOffsetAllocator::releaseNode(uint32_t node) {
+        unusedNodes.push_back(node);
+    }
+
+    void VortexOffsetAllocator::insertFree(uint32_t node) {
+        uint32_t firstLevel;
+        uint32_t secondLevel;
+        mapping(nodes[node].size, firstLevel, secondLevel);
+
+        uint32_t head = freeHeads[firstLevel][secondLevel];
+        nodes[node].prevFree = INVALID_NODE;
+        nodes[node].nextFree = head;
+        if (head != INVALID_NODE) {
+            nodes[head].prevFree = node;
+        }
+
+        freeHeads[firstLevel][secondLevel] = node;
+        secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+        firstLevelBitmap |= 1ull << firstLevel;
+    }
+
+    void VortexOffsetAllocator::removeFree(uint32_t node) {
+        uint32_t firstLevel;
+        uint32_t secondLevel;
+        mapping(nodes[node].size, firstLevel, secondLevel);
+
+        uint32_t prev = nodes[node].prevFree;
+        uint32_t next = nodes[node].nextFree;
+        if (prev != INVALID_NODE) {
+            nodes[prev].nextFree = next;
+        }
+        if (next != INVALID_NODE) {
+            nodes[next].prevFree = prev;
+        }
+
+        if (freeHeads[firstLevel][secondLevel] == node) {
+            freeHeads[firstLevel][secondLevel] = next;
+            if (next == INVALID_NODE) {
+                secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+                if (secondLevelBitmaps[firstLevel] == 0) {
+                    firstLevelBitmap &= ~(1ull << firstLevel);
+                }
+            }
+        }
+
+        nodes[node].prevFree = INVALID_NODE;
+        nodes[node].nextFree = INVALID_NODE;
+    }
+
+    uint32_t VortexOffsetAllocator::splitTail(uint32_t node, uint64_t keepSize) {
+        uint32_t tail = createNode(nodes[node].offset + keepSize, nodes[node].size - keepSize);
+
+        nodes[tail].prevPhysical = node;
+        nodes[tail].nextPhysical = nodes[node].nextPhysical;
+        if (nodes[node].nextPhysical != INVALID_NODE) {
+            nodes[nodes[node].nextPhysical].prevPhysical = tail;
+        }
+
+        nodes[node].nextPhysical = tail;
+        nodes[node].size = keepSize;
+        return tail;
+    }
+
+}  // namespace VortexEngine
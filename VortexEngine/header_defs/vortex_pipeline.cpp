@@ -6,19 +6,84 @@
 #include <fstream>
 #include <stdexcept>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 namespace VortexEngine {
+	ShaderSpecialization& ShaderSpecialization::setValue(uint32_t constantId, const void* value) {
+		auto it = std::lower_bound(entries.begin(), entries.end(), constantId,
+			[](const VkSpecializationMapEntry& entry, uint32_t id) { return entry.constantID < id; });
+
+		uint32_t word;
+		memcpy(&word, value, sizeof(word));
+
+		if (it != entries.end() && it->constantID == constantId) {
+			data[it->offset / sizeof(uint32_t)] = word;
+			return *this;
+		}
+
+		// keep entries sorted, offsets just index data in insertion order
+		entries.insert(it, VkSpecializationMapEntry{ constantId, static_cast<uint32_t>(data.size() * sizeof(uint32_t)), sizeof(uint32_t) });
+		data.push_back(word);
+		return *this;
+	}
+
+	VkSpecializationInfo ShaderSpecialization::getInfo() const {
+		VkSpecializationInfo info{};
+		info.mapEntryCount = static_cast<uint32_t>(entries.size());
+		info.pMapEntries = entries.data();
+		info.dataSize = data.size() * sizeof(uint32_t);
+		info.pData = data.data();
+		return info;
+	}
+
+	VortexShaderModule::VortexShaderModule(VortexDevice& device, std::vector<char> spirv)
+		: vortexDevice{ device }, code{ std::move(spirv) }, hash{ hashCode(code) }, reflection{ code } {
+		VkShaderModuleCreateInfo createInfo{};
+		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		createInfo.codeSize = code.size();
+		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+		if (vkCreateShaderModule(vortexDevice.device(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create shader module!");
+		}
+	}
+
+	VortexShaderModule::~VortexShaderModule() {
+		vkDestroyShaderModule(vortexDevice.device(), shaderModule, nullptr);
+	}
+
+	uint64_t VortexShaderModule::hashCode(const std::vector<char>& code) {
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : code) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
 	VortexPipeline::VortexPipeline(
 		VortexDevice& device,
 		const std::string& vertFilepath,
 		const std::string& fragFilepath,
-		const PipelineConfigInfo& configInfo) : vortexDevice{ device } {
-		createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+		const PipelineConfigInfo& configInfo)
+		: VortexPipeline{
+			device,
+			std::make_shared<VortexShaderModule>(device, readFile(vertFilepath)),
+			std::make_shared<VortexShaderModule>(device, readFile(fragFilepath)),
+			configInfo } {}
+
+	VortexPipeline::VortexPipeline(
+		VortexDevice& device,
+		std::shared_ptr<VortexShaderModule> vertShader,
+		std::shared_ptr<VortexShaderModule> fragShader,
+		const PipelineConfigInfo& configInfo)
+		: vortexDevice{ device }, vertShaderModule{ std::move(vertShader) }, fragShaderModule{ std::move(fragShader) } {
+		createGraphicsPipeline(configInfo);
 	}
 
 	VortexPipeline::~VortexPipeline() {
-		vkDestroyShaderModule(vortexDevice.device(), vertShaderModule, nullptr);
-		vkDestroyShaderModule(vortexDevice.device(), fragShaderModule, nullptr);
 		vkDestroyPipeline(vortexDevice.device(), graphicsPipeline, nullptr);
 	}
 
@@ -40,34 +105,38 @@ namespace VortexEngine {
 		return buffer;
 	}
 
-	void VortexPipeline::createGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath, const PipelineConfigInfo& configInfo) {
+	void VortexPipeline::createGraphicsPipeline(const PipelineConfigInfo& configInfo) {
 		assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: No pipelineLayout provided in config");
 		assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: No renderPass provided in config");
-		auto vertCode = readFile(vertFilepath);
-		auto fragCode = readFile(fragFilepath);
 
-		createShaderModule(vertCode, &vertShaderModule);
-		createShaderModule(fragCode, &fragShaderModule);
+		if (vertShaderModule->getReflection().getStage() != VK_SHADER_STAGE_VERTEX_BIT ||
+			fragShaderModule->getReflection().getStage() != VK_SHADER_STAGE_FRAGMENT_BIT) {
+			throw std::runtime_error("Graphics pipeline needs a vertex and a fragment shader!");
+		}
+		vertShaderModule->getReflection().validateVertexInput(configInfo.attributeDescriptions);
+
+		VkSpecializationInfo specializationInfo = configInfo.specialization.getInfo();
+		const VkSpecializationInfo* specialization = configInfo.specialization.empty() ? nullptr : &specializationInfo;
 
 		VkPipelineShaderStageCreateInfo shaderStages[2];
 		shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStages[0].module = vertShaderModule;
+		shaderStages[0].module = vertShaderModule->getShaderModule();
 		shaderStages[0].pName = "main";
 		shaderStages[0].flags = 0;
 		shaderStages[0].pNext = nullptr;
-		shaderStages[0].pSpecializationInfo = nullptr;
+		shaderStages[0].pSpecializationInfo = specialization;
 
 		shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStages[1].module = fragShaderModule;
+		shaderStages[1].module = fragShaderModule->getShaderModule();
 		shaderStages[1].pName = "main";
 		shaderStages[1].flags = 0;
 		shaderStages[1].pNext = nullptr;
-		shaderStages[1].pSpecializationInfo = nullptr;
+		shaderStages[1].pSpecializationInfo = specialization;
 
-		auto bindingDescriptions = VortexModel::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = VortexModel::Vertex::getAttributeDescriptions();
+		auto& bindingDescriptions = configInfo.bindingDescriptions;
+		auto& attributeDescriptions = configInfo.attributeDescriptions;
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -95,22 +164,11 @@ namespace VortexEngine {
 		pipelineInfo.basePipelineIndex = -1;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		if (vkCreateGraphicsPipelines(vortexDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+		if (vkCreateGraphicsPipelines(vortexDevice.device(), vortexDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
 			throw std::runtime_error("Failed to create graphics pipeline!");
 		}
 	}
 
-	void VortexPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-		if (vkCreateShaderModule(vortexDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-			throw std::runtime_error("Failed to create shader module!");
-		}
-	}
-
 	void VortexPipeline::bind(VkCommandBuffer commandBuffer) {
 		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
 	}
@@ -183,5 +241,72 @@ namespace VortexEngine {
 		configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
 		configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
 		configInfo.dynamicStateInfo.flags = 0;
+
+		configInfo.bindingDescriptions = VortexModel::Vertex::getBindingDescriptions();
+		configInfo.attributeDescriptions = VortexModel::Vertex::getAttributeDescriptions();
+	}
+
+	void VortexPipeline::copyPipelineConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination) {
+		destination.bindingDescriptions = source.bindingDescriptions;
+		destination.attributeDescriptions = source.attributeDescriptions;
+		destination.inputAssemblyInfo = source.inputAssemblyInfo;
+		destination.rasterizationInfo = source.rasterizationInfo;
+		destination.multisampleInfo = source.multisampleInfo;
+		destination.colorBlendAttachment = source.colorBlendAttachment;
+		destination.colorBlendInfo = source.colorBlendInfo;
+		destination.depthStencilInfo = source.depthStencilInfo;
+		destination.viewportInfo = source.viewportInfo;
+		destination.dynamicStateEnables = source.dynamicStateEnables;
+		destination.dynamicStateInfo = source.dynamicStateInfo;
+		destination.pipelineLayout = source.pipelineLayout;
+		destination.renderPass = source.renderPass;
+		destination.subpass = source.subpass;
+		destination.specialization = source.specialization;
+
+		if (source.colorBlendInfo.pAttachments == &source.colorBlendAttachment) {
+			destination.colorBlendInfo.pAttachments = &destination.colorBlendAttachment;
+		}
+		if (source.dynamicStateInfo.pDynamicStates == source.dynamicStateEnables.data()) {
+			destination.dynamicStateInfo.pDynamicStates = destination.dynamicStateEnables.data();
+		}
+	}
+
+	VortexComputePipeline::VortexComputePipeline(
+		VortexDevice& device,
+		const std::string& compFilepath,
+		VkPipelineLayout pipelineLayout)
+		: VortexComputePipeline{ device, std::make_shared<VortexShaderModule>(device, VortexPipeline::readFile(compFilepath)), pipelineLayout } {}
+
+	VortexComputePipeline::VortexComputePipeline(
+		VortexDevice& device,
+		std::shared_ptr<VortexShaderModule> compShader,
+		VkPipelineLayout pipelineLayout) : vortexDevice{ device }, compShaderModule{ std::move(compShader) } {
+		assert(pipelineLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: No pipelineLayout provided");
+
+		if (compShaderModule->getReflection().getStage() != VK_SHADER_STAGE_COMPUTE_BIT) {
+			throw std::runtime_error("Compute pipeline needs a compute shader!");
+		}
+
+		VkComputePipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+		pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+		pipelineInfo.stage.module = compShaderModule->getShaderModule();
+		pipelineInfo.stage.pName = "main";
+		pipelineInfo.layout = pipelineLayout;
+		pipelineInfo.basePipelineIndex = -1;
+		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+		if (vkCreateComputePipelines(vortexDevice.device(), vortexDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create compute pipeline!");
+		}
+	}
+
+	VortexComputePipeline::~VortexComputePipeline() {
+		vkDestroyPipeline(vortexDevice.device(), computePipeline, nullptr);
+	}
+
+	void VortexComputePipeline::bind(VkCommandBuffer commandBuffer) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
 	}
 }
\ No newline at end of file
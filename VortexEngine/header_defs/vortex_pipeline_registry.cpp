@@ -0,0 +1,539 @@
+#include "../headers/vortex_pipeline_registry.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_set>
+
+namespace VortexEngine {
+
+	namespace {
+		// Serializes individual fields, so struct padding and pNext pointers never reach a key.
+		// The maps hash the bytes to find a bucket and compare them in full on a hit, so distinct
+		// state can never alias.
+		struct KeyWriter {
+			std::string key{};
+
+			template<typename T>
+			void add(const T& value) {
+				static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be keyed");
+				key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+			}
+
+			void addStencilOp(const VkStencilOpState& state) {
+				add(state.failOp);
+				add(state.passOp);
+				add(state.depthFailOp);
+				add(state.compareOp);
+				add(state.compareMask);
+				add(state.writeMask);
+				add(state.reference);
+			}
+		};
+
+		// The fields of configInfo that affect the compiled pipeline
+		void writePipelineConfig(KeyWriter& writer, const PipelineConfigInfo& configInfo) {
+			writer.add(configInfo.bindingDescriptions.size());
+			for (const auto& binding : configInfo.bindingDescriptions) {
+				writer.add(binding.binding);
+				writer.add(binding.stride);
+				writer.add(binding.inputRate);
+			}
+			writer.add(configInfo.attributeDescriptions.size());
+			for (const auto& attribute : configInfo.attributeDescriptions) {
+				writer.add(attribute.location);
+				writer.add(attribute.binding);
+				writer.add(attribute.format);
+				writer.add(attribute.offset);
+			}
+
+			writer.add(configInfo.inputAssemblyInfo.topology);
+			writer.add(configInfo.inputAssemblyInfo.primitiveRestartEnable);
+
+			const auto& viewport = configInfo.viewportInfo;
+			writer.add(viewport.viewportCount);
+			writer.add(viewport.scissorCount);
+			if (viewport.pViewports) {
+				for (uint32_t i = 0; i < viewport.viewportCount; i++) {
+					writer.add(viewport.pViewports[i]);
+				}
+			}
+			if (viewport.pScissors) {
+				for (uint32_t i = 0; i < viewport.scissorCount; i++) {
+					writer.add(viewport.pScissors[i]);
+				}
+			}
+
+			const auto& rasterization = configInfo.rasterizationInfo;
+			writer.add(rasterization.depthClampEnable);
+			writer.add(rasterization.rasterizerDiscardEnable);
+			writer.add(rasterization.polygonMode);
+			writer.add(rasterization.cullMode);
+			writer.add(rasterization.frontFace);
+			writer.add(rasterization.depthBiasEnable);
+			writer.add(rasterization.depthBiasConstantFactor);
+			writer.add(rasterization.depthBiasClamp);
+			writer.add(rasterization.depthBiasSlopeFactor);
+			writer.add(rasterization.lineWidth);
+
+			const auto& multisample = configInfo.multisampleInfo;
+			writer.add(multisample.rasterizationSamples);
+			writer.add(multisample.sampleShadingEnable);
+			writer.add(multisample.minSampleShading);
+			writer.add(multisample.alphaToCoverageEnable);
+			writer.add(multisample.alphaToOneEnable);
+			if (multisample.pSampleMask) {
+				for (uint32_t i = 0; i < (static_cast<uint32_t>(multisample.rasterizationSamples) + 31) / 32; i++) {
+					writer.add(multisample.pSampleMask[i]);
+				}
+			}
+
+			const auto& colorBlend = configInfo.colorBlendInfo;
+			writer.add(colorBlend.logicOpEnable);
+			writer.add(colorBlend.logicOp);
+			writer.add(colorBlend.attachmentCount);
+			for (uint32_t i = 0; i < colorBlend.attachmentCount; i++) {
+				const auto& attachment = colorBlend.pAttachments[i];
+				writer.add(attachment.blendEnable);
+				writer.add(attachment.srcColorBlendFactor);
+				writer.add(attachment.dstColorBlendFactor);
+				writer.add(attachment.colorBlendOp);
+				writer.add(attachment.srcAlphaBlendFactor);
+				writer.add(attachment.dstAlphaBlendFactor);
+				writer.add(attachment.alphaBlendOp);
+				writer.add(attachment.colorWriteMask);
+			}
+			writer.add(colorBlend.blendConstants);
+
+			const auto& depthStencil = configInfo.depthStencilInfo;
+			writer.add(depthStencil.depthTestEnable);
+			writer.add(depthStencil.depthWriteEnable);
+			writer.add(depthStencil.depthCompareOp);
+			writer.add(depthStencil.depthBoundsTestEnable);
+			writer.add(depthStencil.stencilTestEnable);
+			writer.addStencilOp(depthStencil.front);
+			writer.addStencilOp(depthStencil.back);
+			writer.add(depthStencil.minDepthBounds);
+			writer.add(depthStencil.maxDepthBounds);
+
+			writer.add(configInfo.dynamicStateEnables.size());
+			for (VkDynamicState state : configInfo.dynamicStateEnables) {
+				writer.add(state);
+			}
+
+			writer.add(configInfo.pipelineLayout);
+			writer.add(configInfo.renderPass);
+			writer.add(configInfo.subpass);
+
+			const auto& specialization = configInfo.specialization;
+			writer.add(specialization.getEntries().size());
+			for (const auto& entry : specialization.getEntries()) {
+				writer.add(entry.constantID);
+				writer.add(specialization.getData()[entry.offset / sizeof(uint32_t)]);
+			}
+
+		}
+
+		std::string makePathKey(const std::string& filepath) {
+			std::error_code error;
+			std::filesystem::path absolutePath = std::filesystem::absolute(filepath, error);
+			if (error) {
+				return filepath;
+			}
+
+			return absolutePath.lexically_normal().generic_string();
+		}
+	}
+
+	VortexPipelineRegistry::VortexPipelineRegistry(VortexDevice& device, VortexJobSystem* jobs) : vortexDevice{ device }, jobSystem{ jobs } {}
+
+	VortexPipelineRegistry::~VortexPipelineRegistry() {
+		if (jobSystem) {
+			jobSystem->wait(compileCounter);
+		}
+
+		for (auto& entry : pipelineLayouts) {
+			vkDestroyPipelineLayout(vortexDevice.device(), entry.second, nullptr);
+		}
+	}
+
+	std::string VortexPipelineRegistry::makePipelineKey(
+		const PipelineConfigInfo& configInfo,
+		const VortexShaderModule& vertShader,
+		const VortexShaderModule& fragShader) const {
+		// modules are shared by content, and every pipeline holds on to its own, so a module's
+		// address identifies its code for as long as a pipeline with this key exists
+		KeyWriter writer;
+		writer.add(&vertShader);
+		writer.add(&fragShader);
+		writePipelineConfig(writer, configInfo);
+		return std::move(writer.key);
+	}
+
+	std::shared_ptr<VortexShaderModule> VortexPipelineRegistry::getShaderModule(const std::string& filepath) {
+		std::string pathKey = makePathKey(filepath);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			auto it = shaderModulePaths.find(pathKey);
+			if (it != shaderModulePaths.end()) {
+				return it->second;
+			}
+		}
+
+		std::vector<char> code = VortexPipeline::readFile(filepath);
+		uint64_t hash = VortexShaderModule::hashCode(code);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto pathIt = shaderModulePaths.find(pathKey);
+		if (pathIt != shaderModulePaths.end()) {
+			return pathIt->second;
+		}
+
+		// the same SPIR-V under another path, reuse its module
+		auto moduleIt = shaderModules.find(hash);
+		if (moduleIt != shaderModules.end() && moduleIt->second->getCode() == code) {
+			shaderModulePaths.emplace(pathKey, moduleIt->second);
+			return moduleIt->second;
+		}
+
+		auto shaderModule = std::make_shared<VortexShaderModule>(vortexDevice, std::move(code));
+		// on a hash collision the first module keeps the content slot, this one is only found by path
+		shaderModules.emplace(hash, shaderModule);
+		shaderModulePaths.emplace(pathKey, shaderModule);
+		return shaderModule;
+	}
+
+	std::shared_ptr<VortexPipeline> VortexPipelineRegistry::getPipeline(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		const PipelineConfigInfo& configInfo) {
+		auto vertShader = getShaderModule(vertFilepath);
+		auto fragShader = getShaderModule(fragFilepath);
+
+		std::string key = makePipelineKey(configInfo, *vertShader, *fragShader);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			auto it = pipelines.find(key);
+			if (it != pipelines.end()) {
+				hits++;
+				return it->second;
+			}
+			misses++;
+		}
+
+		// compile outside the lock, pipeline creation can take tens of milliseconds
+		auto pipeline = std::make_shared<VortexPipeline>(vortexDevice, std::move(vertShader), std::move(fragShader), configInfo);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		// another thread may have built the same pipeline in the meantime, keep the first one
+		return pipelines.emplace(key, std::move(pipeline)).first->second;
+	}
+
+	std::shared_ptr<VortexComputePipeline> VortexPipelineRegistry::getComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout) {
+		auto compShader = getShaderModule(compFilepath);
+
+		KeyWriter writer;
+		writer.add(compShader.get());
+		writer.add(pipelineLayout);
+		std::string key = std::move(writer.key);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			auto it = computePipelines.find(key);
+			if (it != computePipelines.end()) {
+				hits++;
+				return it->second;
+			}
+			misses++;
+		}
+
+		auto pipeline = std::make_shared<VortexComputePipeline>(vortexDevice, std::move(compShader), pipelineLayout);
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		return computePipelines.emplace(key, std::move(pipeline)).first->second;
+	}
+
+	VortexPipelineHandle VortexPipelineRegistry::getPipelineAsync(
+		const std::string& vertFilepath,
+		const std::string& fragFilepath,
+		const PipelineConfigInfo& configInfo,
+		std::shared_ptr<VortexPipeline> fallback) {
+		VortexPipelineHandle handle{};
+		handle.fallback = std::move(fallback);
+
+		if (!jobSystem) {
+			handle.compiled = std::make_shared<VortexPipelineHandle::Compiled>();
+			handle.compiled->pipeline = getPipeline(vertFilepath, fragFilepath, configInfo);
+			return handle;
+		}
+
+		// shader files are small, reading them here keeps the job free of path handling
+		auto vertShader = getShaderModule(vertFilepath);
+		auto fragShader = getShaderModule(fragFilepath);
+		std::string key = makePipelineKey(configInfo, *vertShader, *fragShader);
+
+		{
+			std::lock_guard<std::mutex> lock{ mutex };
+			auto it = pipelines.find(key);
+			if (it != pipelines.end()) {
+				hits++;
+				handle.compiled = std::make_shared<VortexPipelineHandle::Compiled>();
+				handle.compiled->pipeline = it->second;
+				return handle;
+			}
+
+			auto compiling = compilingPipelines.find(key);
+			if (compiling != compilingPipelines.end()) {
+				hits++;
+				handle.compiled = compiling->second;
+				return handle;
+			}
+
+			misses++;
+			handle.compiled = std::make_shared<VortexPipelineHandle::Compiled>();
+			compilingPipelines.emplace(key, handle.compiled);
+		}
+
+		// the caller's config may not outlive this call
+		std::shared_ptr<PipelineConfigInfo> config{ new PipelineConfigInfo{} };
+		VortexPipeline::copyPipelineConfigInfo(configInfo, *config);
+
+		// ahead of scene loading, the fallback variants must not wait for every model to parse
+		jobSystem->runBackground([this, key, config, vertShader, fragShader]() {
+			CompletedPipeline completed{ key };
+			try {
+				completed.pipeline = std::make_shared<VortexPipeline>(vortexDevice, vertShader, fragShader, *config);
+			}
+			catch (...) {
+				completed.error = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock{ mutex };
+			completedPipelines.push_back(std::move(completed));
+		}, &compileCounter, VortexJobSystem::Priority::High);
+
+		return handle;
+	}
+
+	size_t VortexPipelineRegistry::swapCompletedPipelines() {
+		std::vector<CompletedPipeline> completed;
+		std::exception_ptr error{};
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		completed.swap(completedPipelines);
+
+		for (auto& entry : completed) {
+			auto compiling = compilingPipelines.find(entry.key);
+			auto handleState = compiling->second;
+			compilingPipelines.erase(compiling);
+
+			if (entry.error) {
+				// handles keep using their fallback
+				if (!error) {
+					error = entry.error;
+				}
+				continue;
+			}
+
+			// a synchronous getPipeline may have built the same pipeline meanwhile, keep that one
+			handleState->pipeline = pipelines.emplace(entry.key, std::move(entry.pipeline)).first->second;
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		return completed.size();
+	}
+
+	size_t VortexPipelineRegistry::getPendingCount() const {
+		std::lock_guard<std::mutex> lock{ mutex };
+		return compilingPipelines.size();
+	}
+
+	std::shared_ptr<VortexDescriptorSetLayout> VortexPipelineRegistry::getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings) {
+		std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+			return a.binding < b.binding;
+		});
+
+		KeyWriter writer;
+		writer.add(bindings.size());
+		for (const auto& binding : bindings) {
+			writer.add(binding.binding);
+			writer.add(binding.descriptorType);
+			writer.add(binding.descriptorCount);
+			writer.add(binding.stageFlags);
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto it = descriptorSetLayouts.find(writer.key);
+		if (it != descriptorSetLayouts.end()) {
+			return it->second;
+		}
+
+		VortexDescriptorSetLayout::Builder builder{ vortexDevice };
+		for (const auto& binding : bindings) {
+			builder.addBinding(binding.binding, binding.descriptorType, binding.stageFlags, binding.descriptorCount);
+		}
+
+		std::shared_ptr<VortexDescriptorSetLayout> setLayout = builder.build();
+		descriptorSetLayouts.emplace(std::move(writer.key), setLayout);
+		return setLayout;
+	}
+
+	VortexPipelineRegistry::ReflectedLayout VortexPipelineRegistry::getReflectedLayout(const std::vector<std::string>& shaderFilepaths) {
+		std::vector<std::shared_ptr<VortexShaderModule>> shaders;
+		std::vector<const VortexShaderReflection*> reflections;
+		for (const auto& filepath : shaderFilepaths) {
+			shaders.push_back(getShaderModule(filepath));
+			reflections.push_back(&shaders.back()->getReflection());
+		}
+
+		std::string shaderNames;
+		for (const auto& filepath : shaderFilepaths) {
+			shaderNames += (shaderNames.empty() ? "" : ", ") + filepath;
+		}
+
+		VortexShaderReflection::Layout layout;
+		try {
+			layout = VortexShaderReflection::mergeLayouts(reflections);
+		}
+		catch (const std::runtime_error& error) {
+			throw std::runtime_error(std::string{ error.what() } + " (" + shaderNames + ")");
+		}
+
+		ReflectedLayout reflected{};
+		std::vector<VkDescriptorSetLayout> setLayoutHandles;
+		for (size_t set = 0; set < layout.sets.size(); set++) {
+			for (const auto& binding : layout.sets[set]) {
+				if (binding.descriptorCount == 0) {
+					throw std::runtime_error("Descriptor set " + std::to_string(set) + " binding " + std::to_string(binding.binding) +
+						" is a runtime sized array, its layout must be created by hand (" + shaderNames + ")");
+				}
+			}
+
+			reflected.setLayouts.push_back(getDescriptorSetLayout(layout.sets[set]));
+			setLayoutHandles.push_back(reflected.setLayouts.back()->getDescriptorSetLayout());
+		}
+
+		reflected.pushConstantRanges = std::move(layout.pushConstantRanges);
+		reflected.pipelineLayout = getPipelineLayout(setLayoutHandles, reflected.pushConstantRanges);
+		return reflected;
+	}
+
+	VkPipelineLayout VortexPipelineRegistry::getPipelineLayout(
+		const std::vector<VkDescriptorSetLayout>& setLayouts,
+		const std::vector<VkPushConstantRange>& pushConstantRanges) {
+		KeyWriter writer;
+		writer.add(setLayouts.size());
+		for (VkDescriptorSetLayout setLayout : setLayouts) {
+			writer.add(setLayout);
+		}
+		writer.add(pushConstantRanges.size());
+		for (const auto& range : pushConstantRanges) {
+			writer.add(range.stageFlags);
+			writer.add(range.offset);
+			writer.add(range.size);
+		}
+
+		std::lock_guard<std::mutex> lock{ mutex };
+		auto it = pipelineLayouts.find(writer.key);
+		if (it != pipelineLayouts.end()) {
+			return it->second;
+		}
+
+		VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+		pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+		pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+		VkPipelineLayout pipelineLayout;
+		if (vkCreatePipelineLayout(vortexDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to create pipeline layout!");
+		}
+
+		pipelineLayouts.emplace(std::move(writer.key), pipelineLayout);
+		return pipelineLayout;
+	}
+
+	size_t VortexPipelineRegistry::releaseUnused() {
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		size_t released = 0;
+		for (auto it = pipelines.begin(); it != pipelines.end();) {
+			if (it->second.use_count() == 1) {
+				it = pipelines.erase(it);
+				released++;
+			}
+			else {
+				++it;
+			}
+		}
+		for (auto it = computePipelines.begin(); it != computePipelines.end();) {
+			if (it->second.use_count() == 1) {
+				it = computePipelines.erase(it);
+				released++;
+			}
+			else {
+				++it;
+			}
+		}
+
+		// a module is unused once only the registry's own path and content entries refer to it
+		std::unordered_map<const VortexShaderModule*, long> registryReferences;
+		for (auto& entry : shaderModulePaths) {
+			registryReferences[entry.second.get()]++;
+		}
+		for (auto& entry : shaderModules) {
+			registryReferences[entry.second.get()]++;
+		}
+		std::unordered_set<const VortexShaderModule*> unusedModules;
+		for (auto& entry : shaderModulePaths) {
+			if (entry.second.use_count() == registryReferences[entry.second.get()]) {
+				unusedModules.insert(entry.second.get());
+			}
+		}
+		for (auto& entry : shaderModules) {
+			if (entry.second.use_count() == registryReferences[entry.second.get()]) {
+				unusedModules.insert(entry.second.get());
+			}
+		}
+
+		for (auto it = shaderModulePaths.begin(); it != shaderModulePaths.end();) {
+			if (unusedModules.count(it->second.get())) {
+				it = shaderModulePaths.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+		for (auto it = shaderModules.begin(); it != shaderModules.end();) {
+			if (unusedModules.count(it->second.get())) {
+				it = shaderModules.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+
+		return released;
+	}
+
+	VortexPipelineRegistry::Stats VortexPipelineRegistry::getStats() const {
+		std::lock_guard<std::mutex> lock{ mutex };
+
+		Stats stats{};
+		stats.hits = hits;
+		stats.misses = misses;
+		stats.pipelines = pipelines.size() + computePipelines.size();
+		stats.shaderModules = shaderModules.size();
+		stats.pipelineLayouts = pipelineLayouts.size();
+		stats.descriptorSetLayouts = descriptorSetLayouts.size();
+		return stats;
+	}
+}
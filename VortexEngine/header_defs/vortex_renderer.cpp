@@ -1,4 +1,6 @@
 #include "../headers/vortex_renderer.h"
+#include "../headers/vortex_upload_queue.h"
+#include "../headers/vortex_geometry_pool.h"
 
 #include <cassert>
 #include <stdexcept>
@@ -6,19 +8,30 @@
 
 namespace VortexEngine {
 
-	VortexRenderer::VortexRenderer(VortexWindow& window, VortexDevice& device) : vortexWindow{ window }, vortexDevice{device} {
+	VortexRenderer::VortexRenderer(VortexWindow& window, VortexDevice& device) : vortexWindow{ &window }, vortexDevice{device} {
 		recreateSwapChain();
 		createCommandBuffers();
+		createWorkerCommandPools();
+	}
+
+	VortexRenderer::VortexRenderer(VortexDevice& device, VkExtent2D extent) : vortexDevice{ device } {
+		assert(device.isHeadless() && "Headless renderer requires a headless device!");
+		assert(extent.width > 0 && extent.height > 0 && "Offscreen extent must not be empty!");
+
+		offscreenTarget = std::make_unique<VortexOffscreenTarget>(vortexDevice, extent);
+		createCommandBuffers();
+		createWorkerCommandPools();
 	}
 
 	VortexRenderer::~VortexRenderer() {
+		destroyWorkerCommandPools();
 		freeCommandBuffers();
 	}
 
 	void VortexRenderer::recreateSwapChain() {
-		auto extent = vortexWindow.getExtent();
+		auto extent = vortexWindow->getExtent();
 		while (extent.width == 0 || extent.height == 0) {
-			extent = vortexWindow.getExtent();
+			extent = vortexWindow->getExtent();
 			glfwWaitEvents();
 		}
 
@@ -64,10 +77,109 @@ namespace VortexEngine {
 		commandBuffers.clear();
 	}
 
+	void VortexRenderer::createWorkerCommandPools() {
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = vortexDevice.findPhysicalQueueFamilies().graphicsFamily;
+		// reset as a whole once per frame, never per buffer
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+		workerCommandPools.resize(static_cast<size_t>(VortexSwapChain::MAX_FRAMES_IN_FLIGHT) * workerCount);
+		for (auto& pool : workerCommandPools) {
+			if (vkCreateCommandPool(vortexDevice.device(), &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to create worker command pool!");
+			}
+		}
+	}
+
+	void VortexRenderer::destroyWorkerCommandPools() {
+		// destroying a pool frees its command buffers
+		for (auto& pool : workerCommandPools) {
+			vkDestroyCommandPool(vortexDevice.device(), pool.commandPool, nullptr);
+		}
+		workerCommandPools.clear();
+	}
+
+	void VortexRenderer::setWorkerCount(uint32_t count) {
+		assert(!isFrameStarted && "Can't change the worker count while a frame is in progress!");
+		assert(count > 0 && "Need at least one recording worker!");
+
+		if (count == workerCount) {
+			return;
+		}
+
+		vkDeviceWaitIdle(vortexDevice.device());
+		destroyWorkerCommandPools();
+		workerCount = count;
+		createWorkerCommandPools();
+	}
+
+	VkCommandBuffer VortexRenderer::beginSecondaryCommandBuffer(uint32_t worker) {
+		assert(isFrameStarted && "Can't begin a secondary command buffer when frame not in progress!");
+		assert(worker < workerCount && "Worker index out of range!");
+
+		auto& pool = workerCommandPools[static_cast<size_t>(currentFrameIndex) * workerCount + worker];
+		if (pool.used == pool.commandBuffers.size()) {
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = pool.commandPool;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer commandBuffer;
+			if (vkAllocateCommandBuffers(vortexDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+				throw std::runtime_error("Failed to allocate secondary command buffer!");
+			}
+			pool.commandBuffers.push_back(commandBuffer);
+		}
+		VkCommandBuffer commandBuffer = pool.commandBuffers[pool.used++];
+
+		VkCommandBufferInheritanceInfo inheritanceInfo{};
+		inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritanceInfo.renderPass = getSwapChainRenderPass();
+		inheritanceInfo.subpass = 0;
+		inheritanceInfo.framebuffer = getCurrentFrameBuffer();
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to begin recording secondary command buffer!");
+		}
+
+		setViewportAndScissor(commandBuffer);
+		return commandBuffer;
+	}
+
+	void VortexRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer) {
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to record secondary command buffer!");
+		}
+	}
+
+	void VortexRenderer::executeSecondaryCommandBuffers(VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer>& secondaryCommandBuffers) {
+		assert(isFrameStarted && "Can't execute secondary command buffers if frame is not in progress!");
+		assert(commandBuffer == getCurrentCommandBuffer() && "Can't execute secondary command buffers on command buffer from a different frame");
+
+		if (!secondaryCommandBuffers.empty()) {
+			vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaryCommandBuffers.size()), secondaryCommandBuffers.data());
+		}
+	}
+
+	VkFramebuffer VortexRenderer::getCurrentFrameBuffer() const {
+		return isHeadless()
+			? offscreenTarget->getFrameBuffer(currentImageIndex)
+			: vortexSwapChain->getFrameBuffer(currentImageIndex);
+	}
+
 	VkCommandBuffer VortexRenderer::beginFrame() {
 		assert(!isFrameStarted && "Can't call begin frame whilst already in progress!");
 
-		auto result = vortexSwapChain->acquireNextImage(&currentImageIndex);
+		auto result = isHeadless()
+			? offscreenTarget->acquireNextImage(&currentImageIndex)
+			: vortexSwapChain->acquireNextImage(&currentImageIndex);
 		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 			recreateSwapChain();
 			return nullptr;
@@ -79,6 +191,17 @@ namespace VortexEngine {
 
 		isFrameStarted = true;
 
+		// the fence wait in acquireNextImage means this frame's previous submission is done, so
+		// are its secondaries and the geometry it drew
+		vortexDevice.geometryPool().beginFrame();
+		for (uint32_t worker = 0; worker < workerCount; worker++) {
+			auto& pool = workerCommandPools[static_cast<size_t>(currentFrameIndex) * workerCount + worker];
+			if (pool.used > 0) {
+				vkResetCommandPool(vortexDevice.device(), pool.commandPool, 0);
+				pool.used = 0;
+			}
+		}
+
 		auto commandBuffer = getCurrentCommandBuffer();
 
 		VkCommandBufferBeginInfo beginInfo{};
@@ -99,30 +222,38 @@ namespace VortexEngine {
 			throw std::runtime_error("Failed to record command buffer");
 		}
 
-		auto result = vortexSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vortexWindow.wasWindowResized()) {
-			vortexWindow.resetWindowResizedFlag();
-			recreateSwapChain();
+		// uploads recorded this frame go to the same queue first, so the frame sees their data
+		vortexDevice.uploadQueue().flush();
+
+		if (isHeadless()) {
+			offscreenTarget->submitCommandBuffers(&commandBuffer, &currentImageIndex);
 		}
-		else if (result != VK_SUCCESS) {
-			throw std::runtime_error("Failed to present swap chain image!");
+		else {
+			auto result = vortexSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+			if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || vortexWindow->wasWindowResized()) {
+				vortexWindow->resetWindowResizedFlag();
+				recreateSwapChain();
+			}
+			else if (result != VK_SUCCESS) {
+				throw std::runtime_error("Failed to present swap chain image!");
+			}
 		}
 
 		isFrameStarted = false;
 		currentFrameIndex = (currentFrameIndex + 1) % VortexSwapChain::MAX_FRAMES_IN_FLIGHT;
 	}
 
-	void VortexRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
+	void VortexRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents) {
 		assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress!");
 		assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
 
 		VkRenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = vortexSwapChain->getRenderPass();
-		renderPassInfo.framebuffer = vortexSwapChain->getFrameBuffer(currentImageIndex);
+		renderPassInfo.renderPass = getSwapChainRenderPass();
+		renderPassInfo.framebuffer = getCurrentFrameBuffer();
 
 		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = vortexSwapChain->getSwapChainExtent();
+		renderPassInfo.renderArea.extent = getExtent();
 
 		std::array<VkClearValue, 2>clearValues{};
 		clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
@@ -130,19 +261,24 @@ namespace VortexEngine {
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
 
+		if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+			setViewportAndScissor(commandBuffer);
+		}
+	}
+
+	void VortexRenderer::setViewportAndScissor(VkCommandBuffer commandBuffer) {
 		VkViewport viewport{};
 		viewport.x = 0.0f;
 		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(vortexSwapChain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(vortexSwapChain->getSwapChainExtent().height);
+		viewport.width = static_cast<float>(getExtent().width);
+		viewport.height = static_cast<float>(getExtent().height);
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
-		VkRect2D scissor{ {0.0f, 0.0f}, vortexSwapChain->getSwapChainExtent() };
+		VkRect2D scissor{ {0, 0}, getExtent() };
 		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-
 	}
 
 	void VortexRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
@@ -151,4 +287,11 @@ namespace VortexEngine {
 
 		vkCmdEndRenderPass(commandBuffer);
 	}
+
+	void VortexRenderer::readbackFrame(std::vector<uint8_t>& pixels) {
+		assert(isHeadless() && "Frame readback is only available on a headless renderer!");
+		assert(!isFrameStarted && "Can't read back a frame while one is being recorded!");
+
+		offscreenTarget->readPixels(offscreenTarget->getLastSubmittedImage(), pixels);
+	}
 }
\ No newline at end of file
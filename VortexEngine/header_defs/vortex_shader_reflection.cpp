@@ -0,0 +1,542 @@
+#include "../headers/vortex_shader_reflection.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+namespace VortexEngine {
+	namespace {
+		constexpr uint32_t SPIRV_MAGIC = 0x07230203;
+		constexpr uint32_t SPIRV_HEADER_WORDS = 5;
+		constexpr uint32_t NOT_SET = std::numeric_limits<uint32_t>::max();
+
+		// the subset of the SPIR-V specification the reflection reads
+		enum SpirvOp : uint32_t {
+			OpName = 5,
+			OpEntryPoint = 15,
+			OpTypeBool = 20,
+			OpTypeInt = 21,
+			OpTypeFloat = 22,
+			OpTypeVector = 23,
+			OpTypeMatrix = 24,
+			OpTypeImage = 25,
+			OpTypeSampler = 26,
+			OpTypeSampledImage = 27,
+			OpTypeArray = 28,
+			OpTypeRuntimeArray = 29,
+			OpTypeStruct = 30,
+			OpTypePointer = 32,
+			OpConstant = 43,
+			OpSpecConstant = 50,
+			OpVariable = 59,
+			OpDecorate = 71,
+			OpMemberDecorate = 72
+		};
+
+		enum SpirvDecoration : uint32_t {
+			DecorationBlock = 2,
+			DecorationBufferBlock = 3,
+			DecorationArrayStride = 6,
+			DecorationMatrixStride = 7,
+			DecorationBuiltIn = 11,
+			DecorationLocation = 30,
+			DecorationBinding = 33,
+			DecorationDescriptorSet = 34,
+			DecorationOffset = 35
+		};
+
+		enum SpirvStorageClass : uint32_t {
+			StorageClassUniformConstant = 0,
+			StorageClassInput = 1,
+			StorageClassUniform = 2,
+			StorageClassPushConstant = 9,
+			StorageClassStorageBuffer = 12
+		};
+
+		enum SpirvDim : uint32_t {
+			DimBuffer = 5,
+			DimSubpassData = 6
+		};
+
+		struct Decorations {
+			uint32_t set = NOT_SET;
+			uint32_t binding = NOT_SET;
+			uint32_t location = NOT_SET;
+			uint32_t arrayStride = 0;
+			bool block = false;
+			bool bufferBlock = false;
+			bool builtIn = false;
+		};
+
+		struct MemberDecorations {
+			uint32_t offset = 0;
+			uint32_t matrixStride = 0;
+			bool builtIn = false;
+		};
+
+		// Types, constants, variables and decorations of a module by result id
+		struct SpirvModule {
+			uint32_t executionModel = NOT_SET;
+			// OpType* instructions: the opcode and the operands after the result id
+			std::unordered_map<uint32_t, std::pair<uint32_t, std::vector<uint32_t>>> types{};
+			std::unordered_map<uint32_t, uint32_t> constants{};
+			std::unordered_map<uint32_t, Decorations> decorations{};
+			std::map<std::pair<uint32_t, uint32_t>, MemberDecorations> memberDecorations{};
+			std::unordered_map<uint32_t, std::string> names{};
+			// (result id, pointer type, storage class)
+			std::vector<std::tuple<uint32_t, uint32_t, uint32_t>> variables{};
+
+			const std::pair<uint32_t, std::vector<uint32_t>>& getType(uint32_t id) const {
+				auto it = types.find(id);
+				if (it == types.end()) {
+					throw std::runtime_error("Shader reflection: unknown type id " + std::to_string(id));
+				}
+				return it->second;
+			}
+
+			uint32_t getConstant(uint32_t id) const {
+				auto it = constants.find(id);
+				if (it == constants.end()) {
+					throw std::runtime_error("Shader reflection: array length is not a constant");
+				}
+				return it->second;
+			}
+
+			Decorations getDecorations(uint32_t id) const {
+				auto it = decorations.find(id);
+				return it == decorations.end() ? Decorations{} : it->second;
+			}
+
+			MemberDecorations getMemberDecorations(uint32_t structId, uint32_t member) const {
+				auto it = memberDecorations.find({ structId, member });
+				return it == memberDecorations.end() ? MemberDecorations{} : it->second;
+			}
+
+			std::string getName(uint32_t id) const {
+				auto it = names.find(id);
+				return it == names.end() ? std::string{} : it->second;
+			}
+
+			// Bytes type occupies in an explicitly laid out block
+			uint32_t getSize(uint32_t id, uint32_t matrixStride = 0) const {
+				const auto& [opcode, operands] = getType(id);
+				switch (opcode) {
+				case OpTypeBool:
+					return 4;
+				case OpTypeInt:
+				case OpTypeFloat:
+					return operands[0] / 8;
+				case OpTypeVector:
+					return operands[1] * getSize(operands[0]);
+				case OpTypeMatrix:
+					return operands[1] * (matrixStride ? matrixStride : getSize(operands[0]));
+				case OpTypeArray: {
+					uint32_t stride = getDecorations(id).arrayStride;
+					return getConstant(operands[1]) * (stride ? stride : getSize(operands[0]));
+				}
+				case OpTypeRuntimeArray:
+					return 0;
+				case OpTypeStruct: {
+					uint32_t size = 0;
+					for (uint32_t member = 0; member < operands.size(); member++) {
+						MemberDecorations memberDecorations = getMemberDecorations(id, member);
+						size = std::max(size, memberDecorations.offset + getSize(operands[member], memberDecorations.matrixStride));
+					}
+					return size;
+				}
+				default:
+					throw std::runtime_error("Shader reflection: type without a size in a block");
+				}
+			}
+		};
+
+		std::string readString(const uint32_t* words, size_t wordCount) {
+			const char* characters = reinterpret_cast<const char*>(words);
+			return std::string{ characters, strnlen(characters, wordCount * sizeof(uint32_t)) };
+		}
+
+		VkShaderStageFlagBits getStageFlag(uint32_t executionModel) {
+			switch (executionModel) {
+			case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+			case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+			case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+			case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+			case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+			case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+			default:
+				throw std::runtime_error("Shader reflection: unsupported execution model " + std::to_string(executionModel));
+			}
+		}
+
+		// false for formats the validation does not know
+		bool getFormatComponents(VkFormat format, uint32_t& componentCount, VortexShaderReflection::BaseType& baseType) {
+			using BaseType = VortexShaderReflection::BaseType;
+			switch (format) {
+			case VK_FORMAT_R32_SFLOAT: componentCount = 1; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R32G32_SFLOAT: componentCount = 2; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R32G32B32_SFLOAT: componentCount = 3; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R32G32B32A32_SFLOAT: componentCount = 4; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R32_SINT: componentCount = 1; baseType = BaseType::Int; return true;
+			case VK_FORMAT_R32G32_SINT: componentCount = 2; baseType = BaseType::Int; return true;
+			case VK_FORMAT_R32G32B32_SINT: componentCount = 3; baseType = BaseType::Int; return true;
+			case VK_FORMAT_R32G32B32A32_SINT: componentCount = 4; baseType = BaseType::Int; return true;
+			case VK_FORMAT_R32_UINT: componentCount = 1; baseType = BaseType::UInt; return true;
+			case VK_FORMAT_R32G32_UINT: componentCount = 2; baseType = BaseType::UInt; return true;
+			case VK_FORMAT_R32G32B32_UINT: componentCount = 3; baseType = BaseType::UInt; return true;
+			case VK_FORMAT_R32G32B32A32_UINT: componentCount = 4; baseType = BaseType::UInt; return true;
+			case VK_FORMAT_R16G16_SFLOAT: componentCount = 2; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R16G16B16A16_SFLOAT: componentCount = 4; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R8G8B8A8_UNORM: componentCount = 4; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R8G8B8A8_SNORM: componentCount = 4; baseType = BaseType::Float; return true;
+			case VK_FORMAT_R8G8B8A8_UINT: componentCount = 4; baseType = BaseType::UInt; return true;
+			case VK_FORMAT_R8G8B8A8_SINT: componentCount = 4; baseType = BaseType::Int; return true;
+			default: return false;
+			}
+		}
+
+		const char* getBaseTypeName(VortexShaderReflection::BaseType baseType) {
+			switch (baseType) {
+			case VortexShaderReflection::BaseType::Float: return "float";
+			case VortexShaderReflection::BaseType::Int: return "int";
+			case VortexShaderReflection::BaseType::UInt: return "uint";
+			}
+			return "unknown";
+		}
+	}
+
+	VortexShaderReflection::VortexShaderReflection(const std::vector<char>& code) {
+		if (code.size() % sizeof(uint32_t) != 0 || code.size() < SPIRV_HEADER_WORDS * sizeof(uint32_t)) {
+			throw std::runtime_error("Shader reflection: code is not SPIR-V");
+		}
+
+		std::vector<uint32_t> words(code.size() / sizeof(uint32_t));
+		memcpy(words.data(), code.data(), code.size());
+		if (words[0] != SPIRV_MAGIC) {
+			throw std::runtime_error("Shader reflection: code is not SPIR-V");
+		}
+
+		reflect(words);
+	}
+
+	void VortexShaderReflection::reflect(const std::vector<uint32_t>& words) {
+		SpirvModule module{};
+
+		for (size_t position = SPIRV_HEADER_WORDS; position < words.size();) {
+			uint32_t wordCount = words[position] >> 16;
+			uint32_t opcode = words[position] & 0xffff;
+			if (wordCount == 0 || position + wordCount > words.size()) {
+				throw std::runtime_error("Shader reflection: truncated SPIR-V instruction");
+			}
+			const uint32_t* operands = &words[position + 1];
+			uint32_t operandCount = wordCount - 1;
+
+			switch (opcode) {
+			case OpName:
+				module.names[operands[0]] = readString(operands + 1, operandCount - 1);
+				break;
+			case OpEntryPoint:
+				// one entry point per module
+				if (module.executionModel == NOT_SET) {
+					module.executionModel = operands[0];
+				}
+				break;
+			case OpTypeBool:
+			case OpTypeInt:
+			case OpTypeFloat:
+			case OpTypeVector:
+			case OpTypeMatrix:
+			case OpTypeImage:
+			case OpTypeSampler:
+			case OpTypeSampledImage:
+			case OpTypeArray:
+			case OpTypeRuntimeArray:
+			case OpTypeStruct:
+			case OpTypePointer:
+				module.types[operands[0]] = { opcode, std::vector<uint32_t>(operands + 1, operands + operandCount) };
+				break;
+			case OpConstant:
+			case OpSpecConstant:
+				// array lengths only need the low word
+				module.constants[operands[1]] = operands[2];
+				break;
+			case OpVariable:
+				module.variables.emplace_back(operands[1], operands[0], operands[2]);
+				break;
+			case OpDecorate: {
+				Decorations& decorations = module.decorations[operands[0]];
+				switch (operands[1]) {
+				case DecorationBlock: decorations.block = true; break;
+				case DecorationBufferBlock: decorations.bufferBlock = true; break;
+				case DecorationArrayStride: decorations.arrayStride = operands[2]; break;
+				case DecorationBuiltIn: decorations.builtIn = true; break;
+				case DecorationLocation: decorations.location = operands[2]; break;
+				case DecorationBinding: decorations.binding = operands[2]; break;
+				case DecorationDescriptorSet: decorations.set = operands[2]; break;
+				}
+				break;
+			}
+			case OpMemberDecorate: {
+				MemberDecorations& decorations = module.memberDecorations[{ operands[0], operands[1] }];
+				switch (operands[2]) {
+				case DecorationOffset: decorations.offset = operands[3]; break;
+				case DecorationMatrixStride: decorations.matrixStride = operands[3]; break;
+				case DecorationBuiltIn: decorations.builtIn = true; break;
+				}
+				break;
+			}
+			}
+
+			position += wordCount;
+		}
+
+		if (module.executionModel == NOT_SET) {
+			throw std::runtime_error("Shader reflection: module has no entry point");
+		}
+		stage = getStageFlag(module.executionModel);
+
+		uint32_t pushConstantBegin = NOT_SET;
+		uint32_t pushConstantEnd = 0;
+
+		for (auto& [variable, pointerType, storageClass] : module.variables) {
+			uint32_t type = module.getType(pointerType).second[1];
+			Decorations variableDecorations = module.getDecorations(variable);
+			std::string name = module.getName(variable);
+
+			switch (storageClass) {
+			case StorageClassUniformConstant:
+			case StorageClassUniform:
+			case StorageClassStorageBuffer: {
+				DescriptorBinding binding{};
+				binding.set = variableDecorations.set == NOT_SET ? 0 : variableDecorations.set;
+				binding.binding = variableDecorations.binding == NOT_SET ? 0 : variableDecorations.binding;
+				binding.count = 1;
+				binding.stageFlags = stage;
+
+				auto* resourceType = &module.getType(type);
+				if (resourceType->first == OpTypeArray) {
+					binding.count = module.getConstant(resourceType->second[1]);
+					type = resourceType->second[0];
+					resourceType = &module.getType(type);
+				}
+				else if (resourceType->first == OpTypeRuntimeArray) {
+					binding.count = 0;
+					type = resourceType->second[0];
+					resourceType = &module.getType(type);
+				}
+
+				// buffer blocks are often anonymous, their type carries the name
+				binding.name = name.empty() ? module.getName(type) : name;
+
+				const auto& [resourceOpcode, resourceOperands] = *resourceType;
+				if (storageClass == StorageClassStorageBuffer) {
+					binding.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				}
+				else if (storageClass == StorageClassUniform) {
+					binding.type = module.getDecorations(type).bufferBlock
+						? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+						: VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+				}
+				else if (resourceOpcode == OpTypeSampledImage) {
+					binding.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				}
+				else if (resourceOpcode == OpTypeSampler) {
+					binding.type = VK_DESCRIPTOR_TYPE_SAMPLER;
+				}
+				else if (resourceOpcode == OpTypeImage) {
+					// operands: sampled type, dim, depth, arrayed, multisampled, sampled
+					uint32_t dim = resourceOperands[1];
+					bool storage = resourceOperands[5] == 2;
+					if (dim == DimBuffer) {
+						binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+					}
+					else if (dim == DimSubpassData) {
+						binding.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+					}
+					else {
+						binding.type = storage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+					}
+				}
+				else {
+					throw std::runtime_error("Shader reflection: unsupported descriptor type for " + binding.name);
+				}
+
+				descriptorBindings.push_back(std::move(binding));
+				break;
+			}
+			case StorageClassPushConstant: {
+				const auto& members = module.getType(type).second;
+				for (uint32_t member = 0; member < members.size(); member++) {
+					MemberDecorations memberDecorations = module.getMemberDecorations(type, member);
+					pushConstantBegin = std::min(pushConstantBegin, memberDecorations.offset);
+					pushConstantEnd = std::max(pushConstantEnd,
+						memberDecorations.offset + module.getSize(members[member], memberDecorations.matrixStride));
+				}
+				break;
+			}
+			case StorageClassInput: {
+				if (stage != VK_SHADER_STAGE_VERTEX_BIT || variableDecorations.builtIn) {
+					break;
+				}
+
+				// gl_PerVertex style input blocks only hold built-ins
+				const auto* inputType = &module.getType(type);
+				if (inputType->first == OpTypeStruct) {
+					break;
+				}
+				if (variableDecorations.location == NOT_SET) {
+					throw std::runtime_error("Shader reflection: vertex input " + name + " has no location");
+				}
+
+				uint32_t slots = 1;
+				if (inputType->first == OpTypeArray) {
+					slots = module.getConstant(inputType->second[1]);
+					inputType = &module.getType(inputType->second[0]);
+				}
+				if (inputType->first == OpTypeMatrix) {
+					slots *= inputType->second[1];
+					inputType = &module.getType(inputType->second[0]);
+				}
+
+				uint32_t componentCount = 1;
+				if (inputType->first == OpTypeVector) {
+					componentCount = inputType->second[1];
+					inputType = &module.getType(inputType->second[0]);
+				}
+
+				BaseType baseType = BaseType::Float;
+				if (inputType->first == OpTypeInt) {
+					// operands: width, signedness
+					baseType = inputType->second[1] ? BaseType::Int : BaseType::UInt;
+				}
+				else if (inputType->first != OpTypeFloat) {
+					throw std::runtime_error("Shader reflection: unsupported type for vertex input " + name);
+				}
+
+				for (uint32_t slot = 0; slot < slots; slot++) {
+					vertexInputs.push_back({ variableDecorations.location + slot, componentCount, baseType, name });
+				}
+				break;
+			}
+			}
+		}
+
+		if (pushConstantBegin != NOT_SET) {
+			pushConstantRange.stageFlags = stage;
+			pushConstantRange.offset = pushConstantBegin;
+			pushConstantRange.size = pushConstantEnd - pushConstantBegin;
+		}
+
+		std::sort(descriptorBindings.begin(), descriptorBindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b) {
+			return std::tie(a.set, a.binding) < std::tie(b.set, b.binding);
+		});
+		std::sort(vertexInputs.begin(), vertexInputs.end(), [](const VertexInput& a, const VertexInput& b) {
+			return a.location < b.location;
+		});
+	}
+
+	void VortexShaderReflection::validateVertexInput(const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) const {
+		for (const VertexInput& input : vertexInputs) {
+			auto attribute = std::find_if(attributeDescriptions.begin(), attributeDescriptions.end(),
+				[&input](const VkVertexInputAttributeDescription& description) { return description.location == input.location; });
+
+			std::string inputName = "vertex input " + input.name + " (location " + std::to_string(input.location) + ")";
+			if (attribute == attributeDescriptions.end()) {
+				throw std::runtime_error("No vertex attribute supplies " + inputName);
+			}
+
+			uint32_t componentCount;
+			BaseType baseType;
+			if (!getFormatComponents(attribute->format, componentCount, baseType)) {
+				continue;
+			}
+
+			if (componentCount != input.componentCount || baseType != input.baseType) {
+				throw std::runtime_error(
+					"The shader reads " + inputName + " as " + std::to_string(input.componentCount) + " " + getBaseTypeName(input.baseType) +
+					" components but its attribute format has " + std::to_string(componentCount) + " " + getBaseTypeName(baseType) + " components");
+			}
+		}
+	}
+
+	VortexShaderReflection::Layout VortexShaderReflection::mergeLayouts(const std::vector<const VortexShaderReflection*>& stages) {
+		Layout layout{};
+		// names of the merged bindings, for error messages
+		std::map<std::pair<uint32_t, uint32_t>, std::string> bindingNames;
+
+		for (const VortexShaderReflection* reflection : stages) {
+			for (const DescriptorBinding& binding : reflection->descriptorBindings) {
+				if (layout.sets.size() <= binding.set) {
+					layout.sets.resize(binding.set + 1);
+				}
+
+				auto& setBindings = layout.sets[binding.set];
+				auto existing = std::find_if(setBindings.begin(), setBindings.end(),
+					[&binding](const VkDescriptorSetLayoutBinding& setBinding) { return setBinding.binding == binding.binding; });
+
+				if (existing == setBindings.end()) {
+					VkDescriptorSetLayoutBinding setBinding{};
+					setBinding.binding = binding.binding;
+					setBinding.descriptorType = binding.type;
+					setBinding.descriptorCount = binding.count;
+					setBinding.stageFlags = binding.stageFlags;
+					setBindings.push_back(setBinding);
+					bindingNames[{ binding.set, binding.binding }] = binding.name;
+					continue;
+				}
+
+				if (existing->descriptorType != binding.type || existing->descriptorCount != binding.count) {
+					throw std::runtime_error(
+						"Descriptor set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding) +
+						" is " + bindingNames[{ binding.set, binding.binding }] + " (" + getDescriptorTypeName(existing->descriptorType) +
+						" x" + std::to_string(existing->descriptorCount) + ") in one stage and " + binding.name +
+						" (" + getDescriptorTypeName(binding.type) + " x" + std::to_string(binding.count) + ") in another");
+				}
+				existing->stageFlags |= binding.stageFlags;
+			}
+
+			const VkPushConstantRange& range = reflection->pushConstantRange;
+			if (range.size == 0) {
+				continue;
+			}
+
+			// stages sharing a block share its range
+			auto existing = std::find_if(layout.pushConstantRanges.begin(), layout.pushConstantRanges.end(),
+				[&range](const VkPushConstantRange& other) { return other.offset == range.offset && other.size == range.size; });
+			if (existing != layout.pushConstantRanges.end()) {
+				existing->stageFlags |= range.stageFlags;
+			}
+			else {
+				layout.pushConstantRanges.push_back(range);
+			}
+		}
+
+		for (auto& setBindings : layout.sets) {
+			std::sort(setBindings.begin(), setBindings.end(), [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+				return a.binding < b.binding;
+			});
+		}
+
+		return layout;
+	}
+
+	const char* VortexShaderReflection::getDescriptorTypeName(VkDescriptorType type) {
+		switch (type) {
+		case VK_DESCRIPTOR_TYPE_SAMPLER: return "sampler";
+		case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER: return "combined image sampler";
+		case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE: return "sampled image";
+		case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE: return "storage image";
+		case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER: return "uniform texel buffer";
+		case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER: return "storage texel buffer";
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER: return "uniform buffer";
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER: return "storage buffer";
+		case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC: return "dynamic uniform buffer";
+		case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC: return "dynamic storage buffer";
+		case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT: return "input attachment";
+		default: return "descriptor";
+		}
+	}
+}
@@ -0,0 +1,472 @@
+#include "../headers/vortex_transform_store.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VORTEX_TRANSFORM_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace VortexEngine {
+
+	namespace {
+#ifdef VORTEX_TRANSFORM_SSE
+		// Four sin / cos pairs at once. The argument is reduced to [-pi/4, pi/4] by quadrant and
+		// both functions come from the cephes single precision polynomials, accurate to a couple of
+		// ulps for the angle ranges transforms use.
+		void sinCos4(__m128 x, __m128& sine, __m128& cosine) {
+			const __m128 twoOverPi = _mm_set1_ps(0.636619772367581343f);
+			const __m128 piOverTwoHigh = _mm_set1_ps(1.5707963705062866f);
+			const __m128 piOverTwoLow = _mm_set1_ps(-4.37113900018624283e-8f);
+
+			__m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, twoOverPi));
+			__m128 quadrantFloat = _mm_cvtepi32_ps(quadrant);
+			__m128 r = _mm_sub_ps(x, _mm_mul_ps(quadrantFloat, piOverTwoHigh));
+			r = _mm_sub_ps(r, _mm_mul_ps(quadrantFloat, piOverTwoLow));
+			__m128 r2 = _mm_mul_ps(r, r);
+
+			__m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, r2), _mm_set1_ps(8.3321608736e-3f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, r2), _mm_set1_ps(-1.6666654611e-1f));
+			sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, r2), r), r);
+
+			__m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, r2), _mm_set1_ps(-1.388731625493765e-3f));
+			cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, r2), _mm_set1_ps(4.166664568298827e-2f));
+			cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, r2), r2);
+			cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+			// odd quadrants swap the polynomials, quadrants 2 and 3 negate sine, 1 and 2 negate cosine
+			const __m128i one = _mm_set1_epi32(1);
+			const __m128i two = _mm_set1_epi32(2);
+			__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, one), one));
+			__m128 sineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, two), 30));
+			__m128 cosineSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, one), two), 30));
+
+			sine = _mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly));
+			cosine = _mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly));
+			sine = _mm_xor_ps(sine, sineSign);
+			cosine = _mm_xor_ps(cosine, cosineSign);
+		}
+
+		// Transposes four per-lane column vectors and stores column `column` of each lane's matrix
+		void storeColumn(glm::mat4* matrices[4], int column, __m128 x, __m128 y, __m128 z, __m128 w) {
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(&matrices[0][0][column][0], x);
+			_mm_storeu_ps(&matrices[1][0][column][0], y);
+			_mm_storeu_ps(&matrices[2][0][column][0], z);
+			_mm_storeu_ps(&matrices[3][0][column][0], w);
+		}
+#endif
+
+		// out = a * b, out must not alias a or b
+		void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& out) {
+#ifdef VORTEX_TRANSFORM_SSE
+			const __m128 a0 = _mm_loadu_ps(&a[0][0]);
+			const __m128 a1 = _mm_loadu_ps(&a[1][0]);
+			const __m128 a2 = _mm_loadu_ps(&a[2][0]);
+			const __m128 a3 = _mm_loadu_ps(&a[3][0]);
+			for (int column = 0; column < 4; column++) {
+				const __m128 b0 = _mm_set1_ps(b[column][0]);
+				const __m128 b1 = _mm_set1_ps(b[column][1]);
+				const __m128 b2 = _mm_set1_ps(b[column][2]);
+				const __m128 b3 = _mm_set1_ps(b[column][3]);
+				__m128 result = _mm_add_ps(_mm_mul_ps(a0, b0), _mm_mul_ps(a1, b1));
+				result = _mm_add_ps(result, _mm_add_ps(_mm_mul_ps(a2, b2), _mm_mul_ps(a3, b3)));
+				_mm_storeu_ps(&out[column][0], result);
+			}
+#else
+			out = a * b;
+#endif
+		}
+	}
+
+	void VortexTransformStore::resize(uint32_t count) {
+		uint32_t previousCount = size();
+		if (count == previousCount) {
+			return;
+		}
+
+		translationX.resize(count, 0.0f);
+		translationY.resize(count, 0.0f);
+		translationZ.resize(count, 0.0f);
+		rotationX.resize(count, 0.0f);
+		rotationY.resize(count, 0.0f);
+		rotationZ.resize(count, 0.0f);
+		scaleX.resize(count, 1.0f);
+		scaleY.resize(count, 1.0f);
+		scaleZ.resize(count, 1.0f);
+		parents.resize(count, NO_PARENT);
+		matrices.resize(count);
+		hierarchyChanged = true;
+
+		if (count > previousCount) {
+			// new transforms take the new slots, the existing slot order stays valid
+			dirty.resize(count, 0);
+			slots.resize(count);
+			for (uint32_t i = previousCount; i < count; i++) {
+				slots[i] = i;
+				markDirty(i);
+			}
+			return;
+		}
+
+		// the kept transforms may live in removed slots, so go back to one slot per index and
+		// recompute everything; children of removed transforms become roots
+		slots.resize(count);
+		parentedCount = 0;
+		for (uint32_t i = 0; i < count; i++) {
+			slots[i] = i;
+			if (parents[i] >= count) {
+				parents[i] = NO_PARENT;
+			}
+			if (parents[i] != NO_PARENT) {
+				parentedCount++;
+			}
+		}
+
+		dirty.assign(count, 0);
+		dirtyIndices.clear();
+		for (uint32_t i = 0; i < count; i++) {
+			markDirty(i);
+		}
+	}
+
+	void VortexTransformStore::set(uint32_t index, const TransformComponent& transform) {
+		if (translationX[index] == transform.translation.x && translationY[index] == transform.translation.y &&
+			translationZ[index] == transform.translation.z && rotationX[index] == transform.rotation.x &&
+			rotationY[index] == transform.rotation.y && rotationZ[index] == transform.rotation.z &&
+			scaleX[index] == transform.scale.x && scaleY[index] == transform.scale.y && scaleZ[index] == transform.scale.z) {
+			return;
+		}
+
+		translationX[index] = transform.translation.x;
+		translationY[index] = transform.translation.y;
+		translationZ[index] = transform.translation.z;
+		rotationX[index] = transform.rotation.x;
+		rotationY[index] = transform.rotation.y;
+		rotationZ[index] = transform.rotation.z;
+		scaleX[index] = transform.scale.x;
+		scaleY[index] = transform.scale.y;
+		scaleZ[index] = transform.scale.z;
+		markDirty(index);
+	}
+
+	TransformComponent VortexTransformStore::get(uint32_t index) const {
+		TransformComponent transform{};
+		transform.translation = { translationX[index], translationY[index], translationZ[index] };
+		transform.rotation = { rotationX[index], rotationY[index], rotationZ[index] };
+		transform.scale = { scaleX[index], scaleY[index], scaleZ[index] };
+		return transform;
+	}
+
+	void VortexTransformStore::setParent(uint32_t index, uint32_t parentIndex) {
+		assert(index < size() && (parentIndex == NO_PARENT || parentIndex < size()) && "Transform index out of range!");
+
+		if (parents[index] == parentIndex) {
+			return;
+		}
+
+		if (parents[index] == NO_PARENT) {
+			parentedCount++;
+		}
+		else if (parentIndex == NO_PARENT) {
+			parentedCount--;
+		}
+
+		parents[index] = parentIndex;
+		hierarchyChanged = true;
+		markDirty(index);
+	}
+
+	uint32_t VortexTransformStore::sync(VortexWorld& world, VortexJobSystem* jobSystem) {
+		resize(world.getEntityCapacity());
+		world.each<TransformComponent>([this](VortexEntity entity, TransformComponent& transform) {
+			set(entity.index, transform);
+		});
+
+		// children that lost their ParentComponent, or were destroyed, become roots again
+		auto& parentPool = world.getPool<ParentComponent>();
+		for (uint32_t index : syncedChildren) {
+			if (index < size() && !parentPool.contains(index)) {
+				setParent(index, NO_PARENT);
+			}
+		}
+		syncedChildren = parentPool.getEntities();
+
+		world.each<ParentComponent>([this, &world](VortexEntity entity, ParentComponent& parent) {
+			setParent(entity.index, world.isAlive(parent.parent) ? parent.parent.index : NO_PARENT);
+		});
+
+		return update(jobSystem);
+	}
+
+	void VortexTransformStore::markDirty(uint32_t index) {
+		if (!dirty[index]) {
+			dirty[index] = 1;
+			dirtyIndices.push_back(index);
+		}
+	}
+
+	uint32_t VortexTransformStore::update(VortexJobSystem* jobSystem) {
+		updatedIndices.clear();
+
+		const bool flat = parentedCount == 0;
+		auto updateRange = [this, flat](size_t first, size_t last) {
+			updateLocalMatrices(first, last);
+			if (flat) {
+				// world matrices are the local ones
+				for (size_t i = first; i < last; i++) {
+					SlotMatrices& slot = matrices[slots[dirtyIndices[i]]];
+					slot.model = slot.localModel;
+					slot.normal = slot.localNormal;
+				}
+			}
+		};
+
+		if (jobSystem && dirtyIndices.size() >= PARALLEL_UPDATE_THRESHOLD) {
+			jobSystem->parallelFor(dirtyIndices.size(), LOCAL_MATRIX_GRAIN, updateRange);
+		}
+		else {
+			updateRange(0, dirtyIndices.size());
+		}
+
+		if (flat) {
+			updatedIndices = dirtyIndices;
+		}
+		else {
+			if (hierarchyChanged) {
+				buildHierarchyOrder();
+			}
+			updateHierarchy(jobSystem);
+		}
+
+		for (uint32_t index : dirtyIndices) {
+			dirty[index] = 0;
+		}
+		dirtyIndices.clear();
+		return static_cast<uint32_t>(updatedIndices.size());
+	}
+
+	void VortexTransformStore::updateLocalMatrices(size_t first, size_t last) {
+		size_t next = first;
+
+#ifdef VORTEX_TRANSFORM_SSE
+		for (; next < last; next += 4) {
+			// a short last batch repeats its final index, writing that matrix more than once
+			uint32_t lanes[4];
+			for (size_t lane = 0; lane < 4; lane++) {
+				lanes[lane] = dirtyIndices[std::min(next + lane, last - 1)];
+			}
+
+			auto gather = [&lanes](const std::vector<float>& stream) {
+				return _mm_setr_ps(stream[lanes[0]], stream[lanes[1]], stream[lanes[2]], stream[lanes[3]]);
+			};
+
+			__m128 s1, c1, s2, c2, s3, c3;
+			sinCos4(gather(rotationY), s1, c1);
+			sinCos4(gather(rotationX), s2, c2);
+			sinCos4(gather(rotationZ), s3, c3);
+
+			// rotation part shared by both matrices, Tait-Bryan Y(1), X(2), Z(3)
+			const __m128 s1s2 = _mm_mul_ps(s1, s2);
+			const __m128 c1s2 = _mm_mul_ps(c1, s2);
+			const __m128 r00 = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+			const __m128 r01 = _mm_mul_ps(c2, s3);
+			const __m128 r02 = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+			const __m128 r10 = _mm_sub_ps(_mm_mul_ps(c3, s1s2), _mm_mul_ps(c1, s3));
+			const __m128 r11 = _mm_mul_ps(c2, c3);
+			const __m128 r12 = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+			const __m128 r20 = _mm_mul_ps(c2, s1);
+			const __m128 r21 = _mm_sub_ps(_mm_setzero_ps(), s2);
+			const __m128 r22 = _mm_mul_ps(c1, c2);
+
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 sx = gather(scaleX);
+			const __m128 sy = gather(scaleY);
+			const __m128 sz = gather(scaleZ);
+			const __m128 isx = _mm_div_ps(one, sx);
+			const __m128 isy = _mm_div_ps(one, sy);
+			const __m128 isz = _mm_div_ps(one, sz);
+
+			glm::mat4* models[4] = {
+				&matrices[slots[lanes[0]]].localModel, &matrices[slots[lanes[1]]].localModel,
+				&matrices[slots[lanes[2]]].localModel, &matrices[slots[lanes[3]]].localModel };
+			storeColumn(models, 0, _mm_mul_ps(sx, r00), _mm_mul_ps(sx, r01), _mm_mul_ps(sx, r02), zero);
+			storeColumn(models, 1, _mm_mul_ps(sy, r10), _mm_mul_ps(sy, r11), _mm_mul_ps(sy, r12), zero);
+			storeColumn(models, 2, _mm_mul_ps(sz, r20), _mm_mul_ps(sz, r21), _mm_mul_ps(sz, r22), zero);
+			storeColumn(models, 3, gather(translationX), gather(translationY), gather(translationZ), one);
+
+			glm::mat4* normals[4] = {
+				&matrices[slots[lanes[0]]].localNormal, &matrices[slots[lanes[1]]].localNormal,
+				&matrices[slots[lanes[2]]].localNormal, &matrices[slots[lanes[3]]].localNormal };
+			storeColumn(normals, 0, _mm_mul_ps(isx, r00), _mm_mul_ps(isx, r01), _mm_mul_ps(isx, r02), zero);
+			storeColumn(normals, 1, _mm_mul_ps(isy, r10), _mm_mul_ps(isy, r11), _mm_mul_ps(isy, r12), zero);
+			storeColumn(normals, 2, _mm_mul_ps(isz, r20), _mm_mul_ps(isz, r21), _mm_mul_ps(isz, r22), zero);
+			storeColumn(normals, 3, zero, zero, zero, one);
+		}
+#else
+		for (; next < last; next++) {
+			uint32_t index = dirtyIndices[next];
+			TransformComponent transform = get(index);
+			matrices[slots[index]].localModel = transform.mat4();
+			matrices[slots[index]].localNormal = glm::mat4{ transform.normalMatrix() };
+		}
+#endif
+	}
+
+	void VortexTransformStore::buildHierarchyOrder() {
+		const uint32_t count = size();
+
+		// children of each transform, in index order
+		std::vector<uint32_t> childOffsets(static_cast<size_t>(count) + 1, 0);
+		for (uint32_t i = 0; i < count; i++) {
+			if (parents[i] != NO_PARENT) {
+				childOffsets[parents[i] + 1]++;
+			}
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			childOffsets[i + 1] += childOffsets[i];
+		}
+		std::vector<uint32_t> children(childOffsets[count]);
+		std::vector<uint32_t> nextChild(childOffsets.begin(), childOffsets.end() - 1);
+		for (uint32_t i = 0; i < count; i++) {
+			if (parents[i] != NO_PARENT) {
+				children[nextChild[parents[i]]++] = i;
+			}
+		}
+
+		// breadth first from the roots: levels are contiguous, siblings are adjacent and every level
+		// reads its parents in order from the previous one
+		std::vector<uint32_t> order;
+		order.reserve(count);
+		for (uint32_t i = 0; i < count; i++) {
+			if (parents[i] == NO_PARENT) {
+				order.push_back(i);
+			}
+		}
+
+		levelOffsets.assign(1, 0);
+		for (size_t head = 0; head < order.size();) {
+			size_t levelEnd = order.size();
+			levelOffsets.push_back(static_cast<uint32_t>(levelEnd));
+			for (; head < levelEnd; head++) {
+				uint32_t node = order[head];
+				order.insert(order.end(), children.begin() + childOffsets[node], children.begin() + childOffsets[node + 1]);
+			}
+		}
+
+		// transforms in a cycle are never reached from a root
+		if (order.size() != count) {
+			throw std::runtime_error("Transform hierarchy contains a cycle!");
+		}
+
+		// move the cached matrices into their breadth first slots
+		std::vector<SlotMatrices> reordered(count);
+		for (uint32_t slot = 0; slot < count; slot++) {
+			reordered[slot] = matrices[slots[order[slot]]];
+		}
+		matrices.swap(reordered);
+
+		for (uint32_t slot = 0; slot < count; slot++) {
+			slots[order[slot]] = slot;
+		}
+
+		// siblings are adjacent and follow their parents' order, so the children of slot s are the
+		// slots [slotChildren[s], slotChildren[s + 1])
+		slotParents.resize(count);
+		slotChildren.resize(static_cast<size_t>(count) + 1);
+		uint32_t nextChildSlot = levelOffsets.size() > 1 ? levelOffsets[1] : count;
+		for (uint32_t slot = 0; slot < count; slot++) {
+			uint32_t index = order[slot];
+			slotParents[slot] = parents[index] == NO_PARENT ? NO_PARENT : slots[parents[index]];
+			slotChildren[slot] = nextChildSlot;
+			nextChildSlot += childOffsets[index + 1] - childOffsets[index];
+		}
+		slotChildren[count] = nextChildSlot;
+
+		slotIndices.swap(order);
+		changedSlots.assign(count, 0);
+		hierarchyChanged = false;
+	}
+
+	void VortexTransformStore::updateHierarchy(VortexJobSystem* jobSystem) {
+		// ancestors sit in lower slots than their descendants, so walking the dirty slots in order
+		// reaches a dirty subtree through its topmost dirty transform and skips the rest of it
+		dirtySlots.clear();
+		for (uint32_t index : dirtyIndices) {
+			dirtySlots.push_back(slots[index]);
+		}
+		std::sort(dirtySlots.begin(), dirtySlots.end());
+
+		// mark the dirty subtrees first; they never overlap, so their matrices can then be
+		// computed independently
+		subtreeRoots.clear();
+		for (uint32_t dirtySlot : dirtySlots) {
+			if (changedSlots[dirtySlot]) {
+				continue;
+			}
+
+			subtreeRoots.push_back(dirtySlot);
+			changedSlots[dirtySlot] = 1;
+			slotStack.push_back(dirtySlot);
+			while (!slotStack.empty()) {
+				uint32_t slot = slotStack.back();
+				slotStack.pop_back();
+				updatedIndices.push_back(slotIndices[slot]);
+
+				for (uint32_t child = slotChildren[slot]; child < slotChildren[slot + 1]; child++) {
+					changedSlots[child] = 1;
+					slotStack.push_back(child);
+				}
+			}
+		}
+
+		if (jobSystem && updatedIndices.size() >= PARALLEL_UPDATE_THRESHOLD) {
+			size_t grain = std::max<size_t>(subtreeRoots.size() / ((jobSystem->getWorkerCount() + 1) * 4), 1);
+			jobSystem->parallelFor(subtreeRoots.size(), grain, [this](size_t first, size_t last) {
+				std::vector<uint32_t> stack;
+				updateSubtrees(first, last, stack);
+			});
+		}
+		else {
+			updateSubtrees(0, subtreeRoots.size(), slotStack);
+		}
+
+		for (uint32_t index : updatedIndices) {
+			changedSlots[slots[index]] = 0;
+		}
+	}
+
+	void VortexTransformStore::updateSubtrees(size_t firstRoot, size_t lastRoot, std::vector<uint32_t>& stack) {
+		for (size_t root = firstRoot; root < lastRoot; root++) {
+			stack.push_back(subtreeRoots[root]);
+			while (!stack.empty()) {
+				uint32_t slot = stack.back();
+				stack.pop_back();
+
+				SlotMatrices& current = matrices[slot];
+				uint32_t parentSlot = slotParents[slot];
+				if (parentSlot == NO_PARENT) {
+					current.model = current.localModel;
+					current.normal = current.localNormal;
+				}
+				else {
+					const SlotMatrices& parent = matrices[parentSlot];
+					multiply(parent.model, current.localModel, current.model);
+					// (AB)^-T = A^-T B^-T, so normal matrices compose the same way
+					multiply(parent.normal, current.localNormal, current.normal);
+				}
+
+				// pushed last to first so siblings are visited in slot order
+				for (uint32_t child = slotChildren[slot + 1]; child > slotChildren[slot]; child--) {
+					stack.push_back(child - 1);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,264 @@
+#include "../headers/vortex_upload_queue.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+namespace VortexEngine {
+
+    VortexUploadQueue::VortexUploadQueue(VortexDevice& device, VkDeviceSize stagingSize)
+        : vortexDevice{ device }, capacity{ stagingSize } {
+        stagingBuffer = std::make_unique<VortexBuffer>(
+            vortexDevice,
+            capacity,
+            1,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        // mapped for the lifetime of the queue
+        if (stagingBuffer->map() != VK_SUCCESS) {
+            throw std::runtime_error("failed to map upload staging buffer!");
+        }
+        stagingMemory = static_cast<char*>(stagingBuffer->getMappedMemory());
+    }
+
+    VortexUploadQueue::~VortexUploadQueue() {
+        waitIdle();
+
+        for (auto& batch : freeBatches) {
+            vkFreeCommandBuffers(vortexDevice.device(), vortexDevice.getCommandPool(), 1, &batch.commandBuffer);
+            vkDestroyFence(vortexDevice.device(), batch.fence, nullptr);
+        }
+    }
+
+    void VortexUploadQueue::uploadToBuffer(
+        VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset) {
+        const char* source = static_cast<const char*>(data);
+
+        // anything bigger than half the ring is split so it can stream through while the GPU
+        // is still consuming the previous chunk
+        const VkDeviceSize maxChunkSize = std::max<VkDeviceSize>(capacity / 2, 1);
+
+        for (VkDeviceSize copied = 0; copied < size;) {
+            VkDeviceSize chunkSize = std::min(size - copied, maxChunkSize);
+            VkDeviceSize stagingOffset = allocateStaging(chunkSize, 16);
+            memcpy(stagingMemory + stagingOffset, source + copied, static_cast<size_t>(chunkSize));
+
+            VkBufferCopy copyRegion{};
+            copyRegion.srcOffset = stagingOffset;
+            copyRegion.dstOffset = dstOffset + copied;
+            copyRegion.size = chunkSize;
+            vkCmdCopyBuffer(currentBatch.commandBuffer, stagingBuffer->getBuffer(), dstBuffer, 1, &copyRegion);
+
+            copied += chunkSize;
+            stats.copies++;
+            stats.bytesUploaded += chunkSize;
+        }
+    }
+
+    void VortexUploadQueue::uploadToImage(
+        VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t layerCount) {
+        assert(size <= capacity && "Image upload does not fit in the staging ring");
+
+        VkDeviceSize stagingOffset = allocateStaging(size, 16);
+        memcpy(stagingMemory + stagingOffset, data, static_cast<size_t>(size));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingOffset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = layerCount;
+
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { width, height, 1 };
+
+        vkCmdCopyBufferToImage(
+            currentBatch.commandBuffer,
+            stagingBuffer->getBuffer(),
+            image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &region);
+
+        stats.copies++;
+        stats.bytesUploaded += size;
+    }
+
+    void VortexUploadQueue::flush() {
+        if (!recording) {
+            return;
+        }
+
+        // make the copies visible to whatever the graphics queue runs next
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        vkCmdPipelineBarrier(
+            currentBatch.commandBuffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0,
+            1,
+            &barrier,
+            0,
+            nullptr,
+            0,
+            nullptr);
+
+        if (vkEndCommandBuffer(currentBatch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &currentBatch.commandBuffer;
+
+        vkResetFences(vortexDevice.device(), 1, &currentBatch.fence);
+        if (vkQueueSubmit(vortexDevice.graphicsQueue(), 1, &submitInfo, currentBatch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        inFlightBatches.push_back(currentBatch);
+        currentBatch = Batch{};
+        recording = false;
+        stats.submissions++;
+    }
+
+    void VortexUploadQueue::waitIdle() {
+        flush();
+
+        while (!inFlightBatches.empty()) {
+            retireCompletedBatches(true);
+        }
+    }
+
+    VkDeviceSize VortexUploadQueue::allocateStaging(VkDeviceSize size, VkDeviceSize alignment) {
+        assert(size <= capacity && "Staging allocation larger than the upload ring");
+
+        retireCompletedBatches(false);
+
+        VkDeviceSize offset = 0;
+        while (!tryAllocate(size, alignment, offset)) {
+            // the current batch's space only comes back once it has been submitted and completed
+            flush();
+            stats.stalls++;
+            retireCompletedBatches(true);
+        }
+
+        if (!recording) {
+            currentBatch = acquireBatch();
+            currentBatch.ringBegin = offset;
+
+            VkCommandBufferBeginInfo beginInfo{};
+            beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            if (vkBeginCommandBuffer(currentBatch.commandBuffer, &beginInfo) != VK_SUCCESS) {
+                throw std::runtime_error("failed to begin upload command buffer!");
+            }
+
+            recording = true;
+        }
+
+        return offset;
+    }
+
+    bool VortexUploadQueue::tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+        if (!recording && inFlightBatches.empty()) {
+            // nothing live, start again from the front of the ring
+            tail = 0;
+            offset = 0;
+            head = size;
+            return true;
+        }
+
+        VkDeviceSize alignedHead = (head + alignment - 1) & ~(alignment - 1);
+
+        // head == tail only happens when the ring is empty (handled above), the strict
+        // comparisons below keep it that way
+        if (head >= tail) {
+            // live region is [tail, head), free space at the end and then before tail
+            if (alignedHead + size <= capacity) {
+                offset = alignedHead;
+                head = offset + size;
+                return true;
+            }
+            if (size < tail) {
+                offset = 0;
+                head = size;
+                return true;
+            }
+            return false;
+        }
+
+        // wrapped: live region is [tail, capacity) + [0, head)
+        if (alignedHead + size < tail) {
+            offset = alignedHead;
+            head = offset + size;
+            return true;
+        }
+        return false;
+    }
+
+    void VortexUploadQueue::retireCompletedBatches(bool waitForOldest) {
+        if (waitForOldest && !inFlightBatches.empty()) {
+            vkWaitForFences(
+                vortexDevice.device(),
+                1,
+                &inFlightBatches.front().fence,
+                VK_TRUE,
+                std::numeric_limits<uint64_t>::max());
+        }
+
+        while (!inFlightBatches.empty() &&
+            vkGetFenceStatus(vortexDevice.device(), inFlightBatches.front().fence) == VK_SUCCESS) {
+            freeBatches.push_back(inFlightBatches.front());
+            inFlightBatches.pop_front();
+        }
+
+        if (!inFlightBatches.empty()) {
+            tail = inFlightBatches.front().ringBegin;
+        }
+        else if (recording) {
+            tail = currentBatch.ringBegin;
+        }
+    }
+
+    VortexUploadQueue::Batch VortexUploadQueue::acquireBatch() {
+        if (!freeBatches.empty()) {
+            Batch batch = freeBatches.back();
+            freeBatches.pop_back();
+            return batch;
+        }
+
+        Batch batch{};
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = vortexDevice.getCommandPool();
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(vortexDevice.device(), &allocInfo, &batch.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        if (vkCreateFence(vortexDevice.device(), &fenceInfo, nullptr, &batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload fence!");
+        }
+
+        return batch;
+    }
+
+}  // namespace VortexEngine
@@ -0,0 +1,46 @@
+#include "../headers/vortex_world.h"
+
+#include <atomic>
+
+namespace VortexEngine {
+
+	uint32_t VortexWorld::nextComponentType() {
+		static std::atomic<uint32_t> next{ 0 };
+		return next++;
+	}
+
+	VortexEntity VortexWorld::createEntity() {
+		uint32_t index;
+		if (!freeIndices.empty()) {
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else {
+			index = static_cast<uint32_t>(generations.size());
+			generations.push_back(0);
+			alive.push_back(0);
+		}
+
+		alive[index] = 1;
+		entityCount++;
+		return VortexEntity{ index, generations[index] };
+	}
+
+	void VortexWorld::destroyEntity(VortexEntity entity) {
+		if (!isAlive(entity)) {
+			return;
+		}
+
+		for (auto& pool : pools) {
+			if (pool) {
+				pool->remove(entity.index);
+			}
+		}
+
+		// outstanding handles to this entity stop matching
+		generations[entity.index]++;
+		alive[entity.index] = 0;
+		freeIndices.push_back(entity.index);
+		entityCount--;
+	}
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "vortex_pipeline.h"
+#include "vortex_pipeline_registry.h"
+#include "vortex_device.h"
+#include "vortex_components.h"
+#include "vortex_world.h"
+#include "vortex_frame_info.h"
+#include "vortex_buffer.h"
+#include "vortex_descriptors.h"
+#include "vortex_transform_store.h"
+#include "vortex_bindless_table.h"
+#include "vortex_bindless_materials.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace VortexEngine {
+	// GPU driven alternative to RenderSystem. Object transforms and bounds live in a storage buffer;
+	// each frame a compute pass culls them against the camera frustum and writes one
+	// VkDrawIndexedIndirectCommand per model, which the graphics pass consumes with
+	// vkCmdDrawIndexedIndirect. Steady state CPU cost per frame depends on the number of models and
+	// geometry pages, not on the number of objects.
+	//
+	// Only indexed models are drawn. Material variants (see MaterialComponent) are the same
+	// default.frag pipelines RenderSystem uses: one draw per variant, opacity and model, one bind per
+	// variant, variants other than the default compiled in the background and drawn with the
+	// default one until then. Requires drawIndirectFirstInstance, see isSupported().
+	//
+	// With a bindlessTable, default.frag reads materials the same way as RenderSystem's bindless
+	// mode, from a per frame storage buffer registered in it (set 2) through a per object index,
+	// and objects differing only in opacity or texture share draws.
+	class IndirectRenderSystem {
+	public:
+		IndirectRenderSystem(VortexDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+			VortexPipelineRegistry& pipelines, VortexBindlessTable* bindlessTable = nullptr);
+		~IndirectRenderSystem();
+
+		IndirectRenderSystem(const IndirectRenderSystem&) = delete;
+		IndirectRenderSystem& operator=(const IndirectRenderSystem&) = delete;
+
+		static bool isSupported(VortexDevice& device);
+
+		// Snapshots the entities that have a TransformComponent and a ModelComponent, with their world
+		// matrices taken from transforms (indexed by entity index, already synced with world). Call
+		// again whenever entities or their models change; each frame slot re-uploads the snapshot
+		// the next time it is used.
+		void setEntities(VortexWorld& world, const VortexTransformStore& transforms);
+		// Copies the world matrices of transforms.getUpdatedIndices() into the snapshot. Each frame
+		// slot then uploads only those objects, so moving objects cost per changed object rather
+		// than a full rebuild.
+		void updateTransforms(const VortexTransformStore& transforms);
+
+		// Records the culling pass. Must be called outside a render pass, before render(), and
+		// setEntities must not be called in between.
+		void cull(FrameInfo& frameInfo);
+		void render(FrameInfo& frameInfo);
+
+		uint32_t getObjectCount() const { return static_cast<uint32_t>(objects.size()); }
+		uint32_t getDrawCount() const { return static_cast<uint32_t>(drawTemplates.size()); }
+		bool isBindless() const { return bindlessTable != nullptr; }
+
+	private:
+		struct ObjectData {
+			glm::mat4 modelMatrix{ 1.0f };
+			glm::mat4 normalMatrix{ 1.0f };
+			glm::vec4 boundingSphere{ 0.0f };
+			uint32_t drawIndex = 0;
+			// bindless mode: element of the frame's BindlessMaterialData buffer
+			uint32_t materialIndex = 0;
+			uint32_t padding[2]{};
+		};
+
+		// consecutive draws of one variant and opacity (always 1 in bindless mode) that share geometry pool pages, drawn with
+		// one indirect call
+		struct DrawBatch {
+			uint32_t variant;
+			float opacity;
+			VortexModel* model;
+			uint32_t firstDraw;
+			uint32_t drawCount;
+		};
+
+		struct FrameResources {
+			std::unique_ptr<VortexBuffer> objectBuffer;
+			std::unique_ptr<VortexBuffer> templateBuffer;
+			std::unique_ptr<VortexBuffer> drawBuffer;
+			std::unique_ptr<VortexBuffer> instanceBuffer;
+			// transient, valid for the frame being recorded
+			VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+			VkDescriptorSet objectDescriptorSet = VK_NULL_HANDLE;
+			// bindless mode: bindless storage buffer index of the snapshot's materials
+			uint32_t materialBuffer = 0;
+			uint64_t sceneVersion = 0;
+			// objects whose transform changed since the slot's last upload
+			std::vector<uint32_t> dirtyObjects{};
+			std::vector<uint8_t> objectDirty{};
+			// keeps the models of the uploaded snapshot alive while this frame may still draw them
+			std::vector<std::shared_ptr<VortexModel>> models{};
+		};
+
+		void createPipelineLayouts(VkDescriptorSetLayout globalSetLayout, VortexPipelineRegistry& pipelines);
+		void createPipelines(VkRenderPass renderPass, VortexPipelineRegistry& pipelines);
+		void prepareFrame(FrameResources& frame, int frameIndex);
+		void uploadDirtyObjects(FrameResources& frame);
+		// Allocates the frame's sets from frameInfo.descriptorAllocator and points them at its buffers
+		void writeDescriptorSets(FrameResources& frame, FrameInfo& frameInfo);
+		std::unique_ptr<VortexBuffer> createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags extraUsage);
+		// The pipeline to draw variant with this frame, requesting its compile on first use
+		VortexPipeline* getVariantPipeline(uint32_t variant);
+
+		VortexDevice& vortexDevice;
+		VortexPipelineRegistry& pipelineRegistry;
+		// null without bindless mode
+		VortexBindlessTable* bindlessTable;
+		std::unique_ptr<VortexBindlessMaterials> bindlessMaterials;
+		const char* fragShaderPath;
+
+		// shared through the pipeline registry
+		std::shared_ptr<VortexDescriptorSetLayout> cullSetLayout;
+		std::shared_ptr<VortexDescriptorSetLayout> objectSetLayout;
+
+		// layouts are owned by the pipeline registry
+		VkPipelineLayout cullPipelineLayout;
+		VkPipelineLayout pipelineLayout;
+		std::shared_ptr<VortexComputePipeline> cullPipeline;
+		// the default variant, compiled up front and the fallback of every other one
+		std::shared_ptr<VortexPipeline> vortexPipeline;
+		PipelineConfigInfo pipelineConfig{};
+		uint32_t defaultVariant = 0;
+		std::unordered_map<uint32_t, VortexPipelineHandle> variantPipelines{};
+
+		// CPU snapshot of the scene, rebuilt by setEntities
+		std::vector<ObjectData> objects{};
+		std::vector<VkDrawIndexedIndirectCommand> drawTemplates{};
+		std::vector<DrawBatch> drawBatches{};
+		std::vector<std::shared_ptr<VortexModel>> models{};
+		// entity index -> position in objects, NO_OBJECT for entities that are not drawn
+		static constexpr uint32_t NO_OBJECT = 0xFFFFFFFF;
+		std::vector<uint32_t> objectIndices{};
+		uint64_t sceneVersion = 1;
+
+		std::vector<FrameResources> frames{};
+	};
+}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include "vortex_game_object.h"
+#include "vortex_components.h"
 #include "vortex_window.h"
 
 namespace VortexEngine {
@@ -19,7 +19,7 @@ namespace VortexEngine {
             int lookDown = GLFW_KEY_DOWN;
         };
 
-        void moveInPlaneXZ(GLFWwindow* window, float dt, VortexGameObject& gameObject);
+        void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
         KeyMappings keys{};
         float moveSpeed{ 3.0f };
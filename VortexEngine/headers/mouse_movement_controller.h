@@ -1,13 +1,13 @@
 #pragma once
 
-#include "vortex_game_object.h"
+#include "vortex_components.h"
 #include "vortex_window.h"
 
 namespace VortexEngine {
 	class MouseMovementController {
 	public:
 		float sensitivity{ 1.4f };
-		void lookAroundInPlaneXZ(GLFWwindow* window, float dt, VortexGameObject& gameObject);
+		void lookAroundInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
 	private:
 		float rotX{};
@@ -1,34 +1,165 @@
 #pragma once
 
 #include "vortex_pipeline.h"
+#include "vortex_pipeline_registry.h"
 #include "vortex_device.h"
-#include "vortex_game_object.h"
+#include "vortex_components.h"
+#include "vortex_world.h"
 #include "vortex_camera.h"
 #include "vortex_frame_info.h"
+#include "vortex_buffer.h"
+#include "vortex_frustum.h"
+#include "vortex_bvh.h"
+#include "vortex_transform_store.h"
+#include "vortex_renderer.h"
+#include "vortex_job_system.h"
+#include "vortex_bindless_table.h"
+#include "vortex_bindless_materials.h"
 
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace VortexEngine {
 	class RenderSystem {
 
 	public:
+		// Per instance vertex input (binding 1), one entry per drawn object
+		struct InstanceData {
+			glm::mat4 modelMatrix{ 1.0f };
+			glm::mat4 normalMatrix{ 1.0f };
+			// bindless mode: element of this frame's BindlessMaterialData buffer
+			uint32_t materialIndex = 0;
 
-		RenderSystem(VortexDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+			static VkVertexInputBindingDescription getBindingDescription();
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+		};
+
+		// Counters for the most recent renderGameObjects call
+		struct CullStats {
+			uint32_t objects = 0;  // entities considered, every BVH item when one is used
+			uint32_t culled = 0;
+			uint32_t drawn = 0;
+			uint32_t drawCalls = 0;
+			// when recorded into a single command buffer
+			uint32_t pipelineBinds = 0;
+			uint32_t recordingThreads = 0;
+		};
+
+		// Culling, instance uploads and parallel recording are split across jobSystem. Pipelines and
+		// their layout come from pipelines and are shared with identical render systems. Every
+		// material variant (see MaterialComponent) is its own pipeline, compiled in the background
+		// the first time an entity needs it; until then such entities are drawn with the default
+		// variant, and nothing is drawn before that has been swapped in.
+		// With a bindlessTable, materials are read by the shaders from a per frame storage buffer
+		// registered in it (set 2, set 1 is unused) through a per instance index. Both sets are bound once per
+		// command buffer and objects differing only in opacity or texture share instanced draws.
+		RenderSystem(VortexDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout,
+			VortexPipelineRegistry& pipelines, VortexJobSystem& jobSystem, VortexBindlessTable* bindlessTable = nullptr);
 		~RenderSystem();
 
 		RenderSystem(const RenderSystem&) = delete;
 		RenderSystem& operator=(const RenderSystem&) = delete;
 
-		void renderGameObjects(FrameInfo &frameInfo, std::vector<VortexGameObject>& gameObjects);
+		// Draws the entities with a TransformComponent and a ModelComponent whose bounds intersect the
+		// camera frustum, using the world matrices of transforms (indexed by entity index, already
+		// synced with world). With a sceneBVH (ids being entity indices) only the visible subtrees
+		// are visited, otherwise every entity is tested.
+		void renderGameObjects(FrameInfo &frameInfo, VortexWorld& world, const VortexTransformStore& transforms,
+			const VortexBVH* sceneBVH = nullptr);
+		// Same culling, but the draws are split into contiguous ranges recorded into secondary
+		// command buffers by up to renderer.getWorkerCount() jobs, then executed into
+		// frameInfo.commandBuffer. The render pass must have been begun with
+		// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+		void renderGameObjectsParallel(FrameInfo& frameInfo, VortexWorld& world, const VortexTransformStore& transforms,
+			VortexRenderer& renderer, const VortexBVH* sceneBVH = nullptr);
+
+		const CullStats& getCullStats() const { return cullStats; }
+
+		// Bits of the specialization constants material selects, see makeSpecialization. Shared
+		// with IndirectRenderSystem, which draws the same variants of default.frag.
+		static uint32_t makeVariantKey(const MaterialComponent& material);
+		static ShaderSpecialization makeSpecialization(uint32_t variant);
+		bool isBindless() const { return bindlessTable != nullptr; }
 
 	private:
-		void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-		void createPipeline(VkRenderPass renderPass);
+		// One visible object. Sorted so equal variants, then opacities, then models are adjacent.
+		struct DrawItem {
+			uint32_t variant;
+			// always 1 in bindless mode, the material index carries it instead
+			float opacity;
+			VortexModel* model;
+			// bindless mode: index into bindlessMaterials
+			uint32_t material;
+			// position in candidates
+			size_t candidate;
+		};
+
+		// instanced draw of one model, instances [firstInstance, firstInstance + instanceCount)
+		struct DrawBatch {
+			VortexPipeline* pipeline;
+			float opacity;
+			VortexModel* model;
+			uint32_t firstInstance;
+			uint32_t instanceCount;
+		};
+
+		static constexpr const char* VERT_SHADER_PATH = "shaders/default.vert.spv";
+		static constexpr const char* FRAG_SHADER_PATH = "shaders/default.frag.spv";
+		// default.frag compiled with BINDLESS
+		static constexpr const char* BINDLESS_FRAG_SHADER_PATH = "shaders/default_bindless.frag.spv";
+
+		// below this many draws per thread, handing work out costs more than recording it
+		static constexpr size_t MIN_BATCHES_PER_WORKER = 64;
+		// objects per culling / instance upload job
+		static constexpr size_t CULL_GRAIN = 4096;
+
+		// Culls, fills this frame's instance buffer and builds drawBatches
+		void prepareDraws(FrameInfo& frameInfo, VortexWorld& world, const VortexTransformStore& transforms, const VortexBVH* sceneBVH);
+		// Records drawBatches [firstBatch, lastBatch). Only reads state, so several threads may
+		// record different ranges at once.
+		void recordDraws(VkCommandBuffer commandBuffer, VkDescriptorSet globalDescriptorSet, size_t firstBatch, size_t lastBatch) const;
+		void createPipeline(VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+		// Pipeline layout of the bindless shaders, checked against the global and bindless sets.
+		// Set 1 is left empty, IndirectRenderSystem puts its objects there.
+		VkPipelineLayout createBindlessPipelineLayout(VkDescriptorSetLayout globalSetLayout);
+		// The pipeline to draw variant with this frame, requesting its compile on first use
+		VortexPipeline* getVariantPipeline(uint32_t variant);
+		VortexBuffer& getInstanceBuffer(int frameIndex, size_t instanceCount);
 
 		VortexDevice& vortexDevice;
+		VortexPipelineRegistry& pipelineRegistry;
+		VortexJobSystem& jobSystem;
+		// null without bindless mode
+		VortexBindlessTable* bindlessTable;
+		std::unique_ptr<VortexBindlessMaterials> bindlessMaterials;
+		// shared through the pipeline registry
+		std::shared_ptr<VortexDescriptorSetLayout> emptySetLayout;
+		const char* fragShaderPath;
 
-		std::unique_ptr<VortexPipeline> vortexPipeline;
+		// state shared by every variant, only the specialization differs
+		PipelineConfigInfo pipelineConfig{};
+		uint32_t defaultVariant = 0;
+		std::unordered_map<uint32_t, VortexPipelineHandle> variantPipelines{};
+		// owned by the pipeline registry
 		VkPipelineLayout pipelineLayout;
+
+		// one per frame in flight, grown on demand
+		std::vector<std::unique_ptr<VortexBuffer>> instanceBuffers{};
+		// scratch space kept between frames to avoid reallocating
+		// entity indices considered for drawing, drawList refers to them by position
+		std::vector<uint32_t> candidates{};
+		std::vector<VortexModel*> candidateModels{};
+		std::vector<glm::vec4> worldSpheres{};
+		std::vector<uint8_t> visibility{};
+		std::vector<uint32_t> visibleObjects{};
+		std::vector<DrawItem> drawList{};
+		std::vector<DrawBatch> drawBatches{};
+		VkBuffer currentInstanceBuffer = VK_NULL_HANDLE;
+		// bindless mode: bindless storage buffer index of this frame's materials
+		uint32_t currentMaterialBuffer = 0;
+		std::vector<VkCommandBuffer> secondaryCommandBuffers{};
+
+		CullStats cullStats{};
 	};
 }
\ No newline at end of file
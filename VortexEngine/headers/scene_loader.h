@@ -0,0 +1,96 @@
+#pragma once
+
+#include "scene_parser.h"
+#include "vortex_mesh_cache.h"
+#include "vortex_model_registry.h"
+#include "vortex_job_system.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace VortexEngine {
+	struct SceneLoadProgress {
+		size_t modelsTotal = 0;
+		size_t modelsParsed = 0;
+		size_t modelsResident = 0;
+		size_t objectsTotal = 0;
+		size_t objectsResident = 0;
+
+		bool isComplete() const { return objectsResident == objectsTotal; }
+		float fraction() const {
+			return objectsTotal == 0 ? 1.0f : static_cast<float>(objectsResident) / static_cast<float>(objectsTotal);
+		}
+	};
+
+	// Loads the models of a scene as background jobs, one per model. Jobs only do CPU work (cache
+	// lookup, OBJ parsing, deduplication); the GPU uploads happen in uploadReady, which must be
+	// called from the thread that owns the graphics queue (normally once per frame from the render
+	// loop). Entities are created up front with only a TransformComponent and get their
+	// ModelComponent as soon as their model is resident.
+	class SceneLoader {
+	public:
+		SceneLoader(VortexDevice& device, VortexModelRegistry& registry, VortexJobSystem& jobSystem);
+		~SceneLoader();
+
+		SceneLoader(const SceneLoader&) = delete;
+		SceneLoader& operator=(const SceneLoader&) = delete;
+
+		// Parses the scene document, creates an entity per scene object in world and starts loading
+		// every referenced model that isn't already resident in the registry. The previous scene,
+		// if any, must be complete; its progress is replaced by this one's.
+		std::vector<VortexEntity> loadAsync(SceneParser& parser, VortexWorld& world);
+
+		// Uploads up to maxModels parsed models and attaches them to the entities that reference
+		// them. Entities destroyed in the meantime are skipped. Returns the number of objects that
+		// became resident. Rethrows load errors.
+		size_t uploadReady(VortexWorld& world, size_t maxModels = std::numeric_limits<size_t>::max());
+
+		// Blocks, uploading as models arrive, until every object is resident
+		void waitUntilComplete(VortexWorld& world);
+
+		SceneLoadProgress getProgress() const;
+		bool isComplete() const { return getProgress().isComplete(); }
+
+	private:
+		struct PendingModel {
+			std::string filepath{};
+			std::vector<VortexEntity> entities{};
+
+			// exactly one of these is filled in by the worker
+			std::unique_ptr<VortexMeshCache::MappedMesh> cachedMesh{};
+			VortexModel::Builder builder{};
+			std::exception_ptr error{};
+		};
+
+		void loadPendingModel(size_t index);
+		// Skips the loads that haven't started and waits for the running ones
+		void stopLoading();
+		// Forgets the previous load so the next one starts from a clean state
+		void reset();
+
+		VortexDevice& vortexDevice;
+		VortexModelRegistry& modelRegistry;
+		VortexJobSystem& jobSystem;
+
+		std::vector<std::unique_ptr<PendingModel>> pendingModels{};
+		VortexJobCounter loadCounter{};
+		std::atomic<bool> stopRequested{ false };
+
+		mutable std::mutex readyMutex;
+		std::condition_variable readyCondition;
+		std::deque<size_t> readyModels{};
+
+		size_t modelsParsed = 0;
+		size_t modelsResident = 0;
+		size_t objectsTotal = 0;
+		size_t objectsResident = 0;
+	};
+}
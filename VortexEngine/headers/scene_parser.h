@@ -6,15 +6,43 @@
 #include <filesystem>
 #include <vector>
 
-#include "vortex_game_object.h"
+#include "vortex_components.h"
+#include "vortex_world.h"
+#include "vortex_model_registry.h"
 #include "json.h"
 
 namespace VortexEngine {
+	// One gameObjects entry of a .vscn file, before any model is loaded. An entry may name itself
+	// with "name" and set "parent" to another entry's name or position in gameObjects; its
+	// transform is then relative to that entry. An optional "material" object sets "lighting"
+	// ("unlit", "lambert" or "half_lambert"), "vertexNormals", "alphaTest" and "opacity".
+	struct SceneObjectDescription {
+		static constexpr int32_t NO_PARENT = -1;
+
+		std::string file{};
+		std::string name{};
+		glm::vec3 position{};
+		glm::vec3 scale{ 1.0f, 1.0f, 1.0f };
+		glm::vec3 rotation{};
+		// position of the parent in the description list
+		int32_t parent = NO_PARENT;
+		bool hasMaterial = false;
+		MaterialComponent material{};
+	};
+
 	class SceneParser {
 	public:
 		SceneParser(std::string filePath);
 		~SceneParser();
-		std::vector<VortexGameObject> parseScene(VortexDevice& vortexDevice);
+		// Creates one entity per scene object, loading every model synchronously
+		std::vector<VortexEntity> parseScene(VortexWorld& world, VortexModelRegistry& modelRegistry);
+		std::vector<SceneObjectDescription> parseSceneDescription();
+		// Adds a ParentComponent to entities[i] for every description with a parent
+		static void applyHierarchy(const std::vector<SceneObjectDescription>& descriptions,
+			const std::vector<VortexEntity>& entities, VortexWorld& world);
+		// Adds a MaterialComponent to entities[i] for every description with a material
+		static void applyMaterials(const std::vector<SceneObjectDescription>& descriptions,
+			const std::vector<VortexEntity>& entities, VortexWorld& world);
 
 	private:
 		std::ifstream fileStream{};
@@ -22,8 +50,8 @@ namespace VortexEngine {
 		std::string fileReadContents{};
 		std::string filepath{};
 		nlohmann::json parsedJsonData{};
-		std::vector<std::shared_ptr<VortexGameObject>> currentGameObjects{};
 		void read();
 		void init();
+		MaterialComponent parseMaterial(const nlohmann::json& materialData) const;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "vortex_offset_allocator.h"
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace VortexEngine {
+
+    struct VortexMemoryBlock;
+
+    // A range of device memory handed out by VortexAllocator. Bind resources at memory + offset.
+    struct VortexAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        // Persistent mapping of this range, nullptr unless the memory is host visible
+        void* mapped = nullptr;
+
+        // allocator bookkeeping, block is nullptr for dedicated allocations
+        VortexMemoryBlock* block = nullptr;
+        VortexOffsetAllocator::Allocation range{};
+
+        bool isValid() const { return memory != VK_NULL_HANDLE; }
+    };
+
+    /*
+     * Pools device memory so resources don't each need their own vkAllocateMemory.
+     *
+     * Memory is reserved in large blocks per memory type and carved up with a TLSF offset allocator.
+     * Buffers and optimal tiling images live in separate pools whenever the device reports a
+     * bufferImageGranularity above 1, so linear and non-linear resources never share a page.
+     * Host visible blocks are mapped once for their lifetime. Requests larger than half a block get
+     * a dedicated allocation.
+     *
+     * Thread safe.
+     */
+    class VortexAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+        enum class ResourceType {
+            Buffer,  // also linear tiling images
+            Image,   // optimal tiling images
+        };
+
+        struct Stats {
+            VkDeviceSize liveBytes = 0;      // bytes handed out to resources
+            VkDeviceSize reservedBytes = 0;  // bytes allocated from the driver, blocks and dedicated
+            uint32_t blockCount = 0;
+            uint32_t dedicatedAllocationCount = 0;
+            uint32_t allocationCount = 0;
+            // 1 - largest free range / total free, across every block. 0 means all free space is contiguous.
+            float fragmentation = 0.0f;
+        };
+
+        VortexAllocator(
+            VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize preferredBlockSize = DEFAULT_BLOCK_SIZE);
+        ~VortexAllocator();
+
+        VortexAllocator(const VortexAllocator&) = delete;
+        VortexAllocator& operator=(const VortexAllocator&) = delete;
+
+        VortexAllocation allocate(
+            const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceType type);
+        // Resets allocation to an invalid state. Freeing an invalid allocation does nothing.
+        void free(VortexAllocation& allocation);
+
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        Stats getStats() const;
+
+    private:
+        struct Pool {
+            uint32_t memoryTypeIndex = 0;
+            std::vector<std::unique_ptr<VortexMemoryBlock>> blocks{};
+        };
+
+        Pool& getPool(uint32_t memoryTypeIndex, ResourceType type);
+        VkDeviceSize getBlockSize(uint32_t memoryTypeIndex) const;
+        VkDeviceMemory allocateMemory(uint32_t memoryTypeIndex, VkDeviceSize size, void** mapped);
+        void freeMemory(VkDeviceMemory memory, void* mapped);
+
+        VortexAllocation allocateDedicated(uint32_t memoryTypeIndex, VkDeviceSize size);
+        bool allocateFromBlock(
+            VortexMemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VortexAllocation& allocation);
+
+        VkDevice device;
+        VkPhysicalDeviceMemoryProperties memoryProperties{};
+        VkDeviceSize bufferImageGranularity;
+        VkDeviceSize nonCoherentAtomSize;
+        VkDeviceSize preferredBlockSize;
+
+        mutable std::mutex mutex;
+        // [memory type][resource type]
+        Pool pools[VK_MAX_MEMORY_TYPES][2];
+
+        VkDeviceSize liveBytes = 0;
+        VkDeviceSize dedicatedBytes = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        uint32_t allocationCount = 0;
+    };
+
+}  // namespace VortexEngine
@@ -2,9 +2,16 @@
 
 #include "../headers/vortex_window.h"
 #include "../headers/vortex_device.h"
-#include "../headers/vortex_game_object.h"
+#include "../headers/vortex_components.h"
+#include "../headers/vortex_world.h"
 #include "../headers/vortex_renderer.h"
 #include "../headers/vortex_descriptors.h"
+#include "../headers/vortex_model_registry.h"
+#include "../headers/vortex_pipeline_registry.h"
+#include "../headers/scene_loader.h"
+#include "../headers/vortex_bvh.h"
+#include "../headers/vortex_transform_store.h"
+#include "../headers/vortex_job_system.h"
 
 #include <memory>
 #include <vector>
@@ -16,7 +23,43 @@ namespace VortexEngine {
 		static constexpr int width = 1280;
 		static constexpr int height = 720;
 
+		enum class RenderPath {
+			// Indirect where the device supports it, Cpu otherwise
+			Automatic,
+			// GPU culling and indirect draws, see IndirectRenderSystem
+			Indirect,
+			// CPU culling and instanced draws, see RenderSystem
+			Cpu
+		};
+
+		struct Config {
+			RenderPath renderPath = RenderPath::Automatic;
+			// Cpu path: cull through sceneBVH rather than testing every entity
+			bool sceneBVH = true;
+			// Cpu path: upper bound on the jobs recording secondary command buffers, 0 picks one
+			// per job system thread. 1 records inline into the primary command buffer.
+			uint32_t recordingWorkers = 0;
+			// Renders this many frames offscreen with a fixed camera and no window, then returns
+			// from run(). 0 opens a window and runs until it is closed.
+			uint32_t headlessFrames = 0;
+			// Uploads this many small meshes without a window, reports the time and upload queue
+			// stats, then returns from run() without loading the scene. 0 runs normally.
+			uint32_t uploadBenchmarkMeshes = 0;
+
+			bool isHeadless() const { return headlessFrames > 0 || uploadBenchmarkMeshes > 0; }
+		};
+
+		// Parses the command line options into a Config, throws std::invalid_argument on unknown
+		// ones:
+		//   --render-path=automatic|indirect|cpu
+		//   --no-bvh
+		//   --recording-workers=N
+		//   --headless=FRAMES
+		//   --upload-benchmark=MESHES
+		static Config parseCommandLine(int argc, char** argv);
+
 		VortexApp();
+		explicit VortexApp(const Config& config);
 		~VortexApp();
 
 		VortexApp(const VortexApp&) = delete;
@@ -26,12 +69,41 @@ namespace VortexEngine {
 
 	private:
 		void loadGameObjects();
+		void runUploadBenchmark();
+		// Rebuilds sceneBVH from the current world space bounds of every entity with a model
+		void rebuildSceneBVH();
+		// Refits the sceneBVH items whose world matrix changed in the last transforms.sync, returns
+		// whether any did
+		bool refitSceneBVH();
+
+		Config config;
 
-		VortexWindow vortexWindow{ width, height, "Vortex Engine" };
-		VortexDevice vortexDevice{ vortexWindow };
-		VortexRenderer vortexRenderer{ vortexWindow, vortexDevice };
+		// null when headless
+		std::unique_ptr<VortexWindow> vortexWindow = config.isHeadless() ?
+			nullptr : std::make_unique<VortexWindow>(width, height, "Vortex Engine");
+		VortexDevice vortexDevice = vortexWindow ? VortexDevice{ *vortexWindow } : VortexDevice{};
+		VortexRenderer vortexRenderer = vortexWindow ?
+			VortexRenderer{ *vortexWindow, vortexDevice } :
+			VortexRenderer{ vortexDevice, VkExtent2D{ width, height } };
+		// model loading, transform updates, culling and recording all share these workers
+		VortexJobSystem jobSystem{};
+		VortexModelRegistry modelRegistry{ vortexDevice };
+		VortexPipelineRegistry pipelineRegistry{ vortexDevice, &jobSystem };
+		SceneLoader sceneLoader{ vortexDevice, modelRegistry, jobSystem };
 
-		std::unique_ptr<VortexDescriptorPool> globalPool{};
-		std::vector<VortexGameObject> gameObjects;
+		// global sets are persistent, render systems allocate transient ones per frame
+		VortexDescriptorAllocator descriptorAllocator{ vortexDevice, VortexSwapChain::MAX_FRAMES_IN_FLIGHT };
+		// long lived sets, shared whenever the same resources are bound with the same layout
+		VortexDescriptorSetCache descriptorSetCache{ vortexDevice, descriptorAllocator };
+		VortexWorld world{};
+		// world matrices of every entity, indexed by entity index
+		VortexTransformStore transforms{};
+		// ids are entity indices
+		VortexBVH sceneBVH{};
+		std::vector<VortexAABB> sceneBounds{};
+		std::vector<uint32_t> sceneEntityIndices{};
+		// entity index -> position in sceneBounds, NO_SCENE_ITEM for entities outside the BVH
+		std::vector<uint32_t> sceneItems{};
+		std::vector<uint32_t> changedSceneItems{};
 	};
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "vortex_device.h"
+#include "vortex_buffer.h"
+#include "vortex_components.h"
+#include "vortex_bindless_table.h"
+
+// std
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace VortexEngine {
+
+    // The BindlessMaterialData array shaders/default.frag with BINDLESS reads, shared by the render
+    // systems' bindless modes. Materials are collected with add, equal ones sharing an element,
+    // then upload copies them into one host visible buffer per frame in flight and registers it
+    // in the table. Not thread safe.
+    class VortexBindlessMaterials {
+    public:
+        VortexBindlessMaterials(VortexDevice& vortexDevice, VortexBindlessTable& bindlessTable);
+
+        VortexBindlessMaterials(const VortexBindlessMaterials&) = delete;
+        VortexBindlessMaterials& operator=(const VortexBindlessMaterials&) = delete;
+
+        void clear();
+        // Index of material's element, material may be null for the defaults
+        uint32_t add(const MaterialComponent* material);
+        // Copies the materials into frameIndex's buffer, whose previous submission must have
+        // completed, and returns the buffer's bindless storage buffer index
+        uint32_t upload(int frameIndex);
+
+        size_t size() const { return materials.size(); }
+
+    private:
+        VortexDevice& vortexDevice;
+        VortexBindlessTable& bindlessTable;
+
+        std::vector<BindlessMaterialData> materials{};
+        // (opacity, baseColorTexture, baseColorSampler) -> element
+        std::map<std::tuple<float, uint32_t, uint32_t>, uint32_t> indices{};
+        // one per frame in flight, grown on demand
+        std::vector<std::unique_ptr<VortexBuffer>> buffers{};
+    };
+
+}  // namespace VortexEngine
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "vortex_device.h"
+#include "vortex_descriptors.h"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace VortexEngine {
+
+    // One descriptor set with large arrays of sampled images, samplers and storage buffers, bound
+    // once per frame. Every registered resource gets a stable index into its array which shaders
+    // use directly (see shaders/default.frag with BINDLESS), so switching textures or materials
+    // needs no descriptor binds.
+    //
+    // The set is update after bind and partially bound: registering writes a single descriptor
+    // right away, even while frames using the set are in flight, and unused slots need no valid
+    // descriptor. Released indices are handed out again only MAX_FRAMES_IN_FLIGHT beginFrame calls
+    // later, once no submitted frame can still read them. Buffers, image views and samplers
+    // destroyed through the engine release themselves. Thread safe.
+    //
+    // Requires VortexDevice::isBindlessSupported().
+    class VortexBindlessTable : public VortexResourceListener {
+    public:
+        static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+        static constexpr uint32_t SAMPLED_IMAGE_BINDING = 0;
+        static constexpr uint32_t SAMPLER_BINDING = 1;
+        static constexpr uint32_t STORAGE_BUFFER_BINDING = 2;
+
+        // linear filtering, repeating, created and registered by the table
+        static constexpr uint32_t DEFAULT_SAMPLER = 0;
+
+        struct Stats {
+            uint32_t sampledImages = 0;
+            uint32_t samplers = 0;
+            uint32_t storageBuffers = 0;
+            // released, waiting for the frames that could read them
+            uint32_t pendingReleases = 0;
+        };
+
+        // Capacities are lowered to the device's update after bind limits
+        VortexBindlessTable(
+            VortexDevice& vortexDevice,
+            uint32_t maxSampledImages = 16384,
+            uint32_t maxSamplers = 64,
+            uint32_t maxStorageBuffers = 8192);
+        ~VortexBindlessTable();
+        VortexBindlessTable(const VortexBindlessTable&) = delete;
+        VortexBindlessTable& operator=(const VortexBindlessTable&) = delete;
+
+        // Registering a resource again returns the index it already has, a single release frees it.
+        // Throw std::runtime_error once the array is full.
+        uint32_t registerSampledImage(VkImageView imageView, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        uint32_t registerSampler(VkSampler sampler);
+        // the whole buffer
+        uint32_t registerStorageBuffer(VkBuffer buffer);
+
+        void releaseSampledImage(VkImageView imageView);
+        void releaseSampler(VkSampler sampler);
+        void releaseStorageBuffer(VkBuffer buffer);
+
+        // Recycles the indices released MAX_FRAMES_IN_FLIGHT frames ago. Call once per frame after
+        // VortexRenderer::beginFrame.
+        void beginFrame();
+
+        VkDescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+        VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+        // Whether a set declared by shaders with these bindings (e.g. from VortexShaderReflection)
+        // can be bound to the table's set
+        bool isCompatible(const std::vector<VkDescriptorSetLayoutBinding>& bindings) const;
+
+        Stats getStats() const;
+
+        void onBufferDestroyed(VkBuffer buffer) override;
+        void onImageViewDestroyed(VkImageView imageView) override;
+        void onSamplerDestroyed(VkSampler sampler) override;
+
+    private:
+        // one array of the set
+        struct Slots {
+            uint32_t binding;
+            VkDescriptorType descriptorType;
+            uint32_t capacity;
+            const char* name;
+
+            // resource handle -> index
+            std::unordered_map<uint64_t, uint32_t> indices{};
+            std::vector<uint32_t> freeIndices{};
+            // (frame released in, index), oldest first
+            std::deque<std::pair<uint64_t, uint32_t>> releasedIndices{};
+            // every index below this has been handed out at some point
+            uint32_t nextIndex = 0;
+        };
+
+        // Caller holds mutex. newIndex is false when handle already had one.
+        uint32_t acquire(Slots& slots, uint64_t handle, bool& newIndex);
+        void release(Slots& slots, uint64_t handle);
+        void write(const Slots& slots, uint32_t index, const VkDescriptorImageInfo* imageInfo, const VkDescriptorBufferInfo* bufferInfo);
+        void createDefaultSampler();
+
+        VortexDevice& vortexDevice;
+
+        std::unique_ptr<VortexDescriptorSetLayout> setLayout;
+        std::unique_ptr<VortexDescriptorPool> pool;
+        VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+        VkSampler defaultSampler = VK_NULL_HANDLE;
+
+        mutable std::mutex mutex;
+        Slots sampledImages;
+        Slots samplers;
+        Slots storageBuffers;
+        uint64_t frameNumber = 0;
+    };
+
+}  // namespace VortexEngine
@@ -45,8 +45,9 @@ namespace VortexEngine {
 
         VortexDevice& vortexDevice;
         void* mapped = nullptr;
+        VkDeviceSize mappedSize = 0;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VortexAllocation memory{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
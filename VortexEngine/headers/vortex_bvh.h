@@ -0,0 +1,88 @@
+#pragma once
+
+#include "vortex_frustum.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace VortexEngine {
+	/*
+	 * Bounding volume hierarchy over world space boxes, built with binned SAH.
+	 *
+	 * Items are identified by their index in the bounds array passed to build(), or by ids[i] when
+	 * build() is given ids; queries report those ids. When boxes move without the set of items
+	 * changing, refit() updates the tree in place, which is much cheaper than a rebuild but lets the
+	 * tree quality degrade as objects drift apart; rebuild once refits stop paying off.
+	 */
+	class VortexBVH {
+	public:
+		static constexpr uint32_t MAX_LEAF_ITEMS = 4;
+
+		struct RayHit {
+			uint32_t item = std::numeric_limits<uint32_t>::max();
+			// distance along the ray to where it enters the item's box
+			float distance = std::numeric_limits<float>::max();
+
+			bool isValid() const { return item != std::numeric_limits<uint32_t>::max(); }
+		};
+
+		void build(const std::vector<VortexAABB>& bounds, const std::vector<uint32_t>& ids = {});
+		void clear();
+
+		// Refits every node to bounds, which must have as many boxes as the tree was built with
+		void refit(const std::vector<VortexAABB>& bounds);
+		// Refits only the leaves holding changedItems (positions in bounds, not ids) and their ancestors
+		void refit(const std::vector<VortexAABB>& bounds, const std::vector<uint32_t>& changedItems);
+
+		// The query functions append to results without clearing it
+		void queryFrustum(const VortexFrustum& frustum, std::vector<uint32_t>& results) const;
+		void queryOverlap(const VortexAABB& box, std::vector<uint32_t>& results) const;
+		// Closest item box hit by the ray within maxDistance. direction need not be normalized,
+		// distances are then in units of its length.
+		RayHit raycast(
+			const glm::vec3& origin,
+			const glm::vec3& direction,
+			float maxDistance = std::numeric_limits<float>::max()) const;
+
+		bool isEmpty() const { return nodes.empty(); }
+		uint32_t getItemCount() const { return static_cast<uint32_t>(items.size()); }
+		uint32_t getNodeCount() const { return static_cast<uint32_t>(nodes.size()); }
+		const VortexAABB& getBounds() const { return nodes[0].bounds; }
+
+	private:
+		struct Node {
+			VortexAABB bounds{};
+			// left child, the right child is left + 1. 0 for leaves since the root is never a child.
+			uint32_t left = 0;
+			// every node's subtree owns a contiguous run of items
+			uint32_t firstItem = 0;
+			uint32_t itemCount = 0;
+			uint32_t parent = std::numeric_limits<uint32_t>::max();
+
+			bool isLeaf() const { return left == 0; }
+		};
+
+		void split(uint32_t nodeIndex, uint32_t depth, std::vector<std::pair<uint32_t, uint32_t>>& pending);
+		void refitNode(uint32_t nodeIndex);
+		uint32_t getItemId(uint32_t item) const { return itemIds.empty() ? item : itemIds[item]; }
+
+		// children are always stored after their parent, so a reverse walk visits them first
+		std::vector<Node> nodes{};
+		// item indices, grouped by leaf
+		std::vector<uint32_t> items{};
+		// world space box of each item, by item index
+		std::vector<VortexAABB> itemBounds{};
+		// leaf node holding each item
+		std::vector<uint32_t> itemLeaves{};
+		// id reported for each item, empty when items are their own ids
+		std::vector<uint32_t> itemIds{};
+		// build scratch
+		std::vector<glm::vec3> centroids{};
+	};
+}
@@ -4,6 +4,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include <array>
+
 namespace VortexEngine {
 	class VortexCamera {
 	public:
@@ -23,6 +25,9 @@ namespace VortexEngine {
 			return viewMatrix;
 		}
 
+		// World space planes (xyz = inward normal, w = distance) in left, right, bottom, top, near, far order
+		std::array<glm::vec4, 6> getFrustumPlanes() const;
+
 	private:
 		glm::mat4 projectionMatrix{ 1.0f };
 		glm::mat4 viewMatrix{ 1.0f };
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "vortex_model.h"
+#include "vortex_world.h"
+
+//libs
+#include <glm/gtc/matrix_transform.hpp>
+//std includes
+#include <cstdint>
+#include <memory>
+
+namespace VortexEngine {
+
+	// Plain data components for VortexWorld entities
+
+	struct TransformComponent {
+		glm::vec3 translation{};
+		glm::vec3 scale{1.0f, 1.0f, 1.0f};
+		glm::vec3 rotation{};
+
+		glm::mat4 mat4();
+		glm::mat3 normalMatrix();
+	};
+
+	// Makes the entity's TransformComponent relative to the parent's world transform
+	struct ParentComponent {
+		VortexEntity parent{};
+	};
+
+	struct ModelComponent {
+		std::shared_ptr<VortexModel> model{};
+	};
+
+	struct ColorComponent {
+		glm::vec3 color{};
+	};
+
+	// Values match LIGHTING_MODEL in shaders/default.frag
+	enum class LightingModel : uint32_t {
+		Unlit = 0,
+		Lambert = 1,
+		HalfLambert = 2
+	};
+
+	// Shading options of an entity. lighting, vertexNormals and alphaTest select a pipeline variant
+	// (specialization constants in shaders/default.frag), so changing them switches pipelines
+	// rather than branching on the GPU. Entities without one use the defaults.
+	struct MaterialComponent {
+		LightingModel lighting = LightingModel::Lambert;
+		// false shades flat with the face normal
+		bool vertexNormals = true;
+		// discards 1 - opacity of the surface in an ordered dither pattern
+		bool alphaTest = false;
+		float opacity = 1.0f;
+
+		// The opacity shaded with, 1 unless alpha tested so it doesn't split batches
+		float getDrawOpacity() const { return alphaTest ? opacity : 1.0f; }
+
+		static constexpr uint32_t NO_TEXTURE = 0xFFFFFFFF;
+		// Bindless mode only (see VortexBindlessTable): indices of a sampled image and a sampler
+		// the base color is multiplied with. Sampler 0 is the table's default sampler.
+		uint32_t baseColorTexture = NO_TEXTURE;
+		uint32_t baseColorSampler = 0;
+	};
+
+	// Fragment stage push constants of shaders/default.frag
+	struct MaterialPushConstants {
+		float opacity = 1.0f;
+	};
+
+	// One element of the material storage buffer shaders/default.frag reads when compiled with
+	// BINDLESS (std430), selected by the per instance material index
+	struct BindlessMaterialData {
+		float opacity = 1.0f;
+		uint32_t baseColorTexture = MaterialComponent::NO_TEXTURE;
+		uint32_t baseColorSampler = 0;
+		uint32_t padding = 0;
+	};
+
+	// Fragment stage push constants of shaders/default.frag with BINDLESS
+	struct BindlessPushConstants {
+		// bindless storage buffer index of this frame's BindlessMaterialData array
+		uint32_t materialBuffer = 0;
+	};
+}
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 // std
 #include <memory>
+#include <mutex>
 #include <unordered_map>
 #include <vector>
 
@@ -15,20 +16,28 @@ namespace VortexEngine {
         public:
             Builder(VortexDevice& vortexDevice) : vortexDevice{ vortexDevice } {}
 
+            // bindingFlags other than 0 need descriptor indexing, see VortexDevice::isBindlessSupported
             Builder& addBinding(
                 uint32_t binding,
                 VkDescriptorType descriptorType,
                 VkShaderStageFlags stageFlags,
-                uint32_t count = 1);
+                uint32_t count = 1,
+                VkDescriptorBindingFlags bindingFlags = 0);
+            Builder& setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
             std::unique_ptr<VortexDescriptorSetLayout> build() const;
 
         private:
             VortexDevice& vortexDevice;
             std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags> bindingFlags{};
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
         };
 
         VortexDescriptorSetLayout(
-            VortexDevice& vortexDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+            VortexDevice& vortexDevice,
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+            const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {},
+            VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
         ~VortexDescriptorSetLayout();
         VortexDescriptorSetLayout(const VortexDescriptorSetLayout&) = delete;
         VortexDescriptorSetLayout& operator=(const VortexDescriptorSetLayout&) = delete;
@@ -72,6 +81,9 @@ namespace VortexEngine {
 
         bool allocateDescriptorSet(
             const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
+        // Same, but returns the result so a full pool can be told apart from other failures
+        VkResult tryAllocateDescriptorSet(
+            const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
 
         void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
 
@@ -84,19 +96,133 @@ namespace VortexEngine {
         friend class VortexDescriptorWriter;
     };
 
+    // Descriptor sets from a list of pools that grows whenever the current pool is full.
+    // Transient sets come from the pools of one frame in flight and are all released at once by
+    // beginFrame, so they cost an allocation from an already reset pool. Persistent sets come from
+    // pools that are never reset. Thread safe.
+    class VortexDescriptorAllocator {
+    public:
+        // Descriptors of a type a pool holds per set it can allocate
+        struct PoolSizeRatio {
+            VkDescriptorType descriptorType;
+            float ratio;
+        };
+
+        VortexDescriptorAllocator(
+            VortexDevice& vortexDevice,
+            uint32_t frameCount,
+            std::vector<PoolSizeRatio> poolSizeRatios = getDefaultPoolSizeRatios(),
+            uint32_t initialSetsPerPool = 64);
+        VortexDescriptorAllocator(const VortexDescriptorAllocator&) = delete;
+        VortexDescriptorAllocator& operator=(const VortexDescriptorAllocator&) = delete;
+
+        // Resets the pools of frameIndex, releasing its transient sets. Only call once the frame's
+        // previous submission has finished, e.g. right after VortexRenderer::beginFrame.
+        void beginFrame(int frameIndex);
+        // Valid until beginFrame is called for frameIndex again
+        VkDescriptorSet allocateTransient(int frameIndex, VkDescriptorSetLayout descriptorSetLayout);
+        // Valid until the allocator is destroyed
+        VkDescriptorSet allocatePersistent(VkDescriptorSetLayout descriptorSetLayout);
+
+        size_t getPoolCount() const;
+
+        static std::vector<PoolSizeRatio> getDefaultPoolSizeRatios();
+
+    private:
+        // every pool doubles the sets of the previous one up to this
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        struct PoolList {
+            std::vector<std::unique_ptr<VortexDescriptorPool>> pools{};
+            // the pools before this one ran out of space since the last reset
+            size_t activePool = 0;
+        };
+
+        VkDescriptorSet allocate(PoolList& poolList, VkDescriptorSetLayout descriptorSetLayout);
+        std::unique_ptr<VortexDescriptorPool> createPool();
+
+        VortexDevice& vortexDevice;
+        std::vector<PoolSizeRatio> poolSizeRatios;
+        uint32_t setsPerPool;
+
+        mutable std::mutex mutex;
+        std::vector<PoolList> framePools;
+        PoolList persistentPools{};
+    };
+
+    class VortexDescriptorWriter;
+
+    // Persistent descriptor sets keyed by their layout and every buffer / image written to them.
+    // A hit returns the existing set, skipping the allocation and vkUpdateDescriptorSets. When a
+    // resource a set references is destroyed the set is dropped and recycled for the next miss
+    // with the same layout; the resource's destruction already implies the GPU is done with it.
+    class VortexDescriptorSetCache : public VortexResourceListener {
+    public:
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            size_t sets = 0;
+            size_t freeSets = 0;
+        };
+
+        VortexDescriptorSetCache(VortexDevice& vortexDevice, VortexDescriptorAllocator& allocator);
+        ~VortexDescriptorSetCache();
+        VortexDescriptorSetCache(const VortexDescriptorSetCache&) = delete;
+        VortexDescriptorSetCache& operator=(const VortexDescriptorSetCache&) = delete;
+
+        // The set writer describes, written only if no identical one exists
+        VkDescriptorSet getDescriptorSet(VortexDescriptorWriter& writer);
+
+        void onBufferDestroyed(VkBuffer buffer) override;
+        void onImageViewDestroyed(VkImageView imageView) override;
+        void onSamplerDestroyed(VkSampler sampler) override;
+
+        Stats getStats() const;
+
+    private:
+        struct CachedSet {
+            VkDescriptorSet descriptorSet;
+            VkDescriptorSetLayout layout;
+            // layout, then per write its binding, type and resource handles, compared on hits
+            std::vector<uint64_t> signature;
+            // distinct buffer, image view and sampler handles, their setsByResource entries
+            std::vector<uint64_t> resources;
+        };
+
+        // Drops every set referencing resource, caller holds mutex
+        void invalidate(uint64_t resource);
+
+        VortexDevice& vortexDevice;
+        VortexDescriptorAllocator& allocator;
+
+        mutable std::mutex mutex;
+        std::unordered_map<uint64_t, CachedSet> cachedSets{};
+        // resource handle -> keys of the sets referencing it
+        std::unordered_multimap<uint64_t, uint64_t> setsByResource{};
+        std::unordered_map<VkDescriptorSetLayout, std::vector<VkDescriptorSet>> freeSets{};
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
     class VortexDescriptorWriter {
     public:
         VortexDescriptorWriter(VortexDescriptorSetLayout& setLayout, VortexDescriptorPool& pool);
+        // Without a pool only overwrite is available, e.g. for sets from VortexDescriptorAllocator
+        explicit VortexDescriptorWriter(VortexDescriptorSetLayout& setLayout);
 
         VortexDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         VortexDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
 
         bool build(VkDescriptorSet& set);
+        // Reuses an identical set from cache when there is one
+        VkDescriptorSet build(VortexDescriptorSetCache& cache);
         void overwrite(VkDescriptorSet& set);
 
     private:
+        friend class VortexDescriptorSetCache;
+
         VortexDescriptorSetLayout& setLayout;
-        VortexDescriptorPool& pool;
+        VortexDescriptorPool* pool = nullptr;
         std::vector<VkWriteDescriptorSet> writes;
     };
 
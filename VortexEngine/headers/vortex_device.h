@@ -1,13 +1,19 @@
 #pragma once
 
+#include "vortex_allocator.h"
 #include "vortex_window.h"
 
 // std lib headers
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace VortexEngine {
 
+    class VortexGeometryPool;
+    class VortexUploadQueue;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
@@ -22,6 +28,24 @@ namespace VortexEngine {
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
+    // Told about engine owned buffers, image views and samplers just before they are destroyed, so
+    // caches holding their handles (e.g. VortexDescriptorSetCache) can drop them before a new
+    // resource reuses the handle
+    class VortexResourceListener {
+    public:
+        virtual ~VortexResourceListener() = default;
+        virtual void onBufferDestroyed(VkBuffer buffer) = 0;
+        virtual void onImageViewDestroyed(VkImageView imageView) = 0;
+        virtual void onSamplerDestroyed(VkSampler sampler) = 0;
+    };
+
+    // A Vulkan handle as a key for the caches above
+    template<typename Handle>
+    uint64_t handleKey(Handle handle) {
+        // non-dispatchable handles are pointers or 64 bit integers depending on the platform
+        return (uint64_t)(handle);
+    }
+
     class VortexDevice {
     public:
 #ifdef NDEBUG
@@ -29,8 +53,11 @@ namespace VortexEngine {
 #else
         const bool enableValidationLayers = true;
 #endif
+        static constexpr const char* PIPELINE_CACHE_PATH = "cache/pipelines.bin";
 
         VortexDevice(VortexWindow& window);
+        // Headless device: no window, surface or swap chain extension. Used for offscreen rendering.
+        VortexDevice();
         ~VortexDevice();
 
         // Not copyable or movable
@@ -44,6 +71,34 @@ namespace VortexEngine {
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        bool isHeadless() const { return window == nullptr; }
+        // Descriptor indexing with update after bind (also while pending), partially bound and
+        // non-uniformly indexed runtime arrays of sampled images and storage buffers, as
+        // VortexBindlessTable needs.
+        // Enabled whenever the GPU supports it.
+        bool isBindlessSupported() const { return bindlessSupported; }
+        // Batched staging uploads, shared by everything that copies data to device local memory
+        VortexUploadQueue& uploadQueue() { return *uploadQueue_; }
+        // Pooled device memory, every buffer and image created through this device comes from here
+        VortexAllocator& allocator() { return *allocator_; }
+        // Shared vertex / index pages that every VortexModel sub-allocates from
+        VortexGeometryPool& geometryPool() { return *geometryPool_; }
+        // Shared by every pipeline created on this device. Loaded from PIPELINE_CACHE_PATH when the
+        // file was written by the same driver and GPU, saved back when the device is destroyed.
+        VkPipelineCache pipelineCache() { return pipelineCache_; }
+        // Whether pipelineCache() started from a valid file rather than empty
+        bool isPipelineCacheWarm() const { return pipelineCacheWarm; }
+        // Writes pipelineCache() to PIPELINE_CACHE_PATH. Failing to save is not fatal, so this
+        // returns false instead of throwing.
+        bool savePipelineCache();
+
+        // Listeners must be removed before they are destroyed. Notifications may come from any
+        // thread that destroys a resource.
+        void addResourceListener(VortexResourceListener* listener);
+        void removeResourceListener(VortexResourceListener* listener);
+        void notifyBufferDestroyed(VkBuffer buffer);
+        void notifyImageViewDestroyed(VkImageView imageView);
+        void notifySamplerDestroyed(VkSampler sampler);
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -57,50 +112,68 @@ namespace VortexEngine {
             VkBufferUsageFlags usage,
             VkMemoryPropertyFlags properties,
             VkBuffer& buffer,
-            VkDeviceMemory& bufferMemory);
+            VortexAllocation& bufferMemory);
+        // Blocks until the commands have run, for one-off setup work. Buffer and image uploads go
+        // through uploadQueue() instead.
         VkCommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(VkCommandBuffer commandBuffer);
-        void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-        void copyBufferToImage(
-            VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
         void createImageWithInfo(
             const VkImageCreateInfo& imageInfo,
             VkMemoryPropertyFlags properties,
             VkImage& image,
-            VkDeviceMemory& imageMemory);
+            VortexAllocation& imageMemory);
 
         VkPhysicalDeviceProperties properties;
+        VkPhysicalDeviceFeatures enabledFeatures{};
+        // only filled in when isBindlessSupported()
+        VkPhysicalDeviceDescriptorIndexingProperties descriptorIndexingProperties{};
 
     private:
+        void init();
         void createInstance();
         void setupDebugMessenger();
         void createSurface();
         void pickPhysicalDevice();
         void createLogicalDevice();
         void createCommandPool();
+        void createPipelineCache();
+        // Whether data starts with a pipeline cache header matching this device
+        bool isPipelineCacheCompatible(const std::vector<char>& data) const;
 
         // helper functions
         bool isDeviceSuitable(VkPhysicalDevice device);
         std::vector<const char*> getRequiredExtensions();
+        std::vector<const char*> getRequiredDeviceExtensions();
         bool checkValidationLayerSupport();
         QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool isDeviceExtensionAvailable(VkPhysicalDevice device, const char* extensionName);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
         VkInstance instance;
         VkDebugUtilsMessengerEXT debugMessenger;
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-        VortexWindow& window;
+        VortexWindow* window = nullptr;
         VkCommandPool commandPool;
+        VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+        bool pipelineCacheWarm = false;
+        bool bindlessSupported = false;
+
+        std::mutex resourceListenerMutex;
+        std::vector<VortexResourceListener*> resourceListeners{};
 
         VkDevice device_;
-        VkSurfaceKHR surface_;
+        VkSurfaceKHR surface_ = VK_NULL_HANDLE;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
 
+        std::unique_ptr<VortexAllocator> allocator_;
+        std::unique_ptr<VortexUploadQueue> uploadQueue_;
+        std::unique_ptr<VortexGeometryPool> geometryPool_;
+
         const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
         const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
     };
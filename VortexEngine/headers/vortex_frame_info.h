@@ -1,6 +1,7 @@
 #pragma once
 
 #include "vortex_camera.h"
+#include "vortex_descriptors.h"
 #include <vulkan/vulkan.h>
 
 namespace VortexEngine {
@@ -10,5 +11,9 @@ namespace VortexEngine {
 		VkCommandBuffer commandBuffer;
 		VortexCamera& camera;
 		VkDescriptorSet globalDescriptorSet;
+		// allocateTransient(frameIndex, ...) gives sets that only live for this frame
+		VortexDescriptorAllocator& descriptorAllocator;
+		// persistent sets, deduplicated by layout and resources
+		VortexDescriptorSetCache& descriptorSetCache;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace VortexEngine {
+	struct VortexAABB {
+		glm::vec3 min{ 0.0f };
+		glm::vec3 max{ 0.0f };
+
+		glm::vec3 center() const { return (min + max) * 0.5f; }
+		glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+		float surfaceArea() const {
+			glm::vec3 size = max - min;
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+
+		bool overlaps(const VortexAABB& other) const {
+			return glm::all(glm::lessThanEqual(min, other.max)) && glm::all(glm::lessThanEqual(other.min, max));
+		}
+
+		void expand(const VortexAABB& other) {
+			min = glm::min(min, other.min);
+			max = glm::max(max, other.max);
+		}
+
+		static VortexAABB empty() {
+			return VortexAABB{ glm::vec3{ std::numeric_limits<float>::max() }, glm::vec3{ std::numeric_limits<float>::lowest() } };
+		}
+
+		// Box around this box after transformation, not the tightest fit for rotations
+		VortexAABB transformed(const glm::mat4& transform) const;
+	};
+
+	// Sphere (xyz = center, w = radius) enclosing a model space sphere after transformation
+	glm::vec4 transformSphere(const glm::vec4& sphere, const glm::mat4& transform);
+
+	class VortexFrustum {
+	public:
+		VortexFrustum() = default;
+		// Planes as returned by VortexCamera::getFrustumPlanes, normals pointing inward
+		explicit VortexFrustum(const std::array<glm::vec4, 6>& planes);
+
+		bool intersectsSphere(const glm::vec4& sphere) const;
+		bool intersectsAABB(const VortexAABB& box) const;
+		// True if the box lies entirely inside every plane
+		bool containsAABB(const VortexAABB& box) const;
+
+		// Tests count world space spheres, writing 1 to visible[i] if sphere i touches the frustum
+		// and 0 otherwise. Four spheres are tested at a time with SSE where it is available.
+		// Returns the number of visible spheres.
+		size_t cullSpheres(const glm::vec4* spheres, size_t count, uint8_t* visible) const;
+
+	private:
+		std::array<glm::vec4, 6> planes{};
+	};
+}
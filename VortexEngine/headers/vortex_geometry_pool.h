@@ -0,0 +1,110 @@
+#pragma once
+
+#include "vortex_buffer.h"
+#include "vortex_device.h"
+#include "vortex_offset_allocator.h"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace VortexEngine {
+
+    /*
+     * Shared vertex and index storage for every model.
+     *
+     * Geometry lives in a handful of large device local buffers ("pages"). Models sub-allocate
+     * element ranges and draw with firstIndex / vertexOffset, so consecutive draws from the same
+     * page need no rebinding. Ranges are counted in elements, not bytes, which keeps the offsets
+     * usable directly as draw parameters.
+     *
+     * A mesh larger than a page gets a page of its own.
+     *
+     * Freed ranges may still be read by frames in flight, so they are only handed out again
+     * MAX_FRAMES_IN_FLIGHT beginFrame calls later.
+     */
+    class VortexGeometryPool {
+    public:
+        static constexpr uint32_t DEFAULT_VERTICES_PER_PAGE = 1 << 20;
+        static constexpr uint32_t DEFAULT_INDICES_PER_PAGE = 1 << 22;
+
+        struct Range {
+            uint32_t page = 0;
+            uint32_t first = 0;
+            uint32_t count = 0;
+            VortexOffsetAllocator::Allocation allocation{};
+
+            bool isValid() const { return allocation.isValid(); }
+        };
+
+        struct Stats {
+            uint32_t vertexPages = 0;
+            uint32_t indexPages = 0;
+            uint64_t verticesUsed = 0;
+            uint64_t vertexCapacity = 0;
+            uint64_t indicesUsed = 0;
+            uint64_t indexCapacity = 0;
+        };
+
+        VortexGeometryPool(
+            VortexDevice& device,
+            uint32_t vertexStride,
+            uint32_t verticesPerPage = DEFAULT_VERTICES_PER_PAGE,
+            uint32_t indicesPerPage = DEFAULT_INDICES_PER_PAGE);
+        ~VortexGeometryPool();
+
+        VortexGeometryPool(const VortexGeometryPool&) = delete;
+        VortexGeometryPool& operator=(const VortexGeometryPool&) = delete;
+
+        // The data is uploaded through the device upload queue
+        Range allocateVertices(const void* vertices, uint32_t count);
+        Range allocateIndices(const uint32_t* indices, uint32_t count);
+        void freeVertices(Range& range);
+        void freeIndices(Range& range);
+
+        // Reuses the ranges freed MAX_FRAMES_IN_FLIGHT frames ago. VortexRenderer::beginFrame calls
+        // it once the frame's previous submission has finished.
+        void beginFrame();
+
+        void bindVertexPage(VkCommandBuffer commandBuffer, uint32_t page);
+        void bindIndexPage(VkCommandBuffer commandBuffer, uint32_t page);
+
+        VkBuffer getVertexBuffer(uint32_t page) const { return vertexArena.pages[page].buffer->getBuffer(); }
+        VkBuffer getIndexBuffer(uint32_t page) const { return indexArena.pages[page].buffer->getBuffer(); }
+        uint32_t getVertexStride() const { return vertexArena.elementSize; }
+        Stats getStats() const;
+
+    private:
+        struct Page {
+            std::unique_ptr<VortexBuffer> buffer;
+            VortexOffsetAllocator ranges;
+        };
+
+        struct Arena {
+            uint32_t elementSize;
+            uint32_t elementsPerPage;
+            VkBufferUsageFlags usage;
+            std::vector<Page> pages{};
+        };
+
+        struct ReleasedRange {
+            uint64_t frame;
+            Arena* arena;
+            Range range;
+        };
+
+        Range allocate(Arena& arena, const void* data, uint32_t count);
+        void free(Arena& arena, Range& range);
+
+        VortexDevice& vortexDevice;
+        Arena vertexArena;
+        Arena indexArena;
+
+        // oldest first
+        std::deque<ReleasedRange> releasedRanges{};
+        uint64_t frameNumber = 0;
+    };
+
+}  // namespace VortexEngine
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VortexEngine {
+	// Number of unfinished jobs started with this counter. Must outlive those jobs.
+	class VortexJobCounter {
+	public:
+		bool isDone() const { return pending.load(std::memory_order_acquire) == 0; }
+
+	private:
+		friend class VortexJobSystem;
+		std::atomic<uint32_t> pending{ 0 };
+	};
+
+	/*
+	 * Work stealing job scheduler.
+	 *
+	 * Every worker thread owns a deque: it pushes and pops its own jobs at the back, so related
+	 * work stays on one core, and idle workers steal from the front of the others. Jobs queued from
+	 * outside the pool go to a shared deque that everyone steals from. A thread waiting on a
+	 * counter keeps running queued jobs instead of blocking, so jobs may wait on other jobs.
+	 *
+	 * Background jobs (file IO, parsing) live in a separate queue that only idle workers take, so a
+	 * frame waiting on its own jobs never picks up a job that runs for hundreds of milliseconds.
+	 * High priority background jobs (pipeline compiles) are taken before any normal one, so they
+	 * don't wait behind a whole scene load.
+	 *
+	 * Jobs must not throw; catch inside the job and hand the error back to the owner.
+	 */
+	class VortexJobSystem {
+	public:
+		using Job = std::function<void()>;
+
+		enum class Priority {
+			Normal,
+			High
+		};
+
+		// workerCount == 0 starts one worker per spare hardware thread, at least one
+		explicit VortexJobSystem(uint32_t workerCount = 0);
+		// Jobs still queued are dropped; owners wait on their counters first
+		~VortexJobSystem();
+
+		VortexJobSystem(const VortexJobSystem&) = delete;
+		VortexJobSystem& operator=(const VortexJobSystem&) = delete;
+
+		uint32_t getWorkerCount() const { return static_cast<uint32_t>(workers.size()); }
+
+		// Queues job. counter, if given, is not done until job has finished; a job with a dependency
+		// only starts once the dependency counter is done.
+		void run(Job job, VortexJobCounter* counter = nullptr, const VortexJobCounter* dependency = nullptr);
+		void runBackground(Job job, VortexJobCounter* counter = nullptr, Priority priority = Priority::Normal);
+
+		// Runs queued jobs on the calling thread until counter is done
+		void wait(const VortexJobCounter& counter);
+
+		// Calls fn(begin, end) for chunks of at most grainSize covering [0, count), the calling thread
+		// taking the first one, and returns once every chunk has run
+		template<typename Fn>
+		void parallelFor(size_t count, size_t grainSize, Fn&& fn) {
+			grainSize = std::max<size_t>(grainSize, 1);
+			if (count <= grainSize || workers.empty()) {
+				if (count > 0) {
+					fn(size_t{ 0 }, count);
+				}
+				return;
+			}
+
+			VortexJobCounter counter;
+			for (size_t begin = grainSize; begin < count; begin += grainSize) {
+				size_t end = std::min(begin + grainSize, count);
+				run([&fn, begin, end]() { fn(begin, end); }, &counter);
+			}
+			fn(size_t{ 0 }, grainSize);
+			wait(counter);
+		}
+
+	private:
+		struct QueuedJob {
+			Job job{};
+			VortexJobCounter* counter = nullptr;
+			const VortexJobCounter* dependency = nullptr;
+		};
+
+		struct WorkQueue {
+			std::mutex mutex;
+			std::deque<QueuedJob> jobs{};
+		};
+
+		void workerLoop(uint32_t queueIndex);
+		void push(WorkQueue& queue, QueuedJob job);
+		// Runs one job from the caller's queue, another queue or, for workers, the background
+		// queues. Returns false if nothing was runnable.
+		bool tryRunJob(uint32_t queueIndex, bool allowBackground);
+		bool takeJob(uint32_t queueIndex, bool allowBackground, QueuedJob& job);
+		void execute(QueuedJob& job);
+		uint32_t currentQueue() const;
+		void wakeWorkers(bool all);
+
+		// [0] is shared by threads outside the pool, [i + 1] belongs to worker i
+		std::vector<std::unique_ptr<WorkQueue>> queues{};
+		WorkQueue backgroundQueue{};
+		WorkQueue highPriorityBackgroundQueue{};
+		std::vector<std::thread> workers{};
+
+		// jobs in any queue, lets idle workers sleep
+		std::atomic<uint32_t> queuedJobs{ 0 };
+		std::atomic<bool> stopping{ false };
+		std::mutex sleepMutex;
+		std::condition_variable wakeCondition;
+	};
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "vortex_model.h"
+
+//std includes
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace VortexEngine {
+
+	// On-disk cache of deduplicated model geometry. Each source mesh maps to one .vmesh file under
+	// the cache directory holding a header (keyed by source path, size and modification time, and
+	// carrying the mesh bounds) followed by the raw Vertex and index arrays, so a warm load is a
+	// single file mapping with no per-vertex work.
+	class VortexMeshCache {
+	public:
+		static constexpr uint32_t VERSION = 2;
+
+		// Read-only mapping of a valid cache file. Vertex and index pointers stay valid for the
+		// lifetime of this object.
+		class MappedMesh {
+		public:
+			~MappedMesh();
+
+			MappedMesh(const MappedMesh&) = delete;
+			MappedMesh& operator=(const MappedMesh&) = delete;
+
+			const VortexModel::Vertex* vertices() const { return vertexData; }
+			const uint32_t* indices() const { return indexData; }
+			uint32_t getVertexCount() const { return vertexCount; }
+			uint32_t getIndexCount() const { return indexCount; }
+			const VortexAABB& getBoundingBox() const { return boundingBox; }
+			const glm::vec4& getBoundingSphere() const { return boundingSphere; }
+
+		private:
+			MappedMesh() = default;
+
+			void* view = nullptr;
+			size_t viewSize = 0;
+#ifdef _WIN32
+			void* fileHandle = nullptr;
+			void* mappingHandle = nullptr;
+#endif
+
+			const VortexModel::Vertex* vertexData = nullptr;
+			const uint32_t* indexData = nullptr;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+			VortexAABB boundingBox{};
+			glm::vec4 boundingSphere{ 0.0f };
+
+			friend class VortexMeshCache;
+		};
+
+		// Returns nullptr when there is no cache entry for sourcePath, or when it is stale
+		// (source size/mtime changed) or was written by an incompatible version.
+		static std::unique_ptr<MappedMesh> load(const std::string& sourcePath);
+
+		// Writes the builder's geometry for sourcePath. Failing to write the cache is not fatal,
+		// so this returns false instead of throwing.
+		static bool store(const std::string& sourcePath, const VortexModel::Builder& builder);
+
+		static void setCacheDirectory(const std::string& directory) { cacheDirectory() = directory; }
+		static std::string cacheFilePath(const std::string& sourcePath);
+
+	private:
+		static std::string& cacheDirectory();
+		static std::unique_ptr<MappedMesh> mapFile(const std::string& path);
+	};
+}
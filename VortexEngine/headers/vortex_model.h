@@ -2,6 +2,8 @@
 
 #include "vortex_device.h"
 #include "vortex_buffer.h"
+#include "vortex_geometry_pool.h"
+#include "vortex_frustum.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -12,6 +14,8 @@
 #include <vector>
 
 namespace VortexEngine {
+	class VortexJobSystem;
+
 	class VortexModel {
 	public:
 		struct Vertex {
@@ -32,10 +36,26 @@ namespace VortexEngine {
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
 
-			void loadModel(const std::string& filepath);
+			// Model space bounds of vertices. Sphere: xyz = center, w = radius
+			VortexAABB boundingBox{};
+			glm::vec4 boundingSphere{ 0.0f };
+
+			// Vertices with equal data share one index, numbered in order of first use. Large meshes
+			// split the work across jobSystem when given one. Also computes the bounds.
+			void loadModel(const std::string& filepath, VortexJobSystem* jobSystem = nullptr);
+			// For builders filled in by hand, loadModel already does this
+			void computeBounds();
 		};
 
 		VortexModel(VortexDevice& vortexDevice, const VortexModel::Builder &builder);
+		VortexModel(
+			VortexDevice& vortexDevice,
+			const Vertex* vertices,
+			uint32_t vertexCount,
+			const uint32_t* indices,
+			uint32_t indexCount,
+			const VortexAABB& boundingBox,
+			const glm::vec4& boundingSphere);
 		~VortexModel();
 
 		VortexModel(const VortexModel&) = delete;
@@ -43,21 +63,35 @@ namespace VortexEngine {
 
 		static std::unique_ptr<VortexModel> createModelFromFile(VortexDevice& device, const std::string& filepath);
 
+		// Binds the geometry pool pages this model lives in. Models that share bindings can be
+		// drawn back to back after a single bind.
 		void bind(VkCommandBuffer commandBuffer);
-		void draw(VkCommandBuffer commandBuffer);
-
+		void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+		bool sharesBindingsWith(const VortexModel& other) const;
+
+		uint32_t getVertexCount() const { return vertexCount; }
+		uint32_t getIndexCount() const { return indexCount; }
+		uint32_t getFirstVertex() const { return vertexRange.first; }
+		uint32_t getFirstIndex() const { return indexRange.first; }
+		bool isIndexed() const { return hasIndexBuffer; }
+		// Model space bounds, computed when the mesh was loaded. Sphere: xyz = center, w = radius
+		const glm::vec4& getBoundingSphere() const { return boundingSphere; }
+		const VortexAABB& getBoundingBox() const { return boundingBox; }
 
 	private:
-		void createVertexBuffers(const std::vector<Vertex> &vertices);
-		void createIndexBuffers(const std::vector<uint32_t> &indices);
+		void createVertexBuffers(const Vertex* vertices, uint32_t count);
+		void createIndexBuffers(const uint32_t* indices, uint32_t count);
 
 		VortexDevice& vortexDevice;
 
-		std::unique_ptr<VortexBuffer> vertexBuffer;
+		VortexGeometryPool::Range vertexRange{};
 		uint32_t vertexCount;
 
 		bool hasIndexBuffer = false;
-		std::unique_ptr<VortexBuffer> indexBuffer;
+		VortexGeometryPool::Range indexRange{};
 		uint32_t indexCount;
+
+		glm::vec4 boundingSphere;
+		VortexAABB boundingBox;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "vortex_device.h"
+#include "vortex_model.h"
+
+//std includes
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace VortexEngine {
+	// Path keyed cache of loaded models. Every object referencing the same mesh file shares one
+	// VortexModel (and so one set of GPU buffers); the shared_ptr use count is the reference count.
+	class VortexModelRegistry {
+	public:
+		struct Stats {
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			size_t residentModels = 0;
+		};
+
+		VortexModelRegistry(VortexDevice& device);
+		~VortexModelRegistry();
+
+		VortexModelRegistry(const VortexModelRegistry&) = delete;
+		VortexModelRegistry& operator=(const VortexModelRegistry&) = delete;
+
+		// Returns the shared model for filepath, loading and uploading it on first use. Main thread
+		// only: the upload goes through the device's upload queue and geometry pool, which are not
+		// thread safe. Loaders that parse on workers use acquireModel/insertModel instead.
+		std::shared_ptr<VortexModel> getModel(const std::string& filepath);
+
+		// Returns the model if it is already resident, nullptr otherwise. Does not touch the stats.
+		std::shared_ptr<VortexModel> findModel(const std::string& filepath) const;
+
+		// Like findModel, but a resident model counts as a cache hit. Used by loaders that do their
+		// own (asynchronous) loading on a miss and hand the result back through insertModel.
+		std::shared_ptr<VortexModel> acquireModel(const std::string& filepath);
+
+		// Registers a model loaded outside the registry and counts it as a miss. If the path became
+		// resident in the meantime the existing model wins and is returned instead.
+		std::shared_ptr<VortexModel> insertModel(const std::string& filepath, std::shared_ptr<VortexModel> model);
+
+		// Drops models that nothing outside the registry references any more, returns how many
+		size_t releaseUnused();
+		void clear();
+
+		Stats getStats() const;
+
+		static std::string makeKey(const std::string& filepath);
+
+	private:
+		VortexDevice& vortexDevice;
+
+		mutable std::mutex mutex;
+		std::unordered_map<std::string, std::shared_ptr<VortexModel>> models{};
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+	};
+}
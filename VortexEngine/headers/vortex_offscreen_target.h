@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../headers/vortex_device.h"
+#include "../headers/vortex_swap_chain.h"
+
+#include <vulkan/vulkan.h>
+
+// std lib headers
+#include <cstdint>
+#include <vector>
+
+namespace VortexEngine {
+
+    // Stand-in for VortexSwapChain when there is no window to present to. Renders into a ring of
+    // device-local color/depth images (one per frame in flight) guarded by fences, and exposes the
+    // subset of the swap chain interface that VortexRenderer uses.
+    class VortexOffscreenTarget {
+    public:
+        static constexpr int MAX_FRAMES_IN_FLIGHT = VortexSwapChain::MAX_FRAMES_IN_FLIGHT;
+
+        VortexOffscreenTarget(VortexDevice& deviceRef, VkExtent2D extent);
+        ~VortexOffscreenTarget();
+
+        VortexOffscreenTarget(const VortexOffscreenTarget&) = delete;
+        VortexOffscreenTarget& operator=(const VortexOffscreenTarget&) = delete;
+
+        VkFramebuffer getFrameBuffer(int index) { return framebuffers[index]; }
+        VkRenderPass getRenderPass() { return renderPass; }
+        VkImageView getImageView(int index) { return colorImageViews[index]; }
+        size_t imageCount() { return colorImages.size(); }
+        VkFormat getSwapChainImageFormat() { return colorFormat; }
+        VkExtent2D getSwapChainExtent() { return extent; }
+        uint32_t width() { return extent.width; }
+        uint32_t height() { return extent.height; }
+
+        float extentAspectRatio() {
+            return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+        }
+        VkFormat findDepthFormat();
+
+        VkResult acquireNextImage(uint32_t* imageIndex);
+        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+
+        // Copies the color image at imageIndex into pixels as tightly packed 4 byte texels
+        // (width * height * 4 bytes). Blocks until the frame that last rendered into it has finished.
+        void readPixels(uint32_t imageIndex, std::vector<uint8_t>& pixels);
+        uint32_t getLastSubmittedImage() const { return lastSubmittedImage; }
+
+    private:
+        void createColorResources();
+        void createDepthResources();
+        void createRenderPass();
+        void createFramebuffers();
+        void createSyncObjects();
+
+        VkFormat findColorFormat();
+
+        VortexDevice& device;
+        VkExtent2D extent;
+
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+
+        std::vector<VkImage> colorImages;
+        std::vector<VortexAllocation> colorImageMemorys;
+        std::vector<VkImageView> colorImageViews;
+        std::vector<VkImage> depthImages;
+        std::vector<VortexAllocation> depthImageMemorys;
+        std::vector<VkImageView> depthImageViews;
+
+        std::vector<VkFramebuffer> framebuffers;
+        VkRenderPass renderPass;
+
+        std::vector<VkFence> inFlightFences;
+        size_t currentFrame = 0;
+        uint32_t lastSubmittedImage = 0;
+    };
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace VortexEngine {
+
+    /*
+     * Two level segregated fit (TLSF) allocator over an abstract [0, size) range.
+     *
+     * It only hands out offsets and never touches memory, so the same allocator backs device
+     * memory blocks and sub-ranges of large buffers. Allocation and free are O(1): free ranges are
+     * binned by a first level power of two and a second level linear split, and adjacent free
+     * ranges are merged on free.
+     *
+     * Not thread safe.
+     */
+    class VortexOffsetAllocator {
+    public:
+        static constexpr uint32_t INVALID_NODE = 0xffffffff;
+
+        struct Allocation {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t node = INVALID_NODE;
+
+            bool isValid() const { return node != INVALID_NODE; }
+        };
+
+        explicit VortexOffsetAllocator(uint64_t size);
+
+        VortexOffsetAllocator(const VortexOffsetAllocator&) = delete;
+        VortexOffsetAllocator& operator=(const VortexOffsetAllocator&) = delete;
+        VortexOffsetAllocator(VortexOffsetAllocator&&) = default;
+        VortexOffsetAllocator& operator=(VortexOffsetAllocator&&) = default;
+
+        // Returns an invalid allocation when no free range is large enough. alignment must be a
+        // power of two.
+        Allocation allocate(uint64_t requestedSize, uint64_t alignment = 1);
+        void free(Allocation allocation);
+        void reset();
+
+        uint64_t getSize() const { return size; }
+        uint64_t getFreeSize() const { return freeSize; }
+        uint64_t getUsedSize() const { return size - freeSize; }
+        uint32_t getAllocationCount() const { return allocationCount; }
+        bool isEmpty() const { return allocationCount == 0; }
+        // Size of the largest range a single allocation could get without alignment padding
+        uint64_t getLargestFreeRange() const;
+
+    private:
+        static constexpr uint32_t SECOND_LEVEL_LOG2 = 4;
+        static constexpr uint32_t SECOND_LEVEL_COUNT = 1 << SECOND_LEVEL_LOG2;
+        static constexpr uint32_t FIRST_LEVEL_COUNT = 64 - SECOND_LEVEL_LOG2 + 1;
+
+        struct Node {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+            uint32_t prevPhysical = INVALID_NODE;
+            uint32_t nextPhysical = INVALID_NODE;
+            uint32_t prevFree = INVALID_NODE;
+            uint32_t nextFree = INVALID_NODE;
+            bool used = false;
+        };
+
+        static void mapping(uint64_t rangeSize, uint32_t& firstLevel, uint32_t& secondLevel);
+        // A free node that can hold allocationSize at alignment, INVALID_NODE when there is none
+        uint32_t findFreeNode(uint64_t allocationSize, uint64_t alignment) const;
+        static bool fits(const Node& node, uint64_t allocationSize, uint64_t alignment);
+
+        uint32_t createNode(uint64_t offset, uint64_t nodeSize);
+        void releaseNode(uint32_t node);
+        void insertFree(uint32_t node);
+        void removeFree(uint32_t node);
+        // Splits the tail of node off into a new free node, returns the new node
+        uint32_t splitTail(uint32_t node, uint64_t keepSize);
+
+        uint64_t size;
+        uint64_t freeSize = 0;
+        uint32_t allocationCount = 0;
+
+        uint64_t firstLevelBitmap = 0;
+        uint32_t secondLevelBitmaps[FIRST_LEVEL_COUNT]{};
+        uint32_t freeHeads[FIRST_LEVEL_COUNT][SECOND_LEVEL_COUNT];
+
+        std::vector<Node> nodes{};
+        std::vector<uint32_t> unusedNodes{};
+    };
+
+}  // namespace VortexEngine
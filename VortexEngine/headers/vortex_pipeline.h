@@ -1,15 +1,47 @@
 #pragma once
 
 #include "../headers/vortex_device.h"
+#include "../headers/vortex_shader_reflection.h"
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace VortexEngine {
 
+	// Values for specialization constants (layout(constant_id = N) in GLSL). A constant a stage does
+	// not declare is ignored by Vulkan, so one set serves every stage of a pipeline.
+	class ShaderSpecialization {
+	public:
+		ShaderSpecialization& set(uint32_t constantId, uint32_t value) { return setValue(constantId, &value); }
+		ShaderSpecialization& set(uint32_t constantId, int32_t value) { return setValue(constantId, &value); }
+		ShaderSpecialization& set(uint32_t constantId, float value) { return setValue(constantId, &value); }
+		ShaderSpecialization& set(uint32_t constantId, bool value) {
+			VkBool32 boolValue = value ? VK_TRUE : VK_FALSE;
+			return setValue(constantId, &boolValue);
+		}
+
+		bool empty() const { return entries.empty(); }
+		// Sorted by constant id, so equal sets compare and hash equal whatever order they were set in
+		const std::vector<VkSpecializationMapEntry>& getEntries() const { return entries; }
+		const std::vector<uint32_t>& getData() const { return data; }
+		// Points into this object, valid while it is unchanged
+		VkSpecializationInfo getInfo() const;
+
+	private:
+		// every supported type is 4 bytes
+		ShaderSpecialization& setValue(uint32_t constantId, const void* value);
+
+		std::vector<VkSpecializationMapEntry> entries{};
+		std::vector<uint32_t> data{};
+	};
+
 	struct PipelineConfigInfo {
 		PipelineConfigInfo(const PipelineConfigInfo&) = delete;
 		PipelineConfigInfo& operator=(const PipelineConfigInfo&) = delete;
 
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions{};
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
 		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
 		VkPipelineRasterizationStateCreateInfo rasterizationInfo;
 		VkPipelineMultisampleStateCreateInfo multisampleInfo;
@@ -22,6 +54,33 @@ namespace VortexEngine {
 		VkPipelineLayout pipelineLayout = nullptr;
 		VkRenderPass renderPass = nullptr;
 		uint32_t subpass = 0;
+		// applied to the vertex and the fragment stage
+		ShaderSpecialization specialization{};
+	};
+
+	// SPIR-V code and the VkShaderModule created from it. Shared between pipelines through
+	// VortexPipelineRegistry, which deduplicates modules by getHash().
+	class VortexShaderModule {
+	public:
+		VortexShaderModule(VortexDevice& device, std::vector<char> code);
+		~VortexShaderModule();
+
+		VortexShaderModule(const VortexShaderModule&) = delete;
+		VortexShaderModule& operator=(const VortexShaderModule&) = delete;
+
+		VkShaderModule getShaderModule() const { return shaderModule; }
+		const std::vector<char>& getCode() const { return code; }
+		uint64_t getHash() const { return hash; }
+		const VortexShaderReflection& getReflection() const { return reflection; }
+
+		static uint64_t hashCode(const std::vector<char>& code);
+
+	private:
+		VortexDevice& vortexDevice;
+		std::vector<char> code;
+		uint64_t hash;
+		VortexShaderReflection reflection;
+		VkShaderModule shaderModule;
 	};
 
 	class VortexPipeline {
@@ -31,6 +90,11 @@ namespace VortexEngine {
 			const std::string& vertFilepath,
 			const std::string& fragFilepath,
 			const PipelineConfigInfo& configInfo);
+		VortexPipeline(
+			VortexDevice& device,
+			std::shared_ptr<VortexShaderModule> vertShader,
+			std::shared_ptr<VortexShaderModule> fragShader,
+			const PipelineConfigInfo& configInfo);
 		~VortexPipeline();
 
 		VortexPipeline(const VortexPipeline&) = delete;
@@ -39,20 +103,35 @@ namespace VortexEngine {
 		void bind(VkCommandBuffer commandBuffer);
 
 		static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo, VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+		// PipelineConfigInfo points into itself, so it cannot be copied member wise. Pointers into
+		// source are redirected into destination, any other pointer is copied as is.
+		static void copyPipelineConfigInfo(const PipelineConfigInfo& source, PipelineConfigInfo& destination);
 
-	private:
 		static std::vector<char> readFile(const std::string& filepath);
 
-		void createGraphicsPipeline(
-			const std::string& vertFilepath,
-			const std::string& fragFilepath,
-			const PipelineConfigInfo& configInfo);
-
-		void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
+	private:
+		void createGraphicsPipeline(const PipelineConfigInfo& configInfo);
 
 		VortexDevice& vortexDevice;
 		VkPipeline graphicsPipeline;
-		VkShaderModule vertShaderModule;
-		VkShaderModule fragShaderModule;
+		std::shared_ptr<VortexShaderModule> vertShaderModule;
+		std::shared_ptr<VortexShaderModule> fragShaderModule;
+	};
+
+	class VortexComputePipeline {
+	public:
+		VortexComputePipeline(VortexDevice& device, const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+		VortexComputePipeline(VortexDevice& device, std::shared_ptr<VortexShaderModule> compShader, VkPipelineLayout pipelineLayout);
+		~VortexComputePipeline();
+
+		VortexComputePipeline(const VortexComputePipeline&) = delete;
+		VortexComputePipeline& operator=(const VortexComputePipeline&) = delete;
+
+		void bind(VkCommandBuffer commandBuffer);
+
+	private:
+		VortexDevice& vortexDevice;
+		VkPipeline computePipeline;
+		std::shared_ptr<VortexShaderModule> compShaderModule;
 	};
 }
\ No newline at end of file
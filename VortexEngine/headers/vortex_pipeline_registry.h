@@ -0,0 +1,162 @@
+#pragma once
+
+#include "vortex_device.h"
+#include "vortex_pipeline.h"
+#include "vortex_job_system.h"
+#include "vortex_descriptors.h"
+
+//std includes
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VortexEngine {
+	// Result of VortexPipelineRegistry::getPipelineAsync. Copies share the same compile.
+	class VortexPipelineHandle {
+	public:
+		VortexPipelineHandle() = default;
+
+		// The requested pipeline once it has been swapped in, the fallback until then. nullptr means
+		// the draw should be skipped.
+		VortexPipeline* get() const {
+			if (!compiled) {
+				return nullptr;
+			}
+			return compiled->pipeline ? compiled->pipeline.get() : fallback.get();
+		}
+		bool isReady() const { return compiled && compiled->pipeline; }
+
+	private:
+		friend class VortexPipelineRegistry;
+
+		struct Compiled {
+			// only written by VortexPipelineRegistry::swapCompletedPipelines, between frames
+			std::shared_ptr<VortexPipeline> pipeline{};
+		};
+
+		std::shared_ptr<Compiled> compiled{};
+		std::shared_ptr<VortexPipeline> fallback{};
+	};
+
+	/*
+	 * Shared pipelines, pipeline layouts and shader modules.
+	 *
+	 * Pipelines are keyed by the fixed function state in PipelineConfigInfo, their shader modules,
+	 * the pipeline layout and the render pass / subpass, so render systems asking for identical
+	 * state get the same VortexPipeline. Keys hold the state itself and are compared in full, a
+	 * hash only selects the bucket. Shader modules are keyed by a hash of
+	 * their SPIR-V, so a file is only read once and identical code behind different paths shares one
+	 * VkShaderModule. Pipeline layouts are keyed by their set layouts and push constant ranges,
+	 * descriptor set layouts by their bindings.
+	 *
+	 * getReflectedLayout() derives both kinds of layout from the shaders themselves (see
+	 * VortexShaderReflection), so the C++ side can no longer drift from what the shaders declare.
+	 *
+	 * getPipelineAsync() compiles on a background job instead, so a new variant never stalls the
+	 * frame that asks for it; finished pipelines are handed out at the next frame boundary.
+	 *
+	 * Render passes are compared by handle. The swap chain keeps its formats when it is recreated,
+	 * so pipelines already handed out stay compatible with the new render pass.
+	 */
+	class VortexPipelineRegistry {
+	public:
+		struct Stats {
+			uint64_t hits = 0;
+			uint64_t misses = 0;
+			size_t pipelines = 0;
+			size_t shaderModules = 0;
+			size_t pipelineLayouts = 0;
+			size_t descriptorSetLayouts = 0;
+		};
+
+		// Layout declared by the stages of one pipeline
+		struct ReflectedLayout {
+			// indexed by set number, sets no stage uses get an empty layout
+			std::vector<std::shared_ptr<VortexDescriptorSetLayout>> setLayouts{};
+			std::vector<VkPushConstantRange> pushConstantRanges{};
+			// owned by the registry
+			VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		};
+
+		// Without a job system getPipelineAsync compiles synchronously
+		VortexPipelineRegistry(VortexDevice& device, VortexJobSystem* jobSystem = nullptr);
+		// Waits for pending compiles. Pipelines still referenced elsewhere keep their shader
+		// modules alive, but the pipeline layouts are destroyed here.
+		~VortexPipelineRegistry();
+
+		VortexPipelineRegistry(const VortexPipelineRegistry&) = delete;
+		VortexPipelineRegistry& operator=(const VortexPipelineRegistry&) = delete;
+
+		std::shared_ptr<VortexPipeline> getPipeline(
+			const std::string& vertFilepath,
+			const std::string& fragFilepath,
+			const PipelineConfigInfo& configInfo);
+		std::shared_ptr<VortexComputePipeline> getComputePipeline(const std::string& compFilepath, VkPipelineLayout pipelineLayout);
+
+		// Like getPipeline, but returns at once and compiles in the background; the handle yields
+		// fallback (which may be null) until swapCompletedPipelines publishes the result. Requests
+		// for a pipeline that is already compiling share that compile. Pointers in configInfo that
+		// lead outside of it must stay valid until the compile finishes.
+		VortexPipelineHandle getPipelineAsync(
+			const std::string& vertFilepath,
+			const std::string& fragFilepath,
+			const PipelineConfigInfo& configInfo,
+			std::shared_ptr<VortexPipeline> fallback = nullptr);
+		// Publishes pipelines that finished compiling to their handles and returns how many. Call
+		// once per frame while no thread is recording. Rethrows compile errors.
+		size_t swapCompletedPipelines();
+		// Asynchronous compiles not yet swapped in
+		size_t getPendingCount() const;
+
+		// Returns the module for filepath, reading it on first use
+		std::shared_ptr<VortexShaderModule> getShaderModule(const std::string& filepath);
+
+		// Owned by the registry, valid until it is destroyed
+		VkPipelineLayout getPipelineLayout(
+			const std::vector<VkDescriptorSetLayout>& setLayouts,
+			const std::vector<VkPushConstantRange>& pushConstantRanges = {});
+		// Shared by every caller asking for the same bindings, in any order
+		std::shared_ptr<VortexDescriptorSetLayout> getDescriptorSetLayout(std::vector<VkDescriptorSetLayoutBinding> bindings);
+		// Reflects the shaders and returns their merged layout. Throws when two stages declare a
+		// binding differently or a runtime sized descriptor array is used.
+		ReflectedLayout getReflectedLayout(const std::vector<std::string>& shaderFilepaths);
+
+		// Drops pipelines and shader modules that nothing outside the registry references any more,
+		// returns how many pipelines
+		size_t releaseUnused();
+
+		Stats getStats() const;
+
+	private:
+		struct CompletedPipeline {
+			std::string key;
+			std::shared_ptr<VortexPipeline> pipeline{};
+			std::exception_ptr error{};
+		};
+
+		std::string makePipelineKey(const PipelineConfigInfo& configInfo, const VortexShaderModule& vertShader, const VortexShaderModule& fragShader) const;
+
+		VortexDevice& vortexDevice;
+		VortexJobSystem* jobSystem;
+		VortexJobCounter compileCounter{};
+
+		mutable std::mutex mutex;
+		// keys from makePipelineKey and KeyWriter, see the .cpp
+		std::unordered_map<std::string, std::shared_ptr<VortexPipeline>> pipelines{};
+		std::unordered_map<std::string, std::shared_ptr<VortexComputePipeline>> computePipelines{};
+		// by content hash, and by normalized path so a file is only read once
+		std::unordered_map<uint64_t, std::shared_ptr<VortexShaderModule>> shaderModules{};
+		std::unordered_map<std::string, std::shared_ptr<VortexShaderModule>> shaderModulePaths{};
+		std::unordered_map<std::string, VkPipelineLayout> pipelineLayouts{};
+		std::unordered_map<std::string, std::shared_ptr<VortexDescriptorSetLayout>> descriptorSetLayouts{};
+		// by key, waiting for their compile job or for the next swap
+		std::unordered_map<std::string, std::shared_ptr<VortexPipelineHandle::Compiled>> compilingPipelines{};
+		std::vector<CompletedPipeline> completedPipelines{};
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+	};
+}
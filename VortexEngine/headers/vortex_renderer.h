@@ -3,7 +3,9 @@
 #include "../headers/vortex_window.h"
 #include "../headers/vortex_device.h"
 #include "../headers/vortex_swap_chain.h"
+#include "../headers/vortex_offscreen_target.h"
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 #include <cassert>
@@ -14,17 +16,24 @@ namespace VortexEngine {
 	public:
 
 		VortexRenderer(VortexWindow &window, VortexDevice &device);
+		// Headless renderer: frames go to an offscreen image ring instead of a swap chain
+		VortexRenderer(VortexDevice &device, VkExtent2D extent);
 		~VortexRenderer();
 
 		VortexRenderer(const VortexRenderer&) = delete;
 		VortexRenderer& operator=(const VortexRenderer&) = delete;
 
 		VkRenderPass getSwapChainRenderPass() const {
-			return vortexSwapChain->getRenderPass();
+			return isHeadless() ? offscreenTarget->getRenderPass() : vortexSwapChain->getRenderPass();
 		}
 		float getAspectRatio() const {
-			return vortexSwapChain->extentAspectRatio();
+			return isHeadless() ? offscreenTarget->extentAspectRatio() : vortexSwapChain->extentAspectRatio();
 		}
+		VkExtent2D getExtent() const {
+			return isHeadless() ? offscreenTarget->getSwapChainExtent() : vortexSwapChain->getSwapChainExtent();
+		}
+
+		bool isHeadless() const { return offscreenTarget != nullptr; }
 
 		bool isFrameInProgress() const { return isFrameStarted; }
 
@@ -42,21 +51,57 @@ namespace VortexEngine {
 
 		VkCommandBuffer beginFrame();
 		void endFrame();
-		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		// With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the pass may only be filled through
+		// executeSecondaryCommandBuffers
+		void beginSwapChainRenderPass(VkCommandBuffer commandBuffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 		void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
+		// Dynamic state is not inherited by secondary command buffers, so each one sets it again
+		void setViewportAndScissor(VkCommandBuffer commandBuffer);
+
+		// Number of threads that may record secondary command buffers at once. Each worker owns a
+		// command pool per frame in flight. Must not be called while a frame is in progress.
+		void setWorkerCount(uint32_t count);
+		uint32_t getWorkerCount() const { return workerCount; }
+
+		// Begins a secondary command buffer continuing the current swap chain render pass, with
+		// viewport and scissor already set. Different workers may call this concurrently; a single
+		// worker must not. The buffer is only valid for the current frame.
+		VkCommandBuffer beginSecondaryCommandBuffer(uint32_t worker);
+		void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+		// Executes ended secondary command buffers, in order, inside a render pass begun with
+		// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+		void executeSecondaryCommandBuffers(VkCommandBuffer commandBuffer, const std::vector<VkCommandBuffer>& secondaryCommandBuffers);
+
+		// Headless only: reads back the most recently submitted frame as width * height * 4 bytes
+		void readbackFrame(std::vector<uint8_t>& pixels);
 
 	private:
+		// One worker's secondary command buffers for one frame in flight, handed out in order and
+		// recycled together when the pool is reset
+		struct WorkerCommandPool {
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> commandBuffers{};
+			size_t used = 0;
+		};
+
 		void createCommandBuffers();
 		void freeCommandBuffers();
+		void createWorkerCommandPools();
+		void destroyWorkerCommandPools();
 		void recreateSwapChain();
+		VkFramebuffer getCurrentFrameBuffer() const;
 
-		VortexWindow& vortexWindow;
+		VortexWindow* vortexWindow = nullptr;
 		VortexDevice& vortexDevice;
 		std::unique_ptr<VortexSwapChain> vortexSwapChain;
+		std::unique_ptr<VortexOffscreenTarget> offscreenTarget;
 		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t workerCount{ 1 };
+		// [frameIndex * workerCount + worker]
+		std::vector<WorkerCommandPool> workerCommandPools;
 
-		uint32_t currentImageIndex;
-		int currentFrameIndex;
-		bool isFrameStarted;
+		uint32_t currentImageIndex{ 0 };
+		int currentFrameIndex{ 0 };
+		bool isFrameStarted{ false };
 	};
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "vortex_device.h"
+
+//std includes
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VortexEngine {
+	/*
+	 * Interface of one SPIR-V entry point, read straight from the module's instructions: the
+	 * descriptors it declares, its push constant block and, for vertex shaders, the vertex inputs
+	 * it expects. Only what pipeline creation needs is kept, names are for error messages.
+	 */
+	class VortexShaderReflection {
+	public:
+		enum class BaseType : uint32_t {
+			Float,
+			Int,
+			UInt
+		};
+
+		struct DescriptorBinding {
+			uint32_t set;
+			uint32_t binding;
+			VkDescriptorType type;
+			// 0 for a runtime sized array
+			uint32_t count;
+			VkShaderStageFlags stageFlags;
+			std::string name;
+		};
+
+		struct VertexInput {
+			uint32_t location;
+			uint32_t componentCount;
+			BaseType baseType;
+			std::string name;
+		};
+
+		// Throws std::runtime_error for code that is not SPIR-V or uses an unsupported descriptor
+		explicit VortexShaderReflection(const std::vector<char>& code);
+
+		VkShaderStageFlagBits getStage() const { return stage; }
+		// Sorted by set, then binding
+		const std::vector<DescriptorBinding>& getDescriptorBindings() const { return descriptorBindings; }
+		// Covers every member of the push constant block, size 0 without one
+		const VkPushConstantRange& getPushConstantRange() const { return pushConstantRange; }
+		// Vertex stage only, sorted by location. A matrix input takes one location per column.
+		const std::vector<VertexInput>& getVertexInputs() const { return vertexInputs; }
+
+		// Throws unless every vertex input has an attribute at its location whose format has the
+		// same number and kind of components. Attributes the shader ignores are fine.
+		void validateVertexInput(const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) const;
+
+		// Combined layout of the stages of one pipeline: descriptor bindings by set with their stage
+		// flags merged, and one push constant range per distinct block. Throws when two stages
+		// declare the same binding differently.
+		struct Layout {
+			std::vector<std::vector<VkDescriptorSetLayoutBinding>> sets{};
+			std::vector<VkPushConstantRange> pushConstantRanges{};
+		};
+		static Layout mergeLayouts(const std::vector<const VortexShaderReflection*>& stages);
+
+		static const char* getDescriptorTypeName(VkDescriptorType type);
+
+	private:
+		void reflect(const std::vector<uint32_t>& words);
+
+		VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+		std::vector<DescriptorBinding> descriptorBindings{};
+		VkPushConstantRange pushConstantRange{};
+		std::vector<VertexInput> vertexInputs{};
+	};
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "vortex_components.h"
+#include "vortex_world.h"
+#include "vortex_job_system.h"
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace VortexEngine {
+	/*
+	 * Structure of arrays copy of many TransformComponents together with their local and world
+	 * model and normal matrices.
+	 *
+	 * set() only marks a transform dirty when it actually changed, and update() rebuilds the
+	 * local matrices of the dirty transforms in one batch: four at a time with SSE, sharing the six
+	 * sin / cos values between the model and the normal matrix. The local matrices match
+	 * TransformComponent::mat4 and TransformComponent::normalMatrix.
+	 *
+	 * Transforms with a parent are relative to it. World matrices are cached per transform, laid out
+	 * breadth first so every depth level is contiguous and siblings are adjacent. update() only
+	 * visits dirty transforms and their descendants, parents before children; everything else
+	 * keeps its cached world matrix. Dirty subtrees never overlap, so large updates are split
+	 * across a job system by subtree.
+	 */
+	class VortexTransformStore {
+	public:
+		static constexpr uint32_t NO_PARENT = std::numeric_limits<uint32_t>::max();
+
+		uint32_t size() const { return static_cast<uint32_t>(translationX.size()); }
+		// New transforms are identity, dirty and have no parent
+		void resize(uint32_t count);
+
+		void set(uint32_t index, const TransformComponent& transform);
+		TransformComponent get(uint32_t index) const;
+
+		// Makes index relative to parentIndex, or a root with NO_PARENT. Cycles are rejected by
+		// the next update().
+		void setParent(uint32_t index, uint32_t parentIndex);
+		uint32_t getParent(uint32_t index) const { return parents[index]; }
+
+		// Copies every TransformComponent and ParentComponent of world, indexed by entity index,
+		// then calls update(). A ParentComponent naming a dead entity makes its owner a root.
+		uint32_t sync(VortexWorld& world, VortexJobSystem* jobSystem = nullptr);
+
+		// Recomputes the world matrices of every transform changed since the last update and of
+		// their descendants, returns how many. Large updates are split across jobSystem when given:
+		// local matrices by dirty transform, world matrices by dirty subtree.
+		uint32_t update(VortexJobSystem* jobSystem = nullptr);
+		// Transforms whose world matrix changed in the last update(), in no particular order
+		const std::vector<uint32_t>& getUpdatedIndices() const { return updatedIndices; }
+
+		const glm::mat4& getModelMatrix(uint32_t index) const { return matrices[slots[index]].model; }
+		// Upper 3x3 holds the normal matrix, padded to a mat4 for GPU layouts
+		const glm::mat4& getNormalMatrix(uint32_t index) const { return matrices[slots[index]].normal; }
+		const glm::mat4& getLocalModelMatrix(uint32_t index) const { return matrices[slots[index]].localModel; }
+
+		// Breadth first levels of the last hierarchy update as slot ranges: level d covers
+		// [offsets[d], offsets[d + 1]). Only kept up to date while some transform has a parent.
+		const std::vector<uint32_t>& getLevelOffsets() const { return levelOffsets; }
+
+	private:
+		// Everything an update touches for one transform, kept on the same four cache lines. World
+		// matrices are the parent's world matrix times the local one, the local one for roots.
+		struct alignas(64) SlotMatrices {
+			glm::mat4 localModel{ 1.0f };
+			glm::mat4 localNormal{ 1.0f };
+			glm::mat4 model{ 1.0f };
+			glm::mat4 normal{ 1.0f };
+		};
+
+		// below this many matrices a single thread is faster than handing out jobs
+		static constexpr size_t PARALLEL_UPDATE_THRESHOLD = 4096;
+		// multiple of the SSE batch width
+		static constexpr size_t LOCAL_MATRIX_GRAIN = 1024;
+
+		void markDirty(uint32_t index);
+		// Local matrices of dirtyIndices [first, last)
+		void updateLocalMatrices(size_t first, size_t last);
+		// Lays the matrices out breadth first, throws on cycles
+		void buildHierarchyOrder();
+		void updateHierarchy(VortexJobSystem* jobSystem);
+		// World matrices of the subtrees under subtreeRoots [firstRoot, lastRoot)
+		void updateSubtrees(size_t firstRoot, size_t lastRoot, std::vector<uint32_t>& stack);
+
+		std::vector<float> translationX{}, translationY{}, translationZ{};
+		std::vector<float> rotationX{}, rotationY{}, rotationZ{};
+		std::vector<float> scaleX{}, scaleY{}, scaleZ{};
+
+		// matrices live in slots rather than at their index: breadth first once a hierarchy exists,
+		// so parents precede children and a level is contiguous
+		std::vector<uint32_t> slots{};
+		std::vector<SlotMatrices> matrices{};
+
+		std::vector<uint8_t> dirty{};
+		std::vector<uint32_t> dirtyIndices{};
+		std::vector<uint32_t> updatedIndices{};
+
+		std::vector<uint32_t> parents{};
+		uint32_t parentedCount = 0;
+		bool hierarchyChanged = false;
+		// per slot: the transform index, the parent's slot, the first child's slot and a scratch
+		// changed flag
+		std::vector<uint32_t> slotIndices{};
+		std::vector<uint32_t> slotParents{};
+		std::vector<uint32_t> slotChildren{};
+		std::vector<uint8_t> changedSlots{};
+		std::vector<uint32_t> levelOffsets{};
+		// update scratch
+		std::vector<uint32_t> dirtySlots{};
+		std::vector<uint32_t> subtreeRoots{};
+		std::vector<uint32_t> slotStack{};
+
+		// entity indices that had a ParentComponent at the last sync
+		std::vector<uint32_t> syncedChildren{};
+	};
+}
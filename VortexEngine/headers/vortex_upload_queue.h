@@ -0,0 +1,84 @@
+#pragma once
+
+#include "vortex_device.h"
+#include "vortex_buffer.h"
+
+// std
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace VortexEngine {
+
+    /*
+     * Batches host to device copies through one persistently mapped staging ring.
+     *
+     * Uploads are memcpy'd into the ring and recorded into a shared command buffer; flush() submits
+     * the whole batch with a fence and returns without waiting. Ring space is recycled as soon as
+     * the fence of the batch that used it signals. Every batch ends with a memory barrier, so work
+     * submitted to the graphics queue afterwards sees the uploaded data.
+     *
+     * Not thread safe: use it from the thread that submits to the graphics queue.
+     */
+    class VortexUploadQueue {
+    public:
+        static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 64 * 1024 * 1024;
+
+        struct Stats {
+            uint64_t submissions = 0;
+            uint64_t copies = 0;
+            uint64_t bytesUploaded = 0;
+            uint64_t stalls = 0;  // times an upload had to wait for the GPU to free ring space
+        };
+
+        VortexUploadQueue(VortexDevice& device, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+        ~VortexUploadQueue();
+
+        VortexUploadQueue(const VortexUploadQueue&) = delete;
+        VortexUploadQueue& operator=(const VortexUploadQueue&) = delete;
+
+        void uploadToBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+        // The image must already be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        void uploadToImage(
+            VkImage image, const void* data, VkDeviceSize size, uint32_t width, uint32_t height, uint32_t layerCount);
+
+        // Submits everything recorded since the last flush. Cheap when nothing is pending.
+        void flush();
+        // Flushes and blocks until every submitted batch has completed
+        void waitIdle();
+
+        bool hasPendingUploads() const { return recording; }
+        Stats getStats() const { return stats; }
+
+    private:
+        struct Batch {
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            VkDeviceSize ringBegin = 0;
+        };
+
+        VkDeviceSize allocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+        bool tryAllocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+        void retireCompletedBatches(bool waitForOldest);
+        Batch acquireBatch();
+
+        VortexDevice& vortexDevice;
+        std::unique_ptr<VortexBuffer> stagingBuffer;
+        VkDeviceSize capacity;
+        char* stagingMemory = nullptr;
+
+        // ring state: [tail, head) (wrapping) is owned by batches the GPU may still be reading
+        VkDeviceSize head = 0;
+        VkDeviceSize tail = 0;
+
+        Batch currentBatch{};
+        bool recording = false;
+        std::deque<Batch> inFlightBatches{};
+        std::vector<Batch> freeBatches{};
+
+        Stats stats{};
+    };
+
+}  // namespace VortexEngine
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace VortexEngine {
+	// Generational handle. The index is reused after destroyEntity, the generation tells the old
+	// and new entity apart.
+	struct VortexEntity {
+		static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+		uint32_t index = INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool isValid() const { return index != INVALID_INDEX; }
+		bool operator==(const VortexEntity& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const VortexEntity& other) const { return !(*this == other); }
+	};
+
+	// Sparse set bookkeeping shared by every component type
+	class VortexComponentPoolBase {
+	public:
+		virtual ~VortexComponentPoolBase() = default;
+
+		bool contains(uint32_t entityIndex) const {
+			return entityIndex < sparse.size() && sparse[entityIndex] != INVALID_SLOT;
+		}
+		size_t size() const { return entities.size(); }
+		// Entity index of each component, in component storage order
+		const std::vector<uint32_t>& getEntities() const { return entities; }
+
+		virtual void remove(uint32_t entityIndex) = 0;
+
+	protected:
+		static constexpr uint32_t INVALID_SLOT = std::numeric_limits<uint32_t>::max();
+
+		// entity index -> slot in the dense arrays
+		std::vector<uint32_t> sparse{};
+		// slot -> entity index
+		std::vector<uint32_t> entities{};
+	};
+
+	// Components of one type, packed contiguously. Removal swaps the last component into the hole,
+	// so pointers and references into the pool are invalidated by add and remove.
+	template<typename T>
+	class VortexComponentPool : public VortexComponentPoolBase {
+	public:
+		template<typename... Args>
+		T& emplace(uint32_t entityIndex, Args&&... args) {
+			if (contains(entityIndex)) {
+				T& component = components[sparse[entityIndex]];
+				component = T{ std::forward<Args>(args)... };
+				return component;
+			}
+
+			if (entityIndex >= sparse.size()) {
+				sparse.resize(static_cast<size_t>(entityIndex) + 1, INVALID_SLOT);
+			}
+			sparse[entityIndex] = static_cast<uint32_t>(entities.size());
+			entities.push_back(entityIndex);
+			components.push_back(T{ std::forward<Args>(args)... });
+			return components.back();
+		}
+
+		void remove(uint32_t entityIndex) override {
+			if (!contains(entityIndex)) {
+				return;
+			}
+
+			uint32_t slot = sparse[entityIndex];
+			uint32_t lastSlot = static_cast<uint32_t>(entities.size() - 1);
+			if (slot != lastSlot) {
+				components[slot] = std::move(components[lastSlot]);
+				entities[slot] = entities[lastSlot];
+				sparse[entities[slot]] = slot;
+			}
+
+			components.pop_back();
+			entities.pop_back();
+			sparse[entityIndex] = INVALID_SLOT;
+		}
+
+		T* tryGet(uint32_t entityIndex) { return contains(entityIndex) ? &components[sparse[entityIndex]] : nullptr; }
+		T& get(uint32_t entityIndex) {
+			assert(contains(entityIndex) && "Entity does not have this component");
+			return components[sparse[entityIndex]];
+		}
+
+		// Same order as getEntities()
+		std::vector<T>& getComponents() { return components; }
+
+	private:
+		std::vector<T> components{};
+	};
+
+	/*
+	 * Entities and their components, stored as one sparse set per component type.
+	 *
+	 * Each component type lives in its own contiguous array, so iterating a component touches only
+	 * that component's data. each<A, B>(fn) walks the smaller of the pools and skips entities
+	 * missing the other components. Components must not be added or removed, and entities must not
+	 * be created or destroyed, while an each() over the affected pools is running.
+	 *
+	 * Not thread safe. Concurrent each() calls that only read are fine once every pool they touch
+	 * exists.
+	 */
+	class VortexWorld {
+	public:
+		VortexWorld() = default;
+		~VortexWorld() = default;
+
+		VortexWorld(const VortexWorld&) = delete;
+		VortexWorld& operator=(const VortexWorld&) = delete;
+
+		VortexEntity createEntity();
+		// Removes every component of the entity. Destroying a dead entity does nothing.
+		void destroyEntity(VortexEntity entity);
+		bool isAlive(VortexEntity entity) const {
+			return entity.index < generations.size() && alive[entity.index] && generations[entity.index] == entity.generation;
+		}
+
+		// Handle of the live entity at index, or an invalid handle
+		VortexEntity getEntity(uint32_t index) const {
+			if (index >= generations.size() || !alive[index]) {
+				return VortexEntity{};
+			}
+			return VortexEntity{ index, generations[index] };
+		}
+
+		uint32_t getEntityCount() const { return entityCount; }
+		// One past the highest entity index ever handed out, for arrays indexed by entity index
+		uint32_t getEntityCapacity() const { return static_cast<uint32_t>(generations.size()); }
+
+		template<typename T, typename... Args>
+		T& addComponent(VortexEntity entity, Args&&... args) {
+			assert(isAlive(entity) && "Cannot add a component to a dead entity");
+			return getPool<T>().emplace(entity.index, std::forward<Args>(args)...);
+		}
+
+		template<typename T>
+		void removeComponent(VortexEntity entity) {
+			if (isAlive(entity)) {
+				getPool<T>().remove(entity.index);
+			}
+		}
+
+		template<typename T>
+		bool hasComponent(VortexEntity entity) const {
+			const VortexComponentPoolBase* pool = findPool(componentType<T>());
+			return isAlive(entity) && pool && pool->contains(entity.index);
+		}
+
+		template<typename T>
+		T* tryGetComponent(VortexEntity entity) {
+			return isAlive(entity) ? getPool<T>().tryGet(entity.index) : nullptr;
+		}
+
+		template<typename T>
+		T& getComponent(VortexEntity entity) {
+			assert(isAlive(entity) && "Cannot get a component of a dead entity");
+			return getPool<T>().get(entity.index);
+		}
+
+		template<typename T>
+		VortexComponentPool<T>& getPool() {
+			uint32_t type = componentType<T>();
+			if (type >= pools.size()) {
+				pools.resize(static_cast<size_t>(type) + 1);
+			}
+			if (!pools[type]) {
+				pools[type] = std::make_unique<VortexComponentPool<T>>();
+			}
+			return *static_cast<VortexComponentPool<T>*>(pools[type].get());
+		}
+
+		// Calls fn(VortexEntity, Ts&...) for every entity that has all of Ts
+		template<typename... Ts, typename Fn>
+		void each(Fn&& fn) {
+			static_assert(sizeof...(Ts) > 0, "each needs at least one component type");
+
+			if constexpr (sizeof...(Ts) == 1) {
+				// a single pool is already dense, no membership tests needed
+				auto& pool = getPool<Ts...>();
+				auto& components = pool.getComponents();
+				const auto& entities = pool.getEntities();
+				for (size_t i = 0; i < entities.size(); i++) {
+					fn(VortexEntity{ entities[i], generations[entities[i]] }, components[i]);
+				}
+			}
+			else {
+				std::tuple<VortexComponentPool<Ts>*...> queryPools{ &getPool<Ts>()... };
+
+				const VortexComponentPoolBase* smallest = nullptr;
+				std::apply([&smallest](auto*... pool) {
+					((smallest = !smallest || pool->size() < smallest->size() ? pool : smallest), ...);
+				}, queryPools);
+
+				for (uint32_t entityIndex : smallest->getEntities()) {
+					if ((std::get<VortexComponentPool<Ts>*>(queryPools)->contains(entityIndex) && ...)) {
+						fn(VortexEntity{ entityIndex, generations[entityIndex] },
+							std::get<VortexComponentPool<Ts>*>(queryPools)->get(entityIndex)...);
+					}
+				}
+			}
+		}
+
+	private:
+		static uint32_t nextComponentType();
+
+		template<typename T>
+		static uint32_t componentType() {
+			static const uint32_t type = nextComponentType();
+			return type;
+		}
+
+		const VortexComponentPoolBase* findPool(uint32_t type) const {
+			return type < pools.size() ? pools[type].get() : nullptr;
+		}
+
+		std::vector<uint32_t> generations{};
+		std::vector<uint8_t> alive{};
+		std::vector<uint32_t> freeIndices{};
+		uint32_t entityCount = 0;
+
+		// indexed by componentType<T>()
+		std::vector<std::unique_ptr<VortexComponentPoolBase>> pools{};
+	};
+}
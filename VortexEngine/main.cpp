@@ -4,10 +4,10 @@
 #include <iostream>
 #include <stdexcept>
 
-int main() {
-	VortexEngine::VortexApp app{};
-
+// See VortexApp::parseCommandLine for the options
+int main(int argc, char** argv) {
 	try {
+		VortexEngine::VortexApp app{ VortexEngine::VortexApp::parseCommandLine(argc, argv) };
 		app.run();
 	}
 	catch (const std::exception& e) {
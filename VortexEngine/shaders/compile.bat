@@ -1,5 +1,8 @@
 C:\VulkanSDK\1.3.296.0\Bin\glslc.exe C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\default.vert -o C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\default.vert.spv
 C:\VulkanSDK\1.3.296.0\Bin\glslc.exe C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\default.frag -o C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\default.frag.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe --target-env=vulkan1.1 -DBINDLESS C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\default.frag -o C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\default_bindless.frag.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\indirect.vert -o C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\indirect.vert.spv
+C:\VulkanSDK\1.3.296.0\Bin\glslc.exe C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\cull.comp -o C:\Users\judet\source\repos\VortexEngine\VortexEngine\shaders\cull.comp.spv
 
 echo Shader compilation completed.
 pause
\ No newline at end of file
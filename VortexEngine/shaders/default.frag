@@ -1,13 +1,108 @@
 #version 450
 
-layout(location = 0) out vec4 outColor;
+// Compiled twice, see compile.bat: as is, and with BINDLESS into default_bindless.frag.spv, which
+// reads its material from VortexBindlessTable (set 2) by the per instance material index. Set 1
+// is left to the vertex shader, see indirect.vert.
+#ifdef BINDLESS
+#extension GL_EXT_nonuniform_qualifier : require
+#endif
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragNormalWorld;
+layout(location = 2) in vec3 fragPosWorld;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+#ifdef BINDLESS
+layout(location = 3) in vec2 fragUv;
+layout(location = 4) flat in uint fragMaterialIndex;
+
+// see BindlessMaterialData
+struct MaterialData {
+	float opacity;
+	uint baseColorTexture;
+	uint baseColorSampler;
+	uint padding;
+};
+
+const uint NO_TEXTURE = 0xFFFFFFFF;
 
+layout(set = 2, binding = 0) uniform texture2D textures[];
+layout(set = 2, binding = 1) uniform sampler samplers[];
+layout(std430, set = 2, binding = 2) readonly buffer MaterialBuffer {
+	MaterialData materials[];
+} buffers[];
+
+// see BindlessPushConstants
 layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
+	uint materialBuffer;
 } push;
+#else
+// per material, see MaterialPushConstants
+layout(push_constant) uniform Material {
+	float opacity;
+} material;
+#endif
+
+// Set per pipeline variant (see MaterialComponent), so the untaken paths are compiled out
+// 0 = unlit, 1 = lambert, 2 = half lambert
+layout(constant_id = 0) const int LIGHTING_MODEL = 1;
+// false shades flat with the face normal instead of the interpolated vertex normal
+layout(constant_id = 1) const bool USE_VERTEX_NORMALS = true;
+// discards fragments in an ordered dither pattern covering 1 - opacity of the surface
+layout(constant_id = 2) const bool ALPHA_TEST = false;
+
+const float AMBIENT = 0.02;
+
+const float BAYER_4X4[16] = float[](
+	0.0 / 16.0,  8.0 / 16.0,  2.0 / 16.0, 10.0 / 16.0,
+	12.0 / 16.0, 4.0 / 16.0, 14.0 / 16.0,  6.0 / 16.0,
+	3.0 / 16.0, 11.0 / 16.0,  1.0 / 16.0,  9.0 / 16.0,
+	15.0 / 16.0, 7.0 / 16.0, 13.0 / 16.0,  5.0 / 16.0
+);
 
 void main(){
-	outColor = vec4(fragColor, 1.0);
-}	
\ No newline at end of file
+#ifdef BINDLESS
+	// instances of different materials can share a draw, so the index is not uniform
+	MaterialData material = buffers[push.materialBuffer].materials[fragMaterialIndex];
+	vec3 baseColor = fragColor;
+	if (material.baseColorTexture != NO_TEXTURE) {
+		baseColor *= texture(sampler2D(
+			textures[nonuniformEXT(material.baseColorTexture)],
+			samplers[nonuniformEXT(material.baseColorSampler)]), fragUv).rgb;
+	}
+#else
+	vec3 baseColor = fragColor;
+#endif
+
+	if (ALPHA_TEST) {
+		ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+		if (material.opacity <= BAYER_4X4[pixel.y * 4 + pixel.x]) {
+			discard;
+		}
+	}
+
+	vec3 normal;
+	if (USE_VERTEX_NORMALS) {
+		normal = normalize(fragNormalWorld);
+	}
+	else {
+		normal = normalize(cross(dFdx(fragPosWorld), dFdy(fragPosWorld)));
+	}
+
+	float lightIntensity = 1.0;
+	if (LIGHTING_MODEL == 1) {
+		lightIntensity = AMBIENT + max(dot(normal, ubo.directionToLight), 0);
+	}
+	else if (LIGHTING_MODEL == 2) {
+		float halfLambert = dot(normal, ubo.directionToLight) * 0.5 + 0.5;
+		lightIntensity = AMBIENT + halfLambert * halfLambert;
+	}
+
+	outColor = vec4(lightIntensity * baseColor, 1.0);
+}
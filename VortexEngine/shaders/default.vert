@@ -3,28 +3,33 @@
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
-layout(location = 3) in vec3 uv;
+layout(location = 3) in vec2 uv;
+
+// per instance, see RenderSystem::InstanceData
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
+// only read by default.frag with BINDLESS
+layout(location = 12) in uint materialIndex;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormalWorld;
+layout(location = 2) out vec3 fragPosWorld;
+layout(location = 3) out vec2 fragUv;
+layout(location = 4) flat out uint fragMaterialIndex;
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
 	mat4 projectionViewMatrix;
 	vec3 directionToLight;
 } ubo;
 
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
-
-const float AMBIENT = 0.02;
-
 void main(){
-	gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
-
-	vec3 normalWorldSpace = normalize(mat3(push.normalMatrix) * normal);
-
-	float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
-
-	fragColor = lightIntensity * color;
+	vec4 positionWorld = modelMatrix * vec4(position, 1.0);
+	gl_Position = ubo.projectionViewMatrix * positionWorld;
+
+	// lighting happens in default.frag
+	fragNormalWorld = mat3(normalMatrix) * normal;
+	fragPosWorld = positionWorld.xyz;
+	fragColor = color;
+	fragUv = uv;
+	fragMaterialIndex = materialIndex;
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormalWorld;
+layout(location = 2) out vec3 fragPosWorld;
+// only read by default.frag with BINDLESS
+layout(location = 3) out vec2 fragUv;
+layout(location = 4) flat out uint fragMaterialIndex;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+struct ObjectData {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	vec4 boundingSphere;
+	uint drawIndex;
+	uint materialIndex;
+	uint padding[2];
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Objects {
+	ObjectData objects[];
+};
+
+// written by cull.comp, gl_InstanceIndex already includes the draw's firstInstance
+layout(std430, set = 1, binding = 1) readonly buffer Instances {
+	uint instanceObjects[];
+};
+
+void main(){
+	uint objectIndex = instanceObjects[gl_InstanceIndex];
+	mat4 modelMatrix = objects[objectIndex].modelMatrix;
+	mat4 normalMatrix = objects[objectIndex].normalMatrix;
+
+	vec4 positionWorld = modelMatrix * vec4(position, 1.0);
+	gl_Position = ubo.projectionViewMatrix * positionWorld;
+
+	// lighting happens in default.frag
+	fragNormalWorld = mat3(normalMatrix) * normal;
+	fragPosWorld = positionWorld.xyz;
+	fragColor = color;
+	fragUv = uv;
+	fragMaterialIndex = objects[objectIndex].materialIndex;
+}
\ No newline at end of file
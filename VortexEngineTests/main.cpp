@@ -0,0 +1,48 @@
+#include "vortex_test.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+namespace VortexEngine::Test {
+	void report(const char* name, double value, const char* unit) {
+		std::cout << "    " << name << ": " << value << " " << unit << "\n";
+	}
+}
+
+// VortexEngineTests [--bench] [filter]
+// Runs the tests, or with --bench the benchmarks, whose name contains filter.
+int main(int argc, char** argv) {
+	bool benchmarks = false;
+	const char* filter = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--bench") == 0) {
+			benchmarks = true;
+		}
+		else {
+			filter = argv[i];
+		}
+	}
+
+	int run = 0;
+	int failed = 0;
+	for (const auto& testCase : VortexEngine::Test::getCases()) {
+		if (testCase.benchmark != benchmarks || (filter && !std::strstr(testCase.name, filter))) {
+			continue;
+		}
+
+		std::cout << testCase.name << "\n";
+		run++;
+		try {
+			testCase.run();
+		}
+		catch (const std::exception& e) {
+			std::cout << "    FAILED " << e.what() << "\n";
+			failed++;
+		}
+	}
+
+	std::cout << run - failed << "/" << run << (benchmarks ? " benchmarks" : " tests") << " passed\n";
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,239 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_bvh.h"
+
+//std includes
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace VortexEngine;
+
+namespace {
+	std::vector<VortexAABB> randomBoxes(size_t count, float worldSize, std::mt19937& random) {
+		std::uniform_real_distribution<float> position{ -worldSize, worldSize };
+		std::uniform_real_distribution<float> size{ 0.1f, 2.0f };
+
+		std::vector<VortexAABB> boxes(count);
+		for (auto& box : boxes) {
+			glm::vec3 min{ position(random), position(random), position(random) };
+			box = VortexAABB{ min, min + glm::vec3{ size(random), size(random), size(random) } };
+		}
+		return boxes;
+	}
+
+	// frustum shaped like the box, planes pointing inward
+	VortexFrustum boxFrustum(const VortexAABB& box) {
+		return VortexFrustum{ std::array<glm::vec4, 6>{
+			glm::vec4{ 1.0f, 0.0f, 0.0f, -box.min.x },
+			glm::vec4{ -1.0f, 0.0f, 0.0f, box.max.x },
+			glm::vec4{ 0.0f, 1.0f, 0.0f, -box.min.y },
+			glm::vec4{ 0.0f, -1.0f, 0.0f, box.max.y },
+			glm::vec4{ 0.0f, 0.0f, 1.0f, -box.min.z },
+			glm::vec4{ 0.0f, 0.0f, -1.0f, box.max.z } } };
+	}
+
+	// slab test, entry distance or -1 for a miss
+	float rayEntry(const VortexAABB& box, const glm::vec3& origin, const glm::vec3& direction) {
+		float entry = 0.0f;
+		float exit = std::numeric_limits<float>::max();
+		for (int axis = 0; axis < 3; axis++) {
+			float near = (box.min[axis] - origin[axis]) / direction[axis];
+			float far = (box.max[axis] - origin[axis]) / direction[axis];
+			entry = std::max(entry, std::min(near, far));
+			exit = std::min(exit, std::max(near, far));
+		}
+		return entry <= exit ? entry : -1.0f;
+	}
+
+	std::vector<uint32_t> sorted(std::vector<uint32_t> ids) {
+		std::sort(ids.begin(), ids.end());
+		return ids;
+	}
+
+	std::vector<uint32_t> bruteForceOverlap(const std::vector<VortexAABB>& boxes, const VortexAABB& query) {
+		std::vector<uint32_t> ids;
+		for (uint32_t i = 0; i < boxes.size(); i++) {
+			if (query.overlaps(boxes[i])) {
+				ids.push_back(i);
+			}
+		}
+		return ids;
+	}
+}
+
+VORTEX_TEST(bvhQueriesMatchBruteForce) {
+	std::mt19937 random{ 7 };
+	for (size_t count : { size_t{ 1 }, size_t{ 3 }, size_t{ 4 }, size_t{ 5 }, size_t{ 100 }, size_t{ 5000 } }) {
+		auto boxes = randomBoxes(count, 50.0f, random);
+		VortexBVH bvh;
+		bvh.build(boxes);
+		VORTEX_CHECK_EQUAL(bvh.getItemCount(), static_cast<uint32_t>(count));
+
+		auto queries = randomBoxes(50, 50.0f, random);
+		for (auto& query : queries) {
+			query.max = query.max + glm::vec3{ 10.0f };
+
+			std::vector<uint32_t> overlapping;
+			bvh.queryOverlap(query, overlapping);
+			VORTEX_CHECK(sorted(overlapping) == bruteForceOverlap(boxes, query));
+
+			VortexFrustum frustum = boxFrustum(query);
+			std::vector<uint32_t> visible;
+			bvh.queryFrustum(frustum, visible);
+			std::vector<uint32_t> expected;
+			for (uint32_t i = 0; i < boxes.size(); i++) {
+				if (frustum.intersectsAABB(boxes[i])) {
+					expected.push_back(i);
+				}
+			}
+			VORTEX_CHECK(sorted(visible) == expected);
+		}
+	}
+}
+
+VORTEX_TEST(bvhRaycastFindsClosestBox) {
+	std::mt19937 random{ 11 };
+	auto boxes = randomBoxes(2000, 30.0f, random);
+	VortexBVH bvh;
+	bvh.build(boxes);
+
+	std::uniform_real_distribution<float> unit{ -1.0f, 1.0f };
+	for (int ray = 0; ray < 500; ray++) {
+		glm::vec3 origin{ unit(random) * 40.0f, unit(random) * 40.0f, unit(random) * 40.0f };
+		glm::vec3 direction{ unit(random), unit(random), unit(random) };
+
+		float closest = std::numeric_limits<float>::max();
+		for (const auto& box : boxes) {
+			float entry = rayEntry(box, origin, direction);
+			if (entry >= 0.0f) {
+				closest = std::min(closest, entry);
+			}
+		}
+
+		auto hit = bvh.raycast(origin, direction);
+		if (closest == std::numeric_limits<float>::max()) {
+			VORTEX_CHECK(!hit.isValid());
+		}
+		else {
+			VORTEX_CHECK(hit.isValid());
+			VORTEX_CHECK(std::fabs(hit.distance - closest) <= 1e-4f * std::max(1.0f, closest));
+			VORTEX_CHECK(std::fabs(rayEntry(boxes[hit.item], origin, direction) - hit.distance) <= 1e-4f * std::max(1.0f, closest));
+		}
+	}
+}
+
+VORTEX_TEST(bvhRefitTracksMovedBoxes) {
+	std::mt19937 random{ 13 };
+	auto boxes = randomBoxes(3000, 50.0f, random);
+	std::vector<uint32_t> ids(boxes.size());
+	for (uint32_t i = 0; i < ids.size(); i++) {
+		ids[i] = 1000 + i;
+	}
+	VortexBVH bvh;
+	bvh.build(boxes, ids);
+
+	std::uniform_real_distribution<float> offset{ -20.0f, 20.0f };
+	std::vector<uint32_t> changed;
+	for (uint32_t i = 0; i < boxes.size(); i += 7) {
+		glm::vec3 move{ offset(random), offset(random), offset(random) };
+		boxes[i] = VortexAABB{ boxes[i].min + move, boxes[i].max + move };
+		changed.push_back(i);
+	}
+	bvh.refit(boxes, changed);
+
+	auto queries = randomBoxes(50, 50.0f, random);
+	for (auto& query : queries) {
+		query.max = query.max + glm::vec3{ 15.0f };
+
+		std::vector<uint32_t> overlapping;
+		bvh.queryOverlap(query, overlapping);
+		auto expected = bruteForceOverlap(boxes, query);
+		for (auto& id : expected) {
+			id += 1000;
+		}
+		VORTEX_CHECK(sorted(overlapping) == expected);
+	}
+
+	// a full refit agrees with the partial one
+	VortexBVH fullyRefit;
+	fullyRefit.build(randomBoxes(3000, 50.0f, random));
+	fullyRefit.refit(boxes);
+	for (auto& query : queries) {
+		std::vector<uint32_t> overlapping;
+		fullyRefit.queryOverlap(query, overlapping);
+		VORTEX_CHECK(sorted(overlapping) == bruteForceOverlap(boxes, query));
+	}
+}
+
+VORTEX_BENCHMARK(bvhBuildRefitAndQueries) {
+	std::mt19937 random{ 3 };
+	for (size_t count : { size_t{ 10000 }, size_t{ 100000 }, size_t{ 1000000 } }) {
+		// same density at every size
+		float worldSize = 500.0f * std::cbrt(static_cast<float>(count) / 100000.0f);
+		auto boxes = randomBoxes(count, worldSize, random);
+		VortexBVH bvh;
+		double buildMilliseconds = Test::measure([&] { bvh.build(boxes); });
+
+		std::vector<uint32_t> changed;
+		for (uint32_t i = 0; i < boxes.size(); i += 10) {
+			changed.push_back(i);
+		}
+		double refitMilliseconds = Test::measure([&] { bvh.refit(boxes, changed); });
+
+		// a view over the middle eighth of the world
+		VortexFrustum frustum = boxFrustum(VortexAABB{ glm::vec3{ -worldSize * 0.5f }, glm::vec3{ worldSize * 0.5f } });
+		std::vector<uint32_t> visible;
+		double queryMilliseconds = Test::measure([&] {
+			visible.clear();
+			bvh.queryFrustum(frustum, visible);
+		});
+		double bruteForceMilliseconds = Test::measure([&] {
+			visible.clear();
+			for (uint32_t i = 0; i < boxes.size(); i++) {
+				if (frustum.intersectsAABB(boxes[i])) {
+					visible.push_back(i);
+				}
+			}
+		});
+
+		// batches of small overlap queries and rays from anywhere in the world
+		constexpr size_t batchSize = 1000;
+		std::uniform_real_distribution<float> position{ -worldSize, worldSize };
+		std::uniform_real_distribution<float> direction{ -1.0f, 1.0f };
+		std::vector<VortexAABB> overlapQueries(batchSize);
+		std::vector<std::pair<glm::vec3, glm::vec3>> rays(batchSize);
+		for (size_t i = 0; i < batchSize; i++) {
+			glm::vec3 min{ position(random), position(random), position(random) };
+			overlapQueries[i] = VortexAABB{ min, min + glm::vec3{ 5.0f } };
+			rays[i] = { glm::vec3{ position(random), position(random), position(random) },
+				glm::vec3{ direction(random), direction(random), direction(random) } };
+		}
+
+		std::vector<uint32_t> overlapping;
+		double overlapMilliseconds = Test::measure([&] {
+			for (const auto& query : overlapQueries) {
+				overlapping.clear();
+				bvh.queryOverlap(query, overlapping);
+			}
+		});
+		uint32_t hits = 0;
+		double raycastMilliseconds = Test::measure([&] {
+			for (const auto& [origin, rayDirection] : rays) {
+				hits += bvh.raycast(origin, rayDirection).isValid() ? 1 : 0;
+			}
+		});
+		VORTEX_CHECK(hits > 0);
+
+		std::string items = std::to_string(count) + " items";
+		Test::report((items + " build").c_str(), buildMilliseconds, "ms");
+		Test::report((items + " refit 10%").c_str(), refitMilliseconds, "ms");
+		Test::report((items + " frustum query").c_str(), queryMilliseconds, "ms");
+		Test::report((items + " frustum brute force").c_str(), bruteForceMilliseconds, "ms");
+		Test::report((items + " overlap queries").c_str(), batchSize / overlapMilliseconds * 1e3, "queries per second");
+		Test::report((items + " raycasts").c_str(), batchSize / raycastMilliseconds * 1e3, "rays per second");
+	}
+}
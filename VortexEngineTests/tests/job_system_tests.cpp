@@ -0,0 +1,259 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_job_system.h"
+
+//std includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace VortexEngine;
+
+VORTEX_TEST(jobSystemRunsHighPriorityBackgroundJobsFirst) {
+	VortexJobSystem jobSystem{ 1 };
+	VortexJobCounter counter;
+
+	// keeps the only worker busy while the rest is queued
+	std::atomic<bool> started{ false };
+	std::atomic<bool> release{ false };
+	jobSystem.runBackground([&]() {
+		started = true;
+		while (!release) {
+			std::this_thread::yield();
+		}
+	}, &counter);
+	while (!started) {
+		std::this_thread::yield();
+	}
+
+	std::mutex orderMutex;
+	std::vector<int> order;
+	auto record = [&](int id) {
+		return [&order, &orderMutex, id]() {
+			std::lock_guard<std::mutex> lock{ orderMutex };
+			order.push_back(id);
+		};
+	};
+	jobSystem.runBackground(record(0), &counter);
+	jobSystem.runBackground(record(1), &counter);
+	jobSystem.runBackground(record(2), &counter, VortexJobSystem::Priority::High);
+	jobSystem.runBackground(record(3), &counter, VortexJobSystem::Priority::High);
+
+	release = true;
+	jobSystem.wait(counter);
+
+	VORTEX_CHECK_EQUAL(order.size(), size_t{ 4 });
+	VORTEX_CHECK_EQUAL(order[0], 2);
+	VORTEX_CHECK_EQUAL(order[1], 3);
+	VORTEX_CHECK_EQUAL(order[2], 0);
+	VORTEX_CHECK_EQUAL(order[3], 1);
+}
+
+VORTEX_TEST(jobSystemRunsEveryJobUnderContention) {
+	VortexJobSystem jobSystem{ 4 };
+	VortexJobCounter counter;
+	std::atomic<uint64_t> sum{ 0 };
+
+	// outside threads queue into the shared deque while jobs queue into their workers' own deques,
+	// and every nested job waits on its children, so idle workers have to steal to finish
+	const int producers = 4;
+	const int jobsPerProducer = 2000;
+	const int childrenPerJob = 4;
+	std::vector<std::thread> threads;
+	for (int producer = 0; producer < producers; producer++) {
+		threads.emplace_back([&]() {
+			for (int i = 0; i < jobsPerProducer; i++) {
+				jobSystem.run([&]() {
+					VortexJobCounter children;
+					for (int child = 0; child < childrenPerJob; child++) {
+						jobSystem.run([&sum]() { sum++; }, &children);
+					}
+					jobSystem.wait(children);
+					sum++;
+				}, &counter);
+			}
+		});
+	}
+	for (auto& thread : threads) {
+		thread.join();
+	}
+	jobSystem.wait(counter);
+
+	VORTEX_CHECK(counter.isDone());
+	VORTEX_CHECK_EQUAL(sum.load(), uint64_t{ producers * jobsPerProducer * (childrenPerJob + 1) });
+}
+
+VORTEX_TEST(jobSystemStartsJobsAfterTheirDependency) {
+	VortexJobSystem jobSystem{ 4 };
+
+	for (int round = 0; round < 200; round++) {
+		VortexJobCounter first;
+		VortexJobCounter second;
+		std::atomic<int> finished{ 0 };
+		std::atomic<bool> ranEarly{ false };
+
+		for (int i = 0; i < 8; i++) {
+			jobSystem.run([&finished]() {
+				std::this_thread::yield();
+				finished++;
+			}, &first);
+		}
+		for (int i = 0; i < 8; i++) {
+			jobSystem.run([&]() {
+				if (finished.load() != 8) {
+					ranEarly = true;
+				}
+			}, &second, &first);
+		}
+		jobSystem.wait(second);
+
+		VORTEX_CHECK(!ranEarly);
+	}
+}
+
+VORTEX_TEST(jobSystemParallelForCoversRangeOnce) {
+	VortexJobSystem jobSystem{ 3 };
+
+	for (size_t count : { size_t{ 0 }, size_t{ 1 }, size_t{ 63 }, size_t{ 64 }, size_t{ 65 }, size_t{ 10007 } }) {
+		std::vector<std::atomic<int>> visits(count);
+		jobSystem.parallelFor(count, 64, [&visits](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; i++) {
+				visits[i]++;
+			}
+		});
+
+		for (size_t i = 0; i < count; i++) {
+			VORTEX_CHECK_EQUAL(visits[i].load(), 1);
+		}
+	}
+}
+
+VORTEX_BENCHMARK(jobSystemEmptyJobOverhead) {
+	VortexJobSystem jobSystem{};
+	const int jobs = 10000;
+
+	double milliseconds = Test::measure([&] {
+		VortexJobCounter counter;
+		for (int i = 0; i < jobs; i++) {
+			jobSystem.run([]() {}, &counter);
+		}
+		jobSystem.wait(counter);
+	});
+	Test::report("run + wait", milliseconds * 1e6 / jobs, "ns per job");
+	Test::report("workers", jobSystem.getWorkerCount(), "threads");
+}
+
+VORTEX_BENCHMARK(jobSystemNestedJobScaling) {
+	// uneven nested work, the case work stealing is for
+	auto work = [](VortexJobSystem& jobSystem, std::atomic<uint64_t>& sink) {
+		VortexJobCounter counter;
+		for (int i = 0; i < 64; i++) {
+			jobSystem.run([&jobSystem, &sink, i]() {
+				VortexJobCounter children;
+				for (int child = 0; child < 1 + i % 8; child++) {
+					jobSystem.run([&sink]() {
+						uint64_t value = 0;
+						for (int step = 0; step < 20000; step++) {
+							value = value * 6364136223846793005ull + 1442695040888963407ull;
+						}
+						sink += value;
+					}, &children);
+				}
+				jobSystem.wait(children);
+			}, &counter);
+		}
+		jobSystem.wait(counter);
+	};
+
+	std::atomic<uint64_t> sink{ 0 };
+	VortexJobSystem single{ 1 };
+	double singleMilliseconds = Test::measure([&] { work(single, sink); });
+	VortexJobSystem all{};
+	double allMilliseconds = Test::measure([&] { work(all, sink); });
+
+	Test::report("1 worker", singleMilliseconds, "ms");
+	Test::report("all workers", allMilliseconds, "ms");
+	Test::report("speedup", singleMilliseconds / allMilliseconds, "x");
+}
+
+VORTEX_BENCHMARK(jobSystemRecordingFanOut) {
+	// RenderSystem::renderGameObjectsParallel's split: contiguous batch ranges, at least 64 batches
+	// per worker, one parallelFor job per worker. Vulkan recording needs a device, so each worker
+	// appends a stand-in command stream of the same shape (state binds on variant changes, buffer
+	// binds, push constants, draw) to its own reused buffer, the way a reset command pool is reused.
+	// Real recording costs come from running the app with --headless=N --recording-workers=K.
+	struct Command {
+		uint32_t type;
+		uint32_t arguments[7];
+	};
+	const size_t minBatchesPerWorker = 64;
+
+	VortexJobSystem jobSystem{};
+	for (size_t batches : { size_t{ 100 }, size_t{ 1000 }, size_t{ 10000 } }) {
+		for (uint32_t maxWorkers : { 1u, 2u, 4u, 8u }) {
+			std::vector<std::vector<Command>> commandBuffers(maxWorkers);
+
+			double milliseconds = Test::measure([&] {
+				size_t wantedWorkers = (batches + minBatchesPerWorker - 1) / minBatchesPerWorker;
+				uint32_t workerCount = static_cast<uint32_t>(std::clamp<size_t>(wantedWorkers, 1, maxWorkers));
+
+				jobSystem.parallelFor(workerCount, 1, [&](size_t first, size_t last) {
+					for (size_t worker = first; worker < last; worker++) {
+						size_t firstBatch = batches * worker / workerCount;
+						size_t lastBatch = batches * (worker + 1) / workerCount;
+
+						auto& commands = commandBuffers[worker];
+						commands.clear();
+						for (size_t batch = firstBatch; batch < lastBatch; batch++) {
+							uint32_t id = static_cast<uint32_t>(batch);
+							if (batch == firstBatch || batch % 16 == 0) {
+								commands.push_back({ 0, { id } });
+								commands.push_back({ 1, { id, id } });
+							}
+							commands.push_back({ 2, { id, id, id } });
+							commands.push_back({ 3, { id, 4, 0, id } });
+							commands.push_back({ 4, { id * 3, 1, 0, 0, id } });
+						}
+					}
+				});
+			});
+
+			std::string name = std::to_string(batches) + " batches, up to " + std::to_string(maxWorkers) + " workers";
+			Test::report(name.c_str(), milliseconds * 1e3, "us");
+		}
+	}
+}
+
+VORTEX_BENCHMARK(jobSystemBackgroundPriorityLatency) {
+	// a pipeline compile queued behind a scene's worth of model loads. Frames draw with the
+	// fallback until it starts, so start latency stands in for hitch time here; the worst frame
+	// itself needs a device, run the engine with --headless=N for it.
+	using clock = std::chrono::high_resolution_clock;
+	const int loads = 100;
+	auto busyWork = []() {
+		auto end = clock::now() + std::chrono::microseconds(200);
+		while (clock::now() < end) {
+		}
+	};
+
+	for (auto priority : { VortexJobSystem::Priority::Normal, VortexJobSystem::Priority::High }) {
+		VortexJobSystem jobSystem{ 1 };
+		VortexJobCounter counter;
+		for (int i = 0; i < loads; i++) {
+			jobSystem.runBackground(busyWork, &counter);
+		}
+
+		auto queued = clock::now();
+		std::atomic<int64_t> startedMicroseconds{ 0 };
+		jobSystem.runBackground([&]() {
+			startedMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(clock::now() - queued).count();
+		}, &counter, priority);
+		jobSystem.wait(counter);
+
+		Test::report(priority == VortexJobSystem::Priority::High ? "high priority start latency" : "normal priority start latency",
+			startedMicroseconds / 1000.0, "ms");
+	}
+}
@@ -0,0 +1,170 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_mesh_cache.h"
+
+//std includes
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace VortexEngine;
+
+namespace {
+	// fresh directory holding a fake source mesh and the cache
+	struct CacheDirectory {
+		std::filesystem::path root;
+		std::string sourcePath;
+
+		explicit CacheDirectory(const char* name) {
+			root = std::filesystem::temp_directory_path() / name;
+			std::filesystem::remove_all(root);
+			std::filesystem::create_directories(root);
+			sourcePath = (root / "mesh.obj").string();
+			writeSource("v 0 0 0\n");
+			VortexMeshCache::setCacheDirectory((root / "cache").string());
+		}
+
+		~CacheDirectory() {
+			std::error_code error;
+			std::filesystem::remove_all(root, error);
+		}
+
+		void writeSource(const std::string& contents) {
+			std::ofstream file{ sourcePath, std::ios::binary | std::ios::trunc };
+			file << contents;
+		}
+	};
+
+	VortexModel::Builder randomMesh(uint32_t vertexCount, std::mt19937& random) {
+		std::uniform_real_distribution<float> value{ -1.0f, 1.0f };
+
+		VortexModel::Builder builder{};
+		builder.vertices.resize(vertexCount);
+		for (auto& vertex : builder.vertices) {
+			vertex.position = { value(random), value(random), value(random) };
+			vertex.color = { value(random), value(random), value(random) };
+			vertex.normal = { value(random), value(random), value(random) };
+			vertex.uv = { value(random), value(random) };
+		}
+		builder.indices.resize(vertexCount * 3);
+		for (auto& index : builder.indices) {
+			index = random() % vertexCount;
+		}
+		builder.computeBounds();
+		return builder;
+	}
+}
+
+VORTEX_TEST(meshCacheRoundTripsGeometry) {
+	CacheDirectory directory{ "vortex_mesh_cache_round_trip" };
+	std::mt19937 random{ 41 };
+	auto builder = randomMesh(1001, random);
+
+	VORTEX_CHECK(VortexMeshCache::load(directory.sourcePath) == nullptr);
+	VORTEX_CHECK(VortexMeshCache::store(directory.sourcePath, builder));
+
+	auto mesh = VortexMeshCache::load(directory.sourcePath);
+	VORTEX_CHECK(mesh != nullptr);
+	VORTEX_CHECK_EQUAL(mesh->getVertexCount(), static_cast<uint32_t>(builder.vertices.size()));
+	VORTEX_CHECK_EQUAL(mesh->getIndexCount(), static_cast<uint32_t>(builder.indices.size()));
+	for (uint32_t i = 0; i < mesh->getVertexCount(); i++) {
+		VORTEX_CHECK(mesh->vertices()[i] == builder.vertices[i]);
+	}
+	for (uint32_t i = 0; i < mesh->getIndexCount(); i++) {
+		VORTEX_CHECK_EQUAL(mesh->indices()[i], builder.indices[i]);
+	}
+
+	// bounds come back from the header, a warm load never looks at the vertices
+	VORTEX_CHECK(mesh->getBoundingBox().min == builder.boundingBox.min);
+	VORTEX_CHECK(mesh->getBoundingBox().max == builder.boundingBox.max);
+	for (int component = 0; component < 4; component++) {
+		VORTEX_CHECK_EQUAL(mesh->getBoundingSphere()[component], builder.boundingSphere[component]);
+	}
+}
+
+VORTEX_TEST(meshCacheRejectsStaleAndDamagedEntries) {
+	CacheDirectory directory{ "vortex_mesh_cache_stale" };
+	std::mt19937 random{ 42 };
+	auto builder = randomMesh(64, random);
+
+	VORTEX_CHECK(VortexMeshCache::store(directory.sourcePath, builder));
+	VORTEX_CHECK(VortexMeshCache::load(directory.sourcePath) != nullptr);
+
+	// the source changed size since the entry was written
+	directory.writeSource("v 0 0 0\nv 1 1 1\n");
+	VORTEX_CHECK(VortexMeshCache::load(directory.sourcePath) == nullptr);
+
+	VORTEX_CHECK(VortexMeshCache::store(directory.sourcePath, builder));
+	VORTEX_CHECK(VortexMeshCache::load(directory.sourcePath) != nullptr);
+
+	// truncated entries must not hand out pointers past the end of the file
+	std::string cachePath = VortexMeshCache::cacheFilePath(directory.sourcePath);
+	auto cacheSize = std::filesystem::file_size(cachePath);
+	std::filesystem::resize_file(cachePath, cacheSize - 16);
+	VORTEX_CHECK(VortexMeshCache::load(directory.sourcePath) == nullptr);
+
+	std::filesystem::resize_file(cachePath, 8);
+	VORTEX_CHECK(VortexMeshCache::load(directory.sourcePath) == nullptr);
+
+	// an empty builder is not worth caching
+	VORTEX_CHECK(!VortexMeshCache::store(directory.sourcePath, VortexModel::Builder{}));
+}
+
+VORTEX_BENCHMARK(meshCacheColdAndWarmLoad) {
+	CacheDirectory directory{ "vortex_mesh_cache_benchmark" };
+
+	// a gridSize x gridSize quad grid, as an exporter would write it
+	const uint32_t gridSize = 400;
+	std::ostringstream obj;
+	for (uint32_t y = 0; y <= gridSize; y++) {
+		for (uint32_t x = 0; x <= gridSize; x++) {
+			obj << "v " << x << " " << y << " " << (x * y) % 7 << "\n";
+			obj << "vt " << static_cast<float>(x) / gridSize << " " << static_cast<float>(y) / gridSize << "\n";
+		}
+	}
+	obj << "vn 0 0 1\n";
+	for (uint32_t y = 0; y < gridSize; y++) {
+		for (uint32_t x = 0; x < gridSize; x++) {
+			uint32_t corner = y * (gridSize + 1) + x + 1;
+			uint32_t corners[4] = { corner, corner + 1, corner + gridSize + 2, corner + gridSize + 1 };
+			for (uint32_t triangle : { 0u, 2u }) {
+				obj << "f";
+				for (uint32_t i : { 0u, triangle == 0 ? 1u : 2u, triangle == 0 ? 2u : 3u }) {
+					obj << " " << corners[i] << "/" << corners[i] << "/1";
+				}
+				obj << "\n";
+			}
+		}
+	}
+	directory.writeSource(obj.str());
+
+	// cold: what createModelFromFile does without a cache entry, parse and dedup the OBJ, then store
+	double coldMilliseconds = Test::measure([&] {
+		VortexModel::Builder builder{};
+		builder.loadModel(directory.sourcePath);
+		VortexMeshCache::store(directory.sourcePath, builder);
+	});
+
+	// warm: map the entry, reading every byte once is what an upload would do next
+	volatile float sink = 0.0f;
+	uint32_t vertexCount = 0;
+	double warmMilliseconds = Test::measure([&] {
+		auto mesh = VortexMeshCache::load(directory.sourcePath);
+		float sum = 0.0f;
+		for (uint32_t i = 0; i < mesh->getVertexCount(); i++) {
+			sum += mesh->vertices()[i].position.x;
+		}
+		for (uint32_t i = 0; i < mesh->getIndexCount(); i++) {
+			sum += static_cast<float>(mesh->indices()[i]);
+		}
+		sink = sum;
+		vertexCount = mesh->getVertexCount();
+	});
+
+	Test::report("mesh size", vertexCount, "vertices");
+	Test::report("cold start, OBJ parse + dedup + store", coldMilliseconds, "ms");
+	Test::report("warm start, cache load + read", warmMilliseconds, "ms");
+	Test::report("speedup", coldMilliseconds / warmMilliseconds, "x");
+}
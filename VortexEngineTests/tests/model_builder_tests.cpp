@@ -0,0 +1,182 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_model.h"
+#include "../../VortexEngine/headers/vortex_job_system.h"
+
+//std includes
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace VortexEngine;
+
+namespace {
+	struct ObjFile {
+		std::string path;
+
+		ObjFile(const char* name, const std::string& contents) {
+			path = (std::filesystem::temp_directory_path() / name).string();
+			std::ofstream file{ path, std::ios::trunc };
+			file << contents;
+		}
+
+		~ObjFile() {
+			std::error_code error;
+			std::filesystem::remove(path, error);
+		}
+	};
+
+	using Vertex = VortexModel::Vertex;
+
+	struct VertexHash {
+		size_t operator()(const Vertex& vertex) const {
+			size_t seed = 0;
+			for (float value : { vertex.position.x, vertex.position.y, vertex.position.z, vertex.color.x, vertex.color.y,
+				vertex.color.z, vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.uv.x, vertex.uv.y }) {
+				seed ^= std::hash<float>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+			}
+			return seed;
+		}
+	};
+
+	// Line i of every attribute holds value i % distinctCount, so different lines repeat the same
+	// data the way exported files do. corners gets the vertex of every face corner.
+	std::string randomObj(uint32_t attributeCount, uint32_t distinctCount, uint32_t faceCount, std::mt19937& random,
+		std::vector<Vertex>& corners) {
+		std::ostringstream obj;
+		obj << std::setprecision(9);
+		for (uint32_t i = 1; i <= attributeCount; i++) {
+			float value = static_cast<float>(i % distinctCount);
+			obj << "v " << value << " " << value << " " << value << " " << value * 0.25f << " 0.5 1\n";
+			obj << "vt " << value + 0.5f << " " << value << "\n";
+			obj << "vn " << -value << " 0 1\n";
+		}
+
+		corners.clear();
+		for (uint32_t face = 0; face < faceCount; face++) {
+			obj << "f";
+			for (int corner = 0; corner < 3; corner++) {
+				// few distinct attributes per position so many triples repeat
+				int position = 1 + static_cast<int>(random() % attributeCount);
+				int texcoord = 1 + (position + static_cast<int>(random() % 2)) % static_cast<int>(attributeCount);
+				int normal = 1 + (position + static_cast<int>(random() % 2)) % static_cast<int>(attributeCount);
+				obj << " " << position << "/" << texcoord << "/" << normal;
+
+				Vertex vertex{};
+				float positionValue = static_cast<float>(position % distinctCount);
+				float texcoordValue = static_cast<float>(texcoord % distinctCount);
+				vertex.position = { positionValue, positionValue, positionValue };
+				vertex.color = { positionValue * 0.25f, 0.5f, 1.0f };
+				vertex.normal = { -static_cast<float>(normal % distinctCount), 0.0f, 1.0f };
+				vertex.uv = { texcoordValue + 0.5f, texcoordValue };
+				corners.push_back(vertex);
+			}
+			obj << "\n";
+		}
+		return obj.str();
+	}
+
+	// The loader as it was before it went parallel: one value-keyed map over every corner
+	void checkAgainstValueDedup(const VortexModel::Builder& builder, const std::vector<Vertex>& corners) {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::unordered_map<Vertex, uint32_t, VertexHash> uniqueVertices;
+		for (const auto& vertex : corners) {
+			auto inserted = uniqueVertices.emplace(vertex, static_cast<uint32_t>(vertices.size()));
+			if (inserted.second) {
+				vertices.push_back(vertex);
+			}
+			indices.push_back(inserted.first->second);
+		}
+
+		VORTEX_CHECK_EQUAL(builder.vertices.size(), vertices.size());
+		VORTEX_CHECK(builder.vertices == vertices);
+		VORTEX_CHECK(builder.indices == indices);
+	}
+}
+
+VORTEX_TEST(modelBuilderSharesVerticesOfEqualIndexTriples) {
+	// a quad as two triangles, then a triangle reusing a position with another normal
+	ObjFile obj{ "vortex_model_builder_quad.obj",
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\n"
+		"vn 0 0 1\nvn 0 0 -1\n"
+		"f 1/1/1 2/2/1 3/3/1\n"
+		"f 1/1/1 3/3/1 4/4/1\n"
+		"f 1/1/2 2/2/2 3/3/1\n" };
+
+	VortexModel::Builder builder{};
+	builder.loadModel(obj.path);
+
+	VORTEX_CHECK_EQUAL(builder.indices.size(), size_t{ 9 });
+	VORTEX_CHECK_EQUAL(builder.vertices.size(), size_t{ 6 });
+	VORTEX_CHECK_EQUAL(builder.indices[3], builder.indices[0]);
+	VORTEX_CHECK_EQUAL(builder.indices[4], builder.indices[2]);
+	VORTEX_CHECK(builder.indices[6] != builder.indices[0]);
+	VORTEX_CHECK_EQUAL(builder.indices[8], builder.indices[2]);
+	VORTEX_CHECK_EQUAL(builder.vertices[builder.indices[6]].normal.z, -1.0f);
+
+	VORTEX_CHECK((builder.boundingBox.min == glm::vec3{ 0.0f, 0.0f, 0.0f }));
+	VORTEX_CHECK((builder.boundingBox.max == glm::vec3{ 1.0f, 1.0f, 0.0f }));
+	VORTEX_CHECK_EQUAL(builder.boundingSphere.x, 0.5f);
+	VORTEX_CHECK_EQUAL(builder.boundingSphere.w, std::sqrt(0.5f));
+}
+
+VORTEX_TEST(modelBuilderMergesEqualVerticesFromDifferentLines) {
+	// the second triangle repeats the first one's data on new v / vt / vn lines
+	ObjFile obj{ "vortex_model_builder_repeated.obj",
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 0 0\nv 1 0 0\nv 1 1 0\n"
+		"vt 0 0\nvt 1 0\nvt 0 0\n"
+		"vn 0 0 1\nvn 0 0 1\n"
+		"f 1/1/1 2/2/1 3/1/1\n"
+		"f 4/3/2 5/2/2 6/3/2\n" };
+
+	VortexModel::Builder builder{};
+	builder.loadModel(obj.path);
+
+	VORTEX_CHECK_EQUAL(builder.vertices.size(), size_t{ 3 });
+	VORTEX_CHECK((builder.indices == std::vector<uint32_t>{ 0, 1, 2, 0, 1, 2 }));
+}
+
+VORTEX_TEST(modelBuilderMatchesValueDedup) {
+	std::mt19937 random{ 51 };
+	std::vector<Vertex> corners;
+	// well past the size the loader hands out to the job system
+	ObjFile obj{ "vortex_model_builder_large.obj", randomObj(20000, 5000, 60000, random, corners) };
+
+	VortexModel::Builder serial{};
+	serial.loadModel(obj.path);
+	checkAgainstValueDedup(serial, corners);
+
+	VortexJobSystem jobSystem{ 3 };
+	VortexModel::Builder parallel{};
+	parallel.loadModel(obj.path, &jobSystem);
+	checkAgainstValueDedup(parallel, corners);
+}
+
+VORTEX_BENCHMARK(modelBuilderLoad) {
+	std::mt19937 random{ 52 };
+	std::vector<Vertex> corners;
+	ObjFile obj{ "vortex_model_builder_benchmark.obj", randomObj(200000, 50000, 400000, random, corners) };
+	const double vertexCount = static_cast<double>(corners.size());
+
+	double serialMilliseconds = Test::measure([&] {
+		VortexModel::Builder builder{};
+		builder.loadModel(obj.path);
+	});
+
+	VortexJobSystem jobSystem{};
+	double parallelMilliseconds = Test::measure([&] {
+		VortexModel::Builder builder{};
+		builder.loadModel(obj.path, &jobSystem);
+	});
+
+	// face vertices read from the file, before deduplication
+	Test::report("1.2M vertices, parse + dedup", vertexCount / serialMilliseconds * 1e3, "vertices per second");
+	Test::report("1.2M vertices, parse + dedup on the job system", vertexCount / parallelMilliseconds * 1e3, "vertices per second");
+}
@@ -0,0 +1,129 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_offset_allocator.h"
+
+//std includes
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace VortexEngine;
+
+namespace {
+	// sizes that are and aren't on a bin boundary, up to well past a geometry page
+	const uint64_t CAPACITIES[] = { 1, 15, 16, 17, 1000, 4096, 1048576, 1048577, 3000000, (1ull << 32) + 12345 };
+}
+
+VORTEX_TEST(offsetAllocatorAllocatesExactCapacity) {
+	for (uint64_t capacity : CAPACITIES) {
+		VortexOffsetAllocator allocator{ capacity };
+
+		auto allocation = allocator.allocate(capacity);
+		VORTEX_CHECK(allocation.isValid());
+		VORTEX_CHECK_EQUAL(allocation.offset, 0ull);
+		VORTEX_CHECK_EQUAL(allocation.size, capacity);
+		VORTEX_CHECK_EQUAL(allocator.getFreeSize(), 0ull);
+
+		VORTEX_CHECK(!allocator.allocate(1).isValid());
+	}
+}
+
+VORTEX_TEST(offsetAllocatorAllocatesCapacityAgainAfterFullFree) {
+	for (uint64_t capacity : CAPACITIES) {
+		if (capacity < 4) {
+			continue;
+		}
+		VortexOffsetAllocator allocator{ capacity };
+
+		std::vector<VortexOffsetAllocator::Allocation> allocations;
+		uint64_t quarter = capacity / 4;
+		for (int i = 0; i < 3; i++) {
+			allocations.push_back(allocator.allocate(quarter));
+		}
+		allocations.push_back(allocator.allocate(capacity - 3 * quarter));
+		for (const auto& allocation : allocations) {
+			VORTEX_CHECK(allocation.isValid());
+		}
+
+		// out of order, so every merge direction is exercised
+		allocator.free(allocations[1]);
+		allocator.free(allocations[3]);
+		allocator.free(allocations[0]);
+		allocator.free(allocations[2]);
+		VORTEX_CHECK(allocator.isEmpty());
+		VORTEX_CHECK_EQUAL(allocator.getLargestFreeRange(), capacity);
+
+		auto whole = allocator.allocate(capacity);
+		VORTEX_CHECK(whole.isValid());
+		VORTEX_CHECK_EQUAL(whole.size, capacity);
+	}
+}
+
+VORTEX_TEST(offsetAllocatorRespectsAlignment) {
+	VortexOffsetAllocator allocator{ 1 << 20 };
+
+	allocator.allocate(3);
+	for (uint64_t alignment = 1; alignment <= 4096; alignment *= 2) {
+		auto allocation = allocator.allocate(100, alignment);
+		VORTEX_CHECK(allocation.isValid());
+		VORTEX_CHECK_EQUAL(allocation.offset % alignment, 0ull);
+	}
+}
+
+VORTEX_TEST(offsetAllocatorRandomAllocationsNeverOverlap) {
+	const uint64_t capacity = 1 << 20;
+	VortexOffsetAllocator allocator{ capacity };
+	std::mt19937 random{ 1234 };
+
+	std::vector<VortexOffsetAllocator::Allocation> live;
+	for (int step = 0; step < 20000; step++) {
+		if (live.empty() || random() % 3 != 0) {
+			uint64_t size = 1 + random() % 5000;
+			uint64_t alignment = 1ull << (random() % 8);
+			auto allocation = allocator.allocate(size, alignment);
+			if (allocation.isValid()) {
+				VORTEX_CHECK(allocation.offset % alignment == 0);
+				VORTEX_CHECK(allocation.offset + allocation.size <= capacity);
+				live.push_back(allocation);
+			}
+		}
+		else {
+			size_t index = random() % live.size();
+			allocator.free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+	}
+
+	std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.offset < b.offset; });
+	uint64_t used = 0;
+	for (size_t i = 0; i < live.size(); i++) {
+		used += live[i].size;
+		if (i > 0) {
+			VORTEX_CHECK(live[i - 1].offset + live[i - 1].size <= live[i].offset);
+		}
+	}
+	VORTEX_CHECK_EQUAL(allocator.getUsedSize(), used);
+
+	for (const auto& allocation : live) {
+		allocator.free(allocation);
+	}
+	VORTEX_CHECK(allocator.allocate(capacity).isValid());
+}
+
+VORTEX_BENCHMARK(offsetAllocatorAllocateFree) {
+	VortexOffsetAllocator allocator{ 1ull << 30 };
+	std::mt19937 random{ 42 };
+	std::vector<VortexOffsetAllocator::Allocation> live;
+	live.reserve(4096);
+
+	double milliseconds = Test::measure([&] {
+		for (int i = 0; i < 4096; i++) {
+			live.push_back(allocator.allocate(1 + random() % 65536, 256));
+		}
+		for (const auto& allocation : live) {
+			allocator.free(allocation);
+		}
+		live.clear();
+	});
+	Test::report("allocate + free", milliseconds * 1e6 / 4096, "ns per pair");
+}
@@ -0,0 +1,374 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_transform_store.h"
+
+//std includes
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace VortexEngine;
+
+namespace {
+	TransformComponent randomTransform(std::mt19937& random) {
+		std::uniform_real_distribution<float> position{ -100.0f, 100.0f };
+		std::uniform_real_distribution<float> angle{ -3.14159265f, 3.14159265f };
+		std::uniform_real_distribution<float> scale{ 0.25f, 4.0f };
+
+		TransformComponent transform{};
+		transform.translation = { position(random), position(random), position(random) };
+		transform.rotation = { angle(random), angle(random), angle(random) };
+		transform.scale = { scale(random), scale(random), scale(random) };
+		return transform;
+	}
+
+	bool nearlyEqual(const glm::mat4& a, const glm::mat4& b) {
+		for (int column = 0; column < 4; column++) {
+			for (int row = 0; row < 4; row++) {
+				float tolerance = 1e-4f * std::max(1.0f, std::fabs(b[column][row]));
+				if (std::fabs(a[column][row] - b[column][row]) > tolerance) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool nearlyEqual(const glm::mat4& a, const glm::mat3& b) {
+		return nearlyEqual(glm::mat4{ glm::mat3{ a } }, glm::mat4{ b });
+	}
+}
+
+VORTEX_TEST(transformStoreMatchesComponentMatrices) {
+	std::mt19937 random{ 5 };
+	// not a multiple of the SSE batch width, so the scalar tail runs too
+	const uint32_t count = 1027;
+
+	VortexTransformStore store;
+	store.resize(count);
+	std::vector<TransformComponent> transforms(count);
+	for (uint32_t i = 0; i < count; i++) {
+		transforms[i] = randomTransform(random);
+		store.set(i, transforms[i]);
+	}
+	VORTEX_CHECK_EQUAL(store.update(), count);
+
+	for (uint32_t i = 0; i < count; i++) {
+		VORTEX_CHECK(nearlyEqual(store.getModelMatrix(i), transforms[i].mat4()));
+		VORTEX_CHECK(nearlyEqual(store.getNormalMatrix(i), transforms[i].normalMatrix()));
+	}
+}
+
+VORTEX_TEST(transformStoreOnlyUpdatesChangedTransforms) {
+	std::mt19937 random{ 6 };
+	const uint32_t count = 100;
+
+	VortexTransformStore store;
+	store.resize(count);
+	std::vector<TransformComponent> transforms(count);
+	for (uint32_t i = 0; i < count; i++) {
+		transforms[i] = randomTransform(random);
+		store.set(i, transforms[i]);
+	}
+	store.update();
+
+	// setting the same values again is not a change
+	for (uint32_t i = 0; i < count; i++) {
+		store.set(i, transforms[i]);
+	}
+	VORTEX_CHECK_EQUAL(store.update(), 0u);
+	VORTEX_CHECK(store.getUpdatedIndices().empty());
+
+	transforms[17].translation.x += 1.0f;
+	transforms[42].rotation.y += 0.5f;
+	store.set(17, transforms[17]);
+	store.set(42, transforms[42]);
+	VORTEX_CHECK_EQUAL(store.update(), 2u);
+
+	auto updated = store.getUpdatedIndices();
+	std::sort(updated.begin(), updated.end());
+	VORTEX_CHECK(updated == (std::vector<uint32_t>{ 17, 42 }));
+	VORTEX_CHECK(nearlyEqual(store.getModelMatrix(17), transforms[17].mat4()));
+	VORTEX_CHECK(nearlyEqual(store.getModelMatrix(42), transforms[42].mat4()));
+}
+
+VORTEX_TEST(transformStoreParallelUpdateMatchesSerial) {
+	std::mt19937 random{ 8 };
+	const uint32_t count = 20000;
+
+	VortexTransformStore serial;
+	VortexTransformStore parallel;
+	serial.resize(count);
+	parallel.resize(count);
+	for (uint32_t i = 0; i < count; i++) {
+		auto transform = randomTransform(random);
+		serial.set(i, transform);
+		parallel.set(i, transform);
+	}
+
+	VortexJobSystem jobSystem{ 3 };
+	serial.update();
+	parallel.update(&jobSystem);
+
+	for (uint32_t i = 0; i < count; i++) {
+		VORTEX_CHECK(nearlyEqual(parallel.getModelMatrix(i), serial.getModelMatrix(i)));
+		VORTEX_CHECK(nearlyEqual(parallel.getNormalMatrix(i), serial.getNormalMatrix(i)));
+	}
+}
+
+VORTEX_BENCHMARK(transformStoreLocalMatrices) {
+	std::mt19937 random{ 9 };
+	const uint32_t count = 50000;
+
+	std::vector<TransformComponent> transforms(count);
+	for (auto& transform : transforms) {
+		transform = randomTransform(random);
+	}
+
+	// the per object path the store replaces
+	std::vector<glm::mat4> models(count);
+	std::vector<glm::mat3> normals(count);
+	double componentMilliseconds = Test::measure([&] {
+		for (uint32_t i = 0; i < count; i++) {
+			models[i] = transforms[i].mat4();
+			normals[i] = transforms[i].normalMatrix();
+		}
+	});
+
+	VortexTransformStore store;
+	store.resize(count);
+	bool flip = false;
+	double storeMilliseconds = Test::measure([&] {
+		// every transform changes every run
+		flip = !flip;
+		for (uint32_t i = 0; i < count; i++) {
+			TransformComponent transform = transforms[i];
+			transform.translation.x += flip ? 1.0f : 0.0f;
+			store.set(i, transform);
+		}
+		store.update();
+	});
+
+	VortexJobSystem jobSystem{};
+	double parallelMilliseconds = Test::measure([&] {
+		flip = !flip;
+		for (uint32_t i = 0; i < count; i++) {
+			TransformComponent transform = transforms[i];
+			transform.translation.x += flip ? 1.0f : 0.0f;
+			store.set(i, transform);
+		}
+		store.update(&jobSystem);
+	});
+
+	Test::report("TransformComponent::mat4 + normalMatrix", componentMilliseconds * 1e6 / count, "ns per transform");
+	Test::report("store set + update", storeMilliseconds * 1e6 / count, "ns per transform");
+	Test::report("store set + parallel update", parallelMilliseconds * 1e6 / count, "ns per transform");
+}
+
+namespace {
+	// random forest over count transforms in shuffled order, about one in eight a root
+	std::vector<uint32_t> randomParents(uint32_t count, std::mt19937& random) {
+		std::vector<uint32_t> order(count);
+		for (uint32_t i = 0; i < count; i++) {
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), random);
+
+		std::vector<uint32_t> parents(count, VortexTransformStore::NO_PARENT);
+		for (uint32_t i = 1; i < count; i++) {
+			if (random() % 8 != 0) {
+				parents[order[i]] = order[random() % i];
+			}
+		}
+		return parents;
+	}
+
+	glm::mat4 referenceModel(uint32_t index, std::vector<TransformComponent>& transforms, const std::vector<uint32_t>& parents) {
+		glm::mat4 local = transforms[index].mat4();
+		if (parents[index] == VortexTransformStore::NO_PARENT) {
+			return local;
+		}
+		return referenceModel(parents[index], transforms, parents) * local;
+	}
+}
+
+VORTEX_TEST(transformStoreComposesHierarchy) {
+	std::mt19937 random{ 21 };
+	const uint32_t count = 2000;
+
+	VortexTransformStore store;
+	store.resize(count);
+	std::vector<TransformComponent> transforms(count);
+	auto parents = randomParents(count, random);
+	for (uint32_t i = 0; i < count; i++) {
+		// small scales keep deep chains in float range
+		transforms[i] = randomTransform(random);
+		transforms[i].translation = transforms[i].translation * 0.01f;
+		transforms[i].scale = glm::vec3{ 1.0f };
+		store.set(i, transforms[i]);
+		store.setParent(i, parents[i]);
+	}
+	store.update();
+
+	for (uint32_t i = 0; i < count; i++) {
+		VORTEX_CHECK(nearlyEqual(store.getModelMatrix(i), referenceModel(i, transforms, parents)));
+		VORTEX_CHECK(nearlyEqual(store.getLocalModelMatrix(i), transforms[i].mat4()));
+	}
+
+	// levels are laid out parents first
+	const auto& levels = store.getLevelOffsets();
+	VORTEX_CHECK(levels.size() >= 2);
+	VORTEX_CHECK_EQUAL(levels.back(), count);
+}
+
+VORTEX_TEST(transformStoreUpdatesDescendantsOfChangedTransforms) {
+	std::mt19937 random{ 22 };
+	const uint32_t count = 500;
+
+	VortexTransformStore store;
+	store.resize(count);
+	std::vector<TransformComponent> transforms(count);
+	auto parents = randomParents(count, random);
+	for (uint32_t i = 0; i < count; i++) {
+		transforms[i] = randomTransform(random);
+		transforms[i].translation = transforms[i].translation * 0.01f;
+		transforms[i].scale = glm::vec3{ 1.0f };
+		store.set(i, transforms[i]);
+		store.setParent(i, parents[i]);
+	}
+	store.update();
+
+	uint32_t moved = 0;
+	while (parents[moved] != VortexTransformStore::NO_PARENT) {
+		moved++;
+	}
+	transforms[moved].translation.y += 2.0f;
+	store.set(moved, transforms[moved]);
+	store.update();
+
+	// the moved root and everything below it, nothing else
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t ancestor = i;
+		while (ancestor != moved && parents[ancestor] != VortexTransformStore::NO_PARENT) {
+			ancestor = parents[ancestor];
+		}
+		if (ancestor == moved) {
+			expected.push_back(i);
+		}
+	}
+	auto updated = store.getUpdatedIndices();
+	std::sort(updated.begin(), updated.end());
+	VORTEX_CHECK(updated == expected);
+
+	for (uint32_t i = 0; i < count; i++) {
+		VORTEX_CHECK(nearlyEqual(store.getModelMatrix(i), referenceModel(i, transforms, parents)));
+	}
+
+	// reparenting moves the subtree under its new parent
+	uint32_t child = expected.back() == moved ? expected.front() : expected.back();
+	uint32_t newParent = VortexTransformStore::NO_PARENT;
+	for (uint32_t i = 0; i < count && newParent == VortexTransformStore::NO_PARENT; i++) {
+		if (parents[i] == VortexTransformStore::NO_PARENT && i != moved) {
+			newParent = i;
+		}
+	}
+	parents[child] = newParent;
+	store.setParent(child, newParent);
+	store.update();
+	for (uint32_t i = 0; i < count; i++) {
+		VORTEX_CHECK(nearlyEqual(store.getModelMatrix(i), referenceModel(i, transforms, parents)));
+	}
+}
+
+VORTEX_TEST(transformStoreRejectsCycles) {
+	VortexTransformStore store;
+	store.resize(4);
+	store.setParent(1, 0);
+	store.setParent(2, 1);
+	store.setParent(0, 2);
+
+	bool threw = false;
+	try {
+		store.update();
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+	VORTEX_CHECK(threw);
+}
+
+VORTEX_TEST(transformStoreSyncsParentComponents) {
+	VortexWorld world;
+	VortexEntity parent = world.createEntity();
+	VortexEntity child = world.createEntity();
+
+	auto& parentTransform = world.addComponent<TransformComponent>(parent);
+	parentTransform.translation = { 1.0f, 2.0f, 3.0f };
+	auto& childTransform = world.addComponent<TransformComponent>(child);
+	childTransform.translation = { 10.0f, 0.0f, 0.0f };
+	world.addComponent<ParentComponent>(child, parent);
+
+	VortexTransformStore store;
+	store.sync(world);
+	glm::vec4 childOrigin = store.getModelMatrix(child.index)[3];
+	VORTEX_CHECK_EQUAL(childOrigin.x, 11.0f);
+	VORTEX_CHECK_EQUAL(childOrigin.y, 2.0f);
+	VORTEX_CHECK_EQUAL(childOrigin.z, 3.0f);
+
+	// a dead parent leaves the child a root
+	world.destroyEntity(parent);
+	store.sync(world);
+	VORTEX_CHECK_EQUAL(store.getParent(child.index), VortexTransformStore::NO_PARENT);
+	VORTEX_CHECK_EQUAL(store.getModelMatrix(child.index)[3].x, 10.0f);
+}
+
+VORTEX_BENCHMARK(transformStoreHierarchyUpdate) {
+	std::mt19937 random{ 23 };
+	const uint32_t count = 100000;
+
+	VortexTransformStore store;
+	store.resize(count);
+	std::vector<TransformComponent> transforms(count);
+	auto parents = randomParents(count, random);
+	std::vector<uint32_t> roots;
+	for (uint32_t i = 0; i < count; i++) {
+		transforms[i] = randomTransform(random);
+		store.set(i, transforms[i]);
+		store.setParent(i, parents[i]);
+		if (parents[i] == VortexTransformStore::NO_PARENT) {
+			roots.push_back(i);
+		}
+	}
+	store.update();
+
+	VortexJobSystem jobSystem{};
+	for (uint32_t percent : { 1u, 10u, 100u }) {
+		// a share of all transforms moves, everything outside their subtrees keeps its world matrix
+		std::vector<uint32_t> moving;
+		for (uint32_t i = 0; i < count; i++) {
+			if (random() % 100 < percent) {
+				moving.push_back(i);
+			}
+		}
+
+		bool flip = false;
+		uint32_t updated = 0;
+		double milliseconds = Test::measure([&] {
+			flip = !flip;
+			for (uint32_t i : moving) {
+				TransformComponent transform = transforms[i];
+				transform.translation.x += flip ? 1.0f : 0.0f;
+				store.set(i, transform);
+			}
+			updated = store.update(&jobSystem);
+		});
+
+		std::string name = std::to_string(percent) + "% of 100000 moving";
+		Test::report(name.c_str(), milliseconds, "ms");
+		Test::report((name + ", world matrices updated").c_str(), updated, "transforms");
+	}
+	Test::report("roots", static_cast<double>(roots.size()), "transforms");
+}
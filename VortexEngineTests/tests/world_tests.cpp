@@ -0,0 +1,169 @@
+#include "../vortex_test.h"
+#include "../../VortexEngine/headers/vortex_world.h"
+
+//std includes
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace VortexEngine;
+
+namespace {
+	struct Position {
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+	};
+
+	struct Velocity {
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+	};
+
+	struct Tag {
+		uint32_t value = 0;
+	};
+}
+
+VORTEX_TEST(worldReusesIndicesWithNewGenerations) {
+	VortexWorld world;
+	VortexEntity first = world.createEntity();
+	world.addComponent<Tag>(first, 1u);
+	VORTEX_CHECK(world.isAlive(first));
+
+	world.destroyEntity(first);
+	VORTEX_CHECK(!world.isAlive(first));
+	VORTEX_CHECK_EQUAL(world.getEntityCount(), 0u);
+
+	VortexEntity second = world.createEntity();
+	VORTEX_CHECK_EQUAL(second.index, first.index);
+	VORTEX_CHECK(second.generation != first.generation);
+	VORTEX_CHECK(!world.isAlive(first));
+	// the old entity's components went with it
+	VORTEX_CHECK(!world.hasComponent<Tag>(second));
+	VORTEX_CHECK(world.tryGetComponent<Tag>(first) == nullptr);
+
+	// destroying a stale handle leaves the new entity alone
+	world.destroyEntity(first);
+	VORTEX_CHECK(world.isAlive(second));
+}
+
+VORTEX_TEST(worldComponentsMatchReferenceUnderRandomEdits) {
+	VortexWorld world;
+	std::mt19937 random{ 31 };
+
+	std::vector<VortexEntity> entities;
+	std::unordered_map<uint32_t, uint32_t> tags;
+	std::unordered_map<uint32_t, float> positions;
+
+	for (int step = 0; step < 20000; step++) {
+		uint32_t action = random() % 6;
+		if (entities.empty() || action == 0) {
+			entities.push_back(world.createEntity());
+			continue;
+		}
+
+		size_t pick = random() % entities.size();
+		VortexEntity entity = entities[pick];
+		switch (action) {
+		case 1:
+			world.addComponent<Tag>(entity, static_cast<uint32_t>(step));
+			tags[entity.index] = static_cast<uint32_t>(step);
+			break;
+		case 2:
+			world.addComponent<Position>(entity, static_cast<float>(step));
+			positions[entity.index] = static_cast<float>(step);
+			break;
+		case 3:
+			world.removeComponent<Tag>(entity);
+			tags.erase(entity.index);
+			break;
+		case 4:
+			world.removeComponent<Position>(entity);
+			positions.erase(entity.index);
+			break;
+		case 5:
+			world.destroyEntity(entity);
+			tags.erase(entity.index);
+			positions.erase(entity.index);
+			entities[pick] = entities.back();
+			entities.pop_back();
+			break;
+		}
+	}
+
+	VORTEX_CHECK_EQUAL(world.getEntityCount(), static_cast<uint32_t>(entities.size()));
+	for (VortexEntity entity : entities) {
+		auto tag = tags.find(entity.index);
+		Tag* component = world.tryGetComponent<Tag>(entity);
+		VORTEX_CHECK((tag != tags.end()) == (component != nullptr));
+		if (component) {
+			VORTEX_CHECK_EQUAL(component->value, tag->second);
+		}
+	}
+
+	size_t visited = 0;
+	world.each<Tag, Position>([&](VortexEntity entity, Tag& tag, Position& position) {
+		VORTEX_CHECK(world.isAlive(entity));
+		VORTEX_CHECK_EQUAL(tag.value, tags.at(entity.index));
+		VORTEX_CHECK_EQUAL(position.x, positions.at(entity.index));
+		visited++;
+	});
+	size_t expected = 0;
+	for (auto& [index, value] : tags) {
+		expected += positions.count(index);
+	}
+	VORTEX_CHECK_EQUAL(visited, expected);
+
+	visited = 0;
+	world.each<Position>([&](VortexEntity entity, Position& position) {
+		VORTEX_CHECK_EQUAL(position.x, positions.at(entity.index));
+		visited++;
+	});
+	VORTEX_CHECK_EQUAL(visited, positions.size());
+}
+
+VORTEX_BENCHMARK(worldIteration) {
+	const uint32_t count = 1000000;
+	VortexWorld world;
+	for (uint32_t i = 0; i < count; i++) {
+		VortexEntity entity = world.createEntity();
+		world.addComponent<Position>(entity);
+		// moving entities are a subset, as in a typical scene
+		if (i % 4 == 0) {
+			world.addComponent<Velocity>(entity, 1.0f, 0.0f, 0.0f);
+		}
+	}
+
+	double singleMilliseconds = Test::measure([&] {
+		world.each<Position>([](VortexEntity, Position& position) { position.y += 1.0f; });
+	});
+	double pairMilliseconds = Test::measure([&] {
+		world.each<Position, Velocity>([](VortexEntity, Position& position, Velocity& velocity) {
+			position.x += velocity.x;
+		});
+	});
+
+	// the heap allocated, id keyed object the world replaced
+	struct GameObject {
+		uint32_t id;
+		std::shared_ptr<void> model;
+		Position position;
+		Velocity velocity;
+		float scale[3];
+		float rotation[3];
+		float color[3];
+	};
+	std::unordered_map<uint32_t, GameObject> gameObjects;
+	for (uint32_t i = 0; i < count; i++) {
+		gameObjects.emplace(i, GameObject{ i });
+	}
+	double mapMilliseconds = Test::measure([&] {
+		for (auto& [id, object] : gameObjects) {
+			object.position.y += 1.0f;
+		}
+	});
+
+	Test::report("each<Position>, 1M entities", singleMilliseconds, "ms");
+	Test::report("each<Position, Velocity>, 250k of 1M entities", pairMilliseconds, "ms");
+	Test::report("unordered_map of game objects, 1M objects", mapMilliseconds, "ms");
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+//std includes
+#include <chrono>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/*
+ * Minimal test and benchmark registry for the engine's CPU-only systems, which need neither a GPU
+ * nor a window. Tests throw on the first failed check; benchmarks report their own measurements.
+ * See main.cpp for how they are run.
+ *
+ * Systems that only do work on a device (the pipeline cache, the upload queue) are measured by
+ * the engine's own startup and load reports instead, e.g. pipeline creation time with a warm or
+ * cold pipeline cache; run it with --headless=N for repeatable numbers.
+ */
+namespace VortexEngine::Test {
+	struct Case {
+		const char* name;
+		void (*run)();
+		bool benchmark;
+	};
+
+	inline std::vector<Case>& getCases() {
+		static std::vector<Case> cases;
+		return cases;
+	}
+
+	struct Registrar {
+		Registrar(const char* name, void (*run)(), bool benchmark) {
+			getCases().push_back({ name, run, benchmark });
+		}
+	};
+
+	struct Failure : std::runtime_error {
+		using std::runtime_error::runtime_error;
+	};
+
+	inline void fail(const char* file, int line, const std::string& message) {
+		std::ostringstream text;
+		text << file << ":" << line << ": " << message;
+		throw Failure(text.str());
+	}
+
+	// Runs body repeatedly for about minMilliseconds and returns the average time per run in ms
+	template<typename Body>
+	double measure(Body&& body, double minMilliseconds = 200.0) {
+		using clock = std::chrono::high_resolution_clock;
+		uint32_t runs = 0;
+		auto start = clock::now();
+		double elapsed = 0.0;
+		do {
+			body();
+			runs++;
+			elapsed = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		} while (elapsed < minMilliseconds);
+		return elapsed / runs;
+	}
+
+	// One "name: value unit" line of benchmark output
+	void report(const char* name, double value, const char* unit);
+}
+
+#define VORTEX_TEST_CASE(name, benchmark) \
+	static void name(); \
+	static ::VortexEngine::Test::Registrar name##Registrar{ #name, name, benchmark }; \
+	static void name()
+
+#define VORTEX_TEST(name) VORTEX_TEST_CASE(name, false)
+#define VORTEX_BENCHMARK(name) VORTEX_TEST_CASE(name, true)
+
+#define VORTEX_CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			::VortexEngine::Test::fail(__FILE__, __LINE__, "check failed: " #expression); \
+		} \
+	} while (0)
+
+#define VORTEX_CHECK_EQUAL(actual, expected) \
+	do { \
+		auto actualValue = (actual); \
+		auto expectedValue = (expected); \
+		if (!(actualValue == expectedValue)) { \
+			std::ostringstream message; \
+			message << #actual " == " #expected " failed: " << actualValue << " != " << expectedValue; \
+			::VortexEngine::Test::fail(__FILE__, __LINE__, message.str()); \
+		} \
+	} while (0)